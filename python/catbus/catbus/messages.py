@@ -58,6 +58,7 @@ CATBUS_MSG_TYPE_KEY_DATA                   = CATBUS_MSG_DATABASE_GROUP_OFFSET +
 
 CATBUS_MSG_TYPE_LINK                       = CATBUS_MSG_LINK_GROUP_OFFSET + 1
 CATBUS_MSG_TYPE_LINK_DATA                  = CATBUS_MSG_LINK_GROUP_OFFSET + 2
+CATBUS_MSG_TYPE_LINK_DATA_BATCH            = CATBUS_MSG_LINK_GROUP_OFFSET + 3
 
 CATBUS_MSG_TYPE_FILE_OPEN                  = ( 1 + CATBUS_MSG_FILE_GROUP_OFFSET )
 CATBUS_MSG_TYPE_FILE_CONFIRM               = ( 2 + CATBUS_MSG_FILE_GROUP_OFFSET )
@@ -76,6 +77,10 @@ CATBUS_MSG_FILE_FLAG_WRITE                 = 0x02
 
 CATBUS_DISC_FLAG_QUERY_ALL                 = 0x01
 
+CATBUS_ANNOUNCE_FLAG_LINK_BATCH            = 0x01
+
+CATBUS_MAX_LINK_DATA_RECORDS               = 16
+
 
 
 class MsgHeader(StructField):
@@ -233,6 +238,29 @@ class LinkDataMsg(StructField):
 
         self.header.msg_type = CATBUS_MSG_TYPE_LINK_DATA
 
+class LinkDataRecord(StructField):
+    def __init__(self, **kwargs):
+        fields = [CatbusHash(_name="source_hash"),
+                  CatbusHash(_name="dest_hash"),
+                  Uint16Field(_name="sequence"),
+                  Int32Field(_name="data")]
+
+        super(LinkDataRecord, self).__init__(_name="link_data_record", _fields=fields, **kwargs)
+
+class LinkDataBatchMsg(StructField):
+    def __init__(self, **kwargs):
+        fields = [MsgHeader(_name="header"),
+                  Uint8Field(_name="flags"),
+                  NTPTimestampField(_name='ntp_timestamp'),
+                  CatbusQuery(_name="source_query"),
+                  Uint8Field(_name="count"),
+                  ArrayField(_name="records", _field=LinkDataRecord)]
+
+        super(LinkDataBatchMsg, self).__init__(_name="link_data_batch_msg", _fields=fields, **kwargs)
+
+        self.header.msg_type = CATBUS_MSG_TYPE_LINK_DATA_BATCH
+        self.count = len(self.records)
+
 
 class FileOpenMsg(StructField):
     def __init__(self, **kwargs):
@@ -372,6 +400,7 @@ messages = {
 
     CATBUS_MSG_TYPE_LINK:                   LinkMsg,
     CATBUS_MSG_TYPE_LINK_DATA:              LinkDataMsg,
+    CATBUS_MSG_TYPE_LINK_DATA_BATCH:        LinkDataBatchMsg,
 
     CATBUS_MSG_TYPE_FILE_OPEN:              FileOpenMsg,
     CATBUS_MSG_TYPE_FILE_CONFIRM:           FileConfirmMsg,
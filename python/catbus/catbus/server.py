@@ -165,6 +165,30 @@ class Publisher(Ribbon):
         for host in self.link_data_transmissions.keys():
             msgs = self.link_data_transmissions[host]
 
+            # batch capable hosts get everything we have, packed into
+            # as few messages as possible
+            if self._server._supports_batch(host):
+                pending = msgs.values()
+                del self.link_data_transmissions[host]
+
+                while len(pending) > 0:
+                    records = pending[:CATBUS_MAX_LINK_DATA_RECORDS]
+                    pending = pending[CATBUS_MAX_LINK_DATA_RECORDS:]
+
+                    msg = LinkDataBatchMsg(
+                            flags=records[0].flags,
+                            ntp_timestamp=records[0].ntp_timestamp,
+                            source_query=records[0].source_query,
+                            records=[LinkDataRecord(
+                                        source_hash=r.source_hash,
+                                        dest_hash=r.dest_hash,
+                                        sequence=r.sequence,
+                                        data=r.data) for r in records])
+
+                    self._server._send_data_msg(msg, host)
+
+                continue
+
             # get a random message for this host and send it
             target = random.choice(msgs.keys())
             msg = msgs[target]
@@ -225,6 +249,7 @@ class Server(Ribbon):
         self._receive_cache = {}
         self._sequences = {}
         self._hash_lookup = {}
+        self._batch_hosts = set()
 
         self._database.add_item('uptime', 0, 'uint32', readonly=True)
 
@@ -239,6 +264,7 @@ class Server(Ribbon):
             SetKeysMsg: self._handle_set_keys,
             LinkMsg: self._handle_link,
             LinkDataMsg: self._handle_link_data,
+            LinkDataBatchMsg: self._handle_link_data_batch,
         }
 
         self._last_announce = time.time() - 10.0
@@ -366,6 +392,7 @@ class Server(Ribbon):
 
     def _send_announce(self, host=('<broadcast>', CATBUS_DISCOVERY_PORT), discovery_id=None):
         msg = AnnounceMsg(
+                flags=CATBUS_ANNOUNCE_FLAG_LINK_BATCH,
                 data_port=self._data_port,
                 query=self._database.get_query())
 
@@ -383,7 +410,19 @@ class Server(Ribbon):
                 self._send_announce(host=host, discovery_id=msg.header.transaction_id)
 
     def _handle_announce(self, msg, host):
-        pass
+        # link data goes to the announced data port
+        data_host = (host[0], msg.data_port)
+
+        with self.__lock:
+            if msg.flags & CATBUS_ANNOUNCE_FLAG_LINK_BATCH:
+                self._batch_hosts.add(data_host)
+
+            else:
+                self._batch_hosts.discard(data_host)
+
+    def _supports_batch(self, host):
+        with self.__lock:
+            return host in self._batch_hosts
 
     def _handle_lookup_hash(self, msg, host):
         resolved_hashes = []
@@ -555,6 +594,19 @@ class Server(Ribbon):
                 link.callback(link.source_key, msg.data, source_query, timestamp)
 
 
+    def _handle_link_data_batch(self, msg, host):
+        for record in msg.records:
+            record_msg = LinkDataMsg(
+                            flags=msg.flags,
+                            ntp_timestamp=msg.ntp_timestamp,
+                            source_query=msg.source_query,
+                            source_hash=record.source_hash,
+                            dest_hash=record.dest_hash,
+                            sequence=record.sequence,
+                            data=record.data)
+
+            self._handle_link_data(record_msg, host)
+
     def _process_msg(self, msg, host):
         response = self._msg_handlers[type(msg)](msg, host)
 
@@ -65,6 +65,7 @@ BACKUP_SETTINGS = [
     'gfx_dimmer_curve',
     'gfx_frame_rate',
     'gfx_hsfade',
+    'gfx_hsv_mode',
     'gfx_vfade',
     'gfx_interleave_x',
     'gfx_master_dimmer',
@@ -663,6 +663,22 @@ class Device(object):
 
         return info
 
+    def get_thread_stats(self):
+        data = self.get_file("threadstats")
+
+        header = sapphiredata.ThreadStatsHeaderField()
+        header.unpack(data)
+        data = data[header.size():]
+
+        stats = sapphiredata.ThreadStatsArray()
+        stats.unpack(data[:header.thread_count * sapphiredata.ThreadStatsField().size()])
+        data = data[stats.size():]
+
+        trace = sapphiredata.ThreadTraceArray()
+        trace.unpack(data)
+
+        return header, stats, trace
+
     def get_handle_info(self):
         data = self.get_file("handleinfo")
 
@@ -983,10 +999,53 @@ class Device(object):
 
         return s
 
+    def cli_threadstats(self, line):
+        # the threadstats vfile only exists in firmware built with
+        # ENABLE_THREAD_STATS (see threading.h)
+        if "threadstats" not in self.list_files():
+            return "Thread stats are disabled on this device (build with ENABLE_THREAD_STATS)"
+
+        header, stats, trace = self.get_thread_stats()
+
+        # upper bound of each histogram bucket, in microseconds
+        buckets = ["<%d" % (32 * (4 ** i)) for i in range(header.hist_buckets - 1)]
+        buckets.append(">=%d" % (32 * (4 ** (header.hist_buckets - 2))))
+
+        s = "\nRun time histogram (us):\n"
+        s += "Addr   MaxRun " + " ".join(["%8s" % b for b in buckets]) + "\n"
+
+        for n in stats:
+            s += "%5x %8d " % (n.addr, n.max_run_time)
+            s += " ".join(["%8d" % c for c in n.run_hist]) + "\n"
+
+        s += "\nWake latency histogram (us):\n"
+        s += "Addr   MaxLat " + " ".join(["%8s" % b for b in buckets]) + "\n"
+
+        for n in stats:
+            s += "%5x %8d " % (n.addr, n.max_latency)
+            s += " ".join(["%8d" % c for c in n.latency_hist]) + "\n"
+
+        causes = {0: "run", 8: "signal", 16: "alarm"}
+        statuses = {0: "wait", 1: "yield", 2: "exit", 3: "end", 4: "sleep"}
+
+        s += "\nTrace (min %d us):\n" % (header.trace_min)
+        s += "Timestamp    Addr    Run   Latency  Cause   Status\n"
+
+        for n in trace:
+            s += "%10d %5x %8d %8d  %-7s %s\n" % \
+                (n.timestamp,
+                 n.addr,
+                 n.run_time,
+                 n.latency,
+                 causes.get(n.cause, n.cause),
+                 statuses.get(n.status, n.status))
+
+        return s
+
     def cli_handleinfo(self, line):
         info = self.get_handle_info()
 
-        s = "\nType             Size\n"
+        s = "\nType             Size Pool\n"
 
         memtypes = {
             0: "unknown",
@@ -1008,6 +1067,7 @@ class Device(object):
         total_size = 0
         handles = 0
         counts = {}
+        pools = {}
 
         for n in info:
             if n.handle_size == 0:
@@ -1025,7 +1085,14 @@ class Device(object):
             counts[type_str][0] += 1
             counts[type_str][1] += n.handle_size
 
-            s += "%16s %d\n" % (type_str, n.handle_size)
+            if n.handle_pool == 0:
+                pool_str = "heap"
+
+            else:
+                pool_str = "%d" % (n.handle_pool - 1)
+                pools[pool_str] = pools.get(pool_str, 0) + 1
+
+            s += "%16s %4d %s\n" % (type_str, n.handle_size, pool_str)
 
             handles += 1
             total_size += n.handle_size
@@ -1035,6 +1102,11 @@ class Device(object):
         for n in counts:
             s += "%16s %4d %4d\n" % (n, counts[n][0], counts[n][1])
 
+        s += "\n"
+
+        for n in sorted(pools):
+            s += "Pool %s: %d slots used\n" % (n, pools[n])
+
         s += "\n"
         s += "Handles: %d\n" % (handles)
         s += "Total size: %d\n" % (total_size)
@@ -46,7 +46,8 @@ class FileInfoArray(ArrayField):
 class HandleInfoField(StructField):
     def __init__(self, **kwargs):
         fields = [Uint16Field(_name="handle_size"),
-                  Uint8Field(_name="handle_type")]
+                  Uint8Field(_name="handle_type"),
+                  Uint8Field(_name="handle_pool")]
 
         super(HandleInfoField, self).__init__(_name="mem_info", _fields=fields, **kwargs)
 
@@ -109,6 +110,50 @@ class ThreadInfoArray(ArrayField):
 
         super(ThreadInfoArray, self).__init__(_field=field, **kwargs)
 
+class ThreadStatsHeaderField(StructField):
+    def __init__(self, **kwargs):
+        fields = [Uint8Field(_name="version"),
+                  Uint8Field(_name="thread_count"),
+                  Uint8Field(_name="trace_count"),
+                  Uint8Field(_name="hist_buckets"),
+                  Uint16Field(_name="trace_min"),
+                  ArrayField(_name="reserved", _field=Uint8Field, _length=10)]
+
+        super(ThreadStatsHeaderField, self).__init__(_fields=fields, **kwargs)
+
+class ThreadStatsField(StructField):
+    def __init__(self, **kwargs):
+        fields = [Uint32Field(_name="addr"),
+                  Uint32Field(_name="max_run_time"),
+                  Uint32Field(_name="max_latency"),
+                  ArrayField(_name="run_hist", _field=Uint16Field, _length=8),
+                  ArrayField(_name="latency_hist", _field=Uint16Field, _length=8)]
+
+        super(ThreadStatsField, self).__init__(_fields=fields, **kwargs)
+
+class ThreadStatsArray(ArrayField):
+    def __init__(self, **kwargs):
+        field = ThreadStatsField
+
+        super(ThreadStatsArray, self).__init__(_field=field, **kwargs)
+
+class ThreadTraceField(StructField):
+    def __init__(self, **kwargs):
+        fields = [Uint32Field(_name="timestamp"),
+                  Uint32Field(_name="addr"),
+                  Uint16Field(_name="run_time"),
+                  Uint16Field(_name="latency"),
+                  Uint8Field(_name="cause"),
+                  Uint8Field(_name="status")]
+
+        super(ThreadTraceField, self).__init__(_fields=fields, **kwargs)
+
+class ThreadTraceArray(ArrayField):
+    def __init__(self, **kwargs):
+        field = ThreadTraceField
+
+        super(ThreadTraceArray, self).__init__(_field=field, **kwargs)
+
 class NTPTimestampField(StructField):
     def __init__(self, **kwargs):
         fields = [Uint32Field(_name="seconds"),
@@ -140,7 +185,10 @@ class KVSendField(StructField):
                   Uint16Field(_name="port"),
                   Int32Field(_name="source_hash"),
                   Int32Field(_name="dest_hash"),
-                  Int8Field(_name="ttl")]
+                  Int8Field(_name="ttl"),
+                  Uint8Field(_name="flags"),
+                  Uint8Field(_name="expire_tick"),
+                  Int16Field(_name="wheel_next")]
 
         super(KVSendField, self).__init__(_fields=fields, **kwargs)
 
@@ -157,7 +205,9 @@ class KVReceiveCacheField(StructField):
                   Int32Field(_name="dest_hash"),
                   Int32Field(_name="data"),
                   Uint16Field(_name="sequence"),
-                  Int8Field(_name="ttl")]
+                  Int8Field(_name="ttl"),
+                  Uint8Field(_name="expire_tick"),
+                  Int16Field(_name="wheel_next")]
 
         super(KVReceiveCacheField, self).__init__(_fields=fields, **kwargs)
 
@@ -80,6 +80,7 @@ static volatile bool request_reset_ready_timeout;
 static uint16_t rgb_index;
 
 static uint16_t comm_errors;
+static uint32_t comm_tx_bytes;
 
 static process_stats_t process_stats;
 
@@ -163,6 +164,8 @@ static int8_t _intf_i8_send_msg( uint8_t data_id, uint8_t *data, uint8_t len ){
     Serial.write( (uint8_t *)&header, sizeof(header) );
     Serial.write( data, len );
 
+    comm_tx_bytes += 1 + sizeof(header) + len;
+
     return 0;
 }
 
@@ -481,6 +484,8 @@ void intf_v_process( void ){
         info_msg.rx_udp_port_overruns   = wifi_u32_get_rx_udp_port_overruns();
         info_msg.udp_received           = wifi_u32_get_udp_received();
         info_msg.udp_sent               = wifi_u32_get_udp_sent();
+        info_msg.udp_rx_bytes           = wifi_u32_get_udp_rx_bytes();
+        info_msg.udp_rx_max_time        = wifi_u16_get_udp_rx_max_time();
 
         mem_rt_data_t rt_data;
         mem2_v_get_rt_data( &rt_data );
@@ -494,6 +499,13 @@ void intf_v_process( void ){
         info_msg.wifi_max_time          = process_stats.wifi_max_time;
         info_msg.mem_max_time           = process_stats.mem_max_time;
 
+        info_msg.comm_tx_bytes          = comm_tx_bytes;
+
+        uint32_t kv_sent, kv_suppressed;
+        vm_v_get_kv_stats( &kv_sent, &kv_suppressed );
+        info_msg.vm_kv_sent             = kv_sent;
+        info_msg.vm_kv_suppressed       = kv_suppressed;
+
         _intf_i8_send_msg( WIFI_DATA_ID_INFO, (uint8_t *)&info_msg, sizeof(info_msg) );
     }
     else if( request_vm_info ){
@@ -544,10 +556,10 @@ void intf_v_process( void ){
     }
     else if( request_rgb_array ){
 
-        // get pointers to the arrays
-        uint8_t *r = gfx_u8p_get_red();
-        uint8_t *g = gfx_u8p_get_green();
-        uint8_t *b = gfx_u8p_get_blue();
+        // get pointers to the arrays, in wire channel order
+        uint8_t *ch0 = gfx_u8p_get_ch0();
+        uint8_t *ch1 = gfx_u8p_get_ch1();
+        uint8_t *ch2 = gfx_u8p_get_ch2();
         uint8_t *d = gfx_u8p_get_dither();
 
         uint16_t pix_count = gfx_u16_get_pix_count();
@@ -565,11 +577,11 @@ void intf_v_process( void ){
         msg.index = rgb_index;
         msg.count = count;
         uint8_t *ptr = msg.rgbd_array;
-        memcpy( ptr, r + rgb_index, count );
+        memcpy( ptr, ch0 + rgb_index, count );
         ptr += count;
-        memcpy( ptr, g + rgb_index, count );
+        memcpy( ptr, ch1 + rgb_index, count );
         ptr += count;
-        memcpy( ptr, b + rgb_index, count );
+        memcpy( ptr, ch2 + rgb_index, count );
         ptr += count;
         memcpy( ptr, d + rgb_index, count );
 
@@ -27,6 +27,10 @@
 #define VM_ENABLE_GFX
 #define VM_ENABLE_KVDB
 
+// rewrite loaded programs into fused superinstructions.
+// comment out to compare against the plain interpreter.
+#define VM_ENABLE_PREDECODE
+
 #define VM_MAX_IMAGE_SIZE   4096
 
 #endif
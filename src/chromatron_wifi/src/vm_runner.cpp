@@ -48,6 +48,57 @@ static bool run_faders;
 
 static list_t kv_send_list;
 
+// published vars and write keys are only sent to the AVR when they change.
+// a full refresh is sent periodically, and whenever batches are lost, so
+// the AVR side recovers from any dropped messages.
+#define VM_KV_FULL_REFRESH_INTERVAL     1000 // ms
+
+static bool kv_full_refresh;
+static uint32_t last_full_refresh;
+
+// last value sent for each write key
+static mem_handle_t write_keys_shadow_h = -1;
+
+static uint32_t kv_sent;
+static uint32_t kv_suppressed;
+
+
+static void flush_kv_batch( wifi_msg_kv_batch_t *batch ){
+
+    if( batch->count == 0 ){
+
+        return;
+    }
+
+    list_node_t ln = list_ln_create_node( batch, sizeof(wifi_msg_kv_batch_t) );
+
+    if( ln < 0 ){
+
+        // could not queue these changes, resend everything next frame
+        kv_full_refresh = true;
+    }
+    else{
+
+        list_v_insert_head( &kv_send_list, ln );
+    }
+
+    memset( batch, 0, sizeof(wifi_msg_kv_batch_t) );
+}
+
+static void add_kv_batch_entry( wifi_msg_kv_batch_t *batch, catbus_hash_t32 hash, int32_t data ){
+
+    batch->entries[batch->count].hash = hash;
+    batch->entries[batch->count].data = data;
+    batch->count++;
+
+    kv_sent++;
+
+    if( batch->count >= WIFI_KV_BATCH_LEN ){
+
+        flush_kv_batch( batch );
+    }
+}
+
 
 static int8_t _vm_i8_run_vm( bool init ){
 
@@ -120,96 +171,103 @@ static int8_t _vm_i8_run_vm( bool init ){
     vm_info.return_code = return_code;
 
     wifi_msg_kv_batch_t batch;
-    list_node_t ln = -1;
+    memset( &batch, 0, sizeof(batch) );
 
-    // reset send list
-    list_v_destroy( &kv_send_list );
+    // if the interface did not get through last frame's batches, they are
+    // discarded and everything is resent
+    if( list_u8_count( &kv_send_list ) > 0 ){
 
-    // store published vars back to DB
-    publish = (vm_publish_t *)&vm_slab[vm_state.publish_start];
+        kv_full_refresh = true;
+    }
 
-    count = vm_state.publish_count;
+    if( ( millis() - last_full_refresh ) >= VM_KV_FULL_REFRESH_INTERVAL ){
 
-    while( count > 0 ){
+        kv_full_refresh = true;
+    }
 
-        kvdb_i8_set( publish->hash, data_table[publish->addr] );
+    bool full_refresh = kv_full_refresh;
 
-        publish++;
-        count--;
+    if( full_refresh ){
+
+        kv_full_refresh = false;
+        last_full_refresh = millis();
     }
 
-    // load published vars to messages for transport
+    // reset send list
+    list_v_destroy( &kv_send_list );
+
+    // store changed published vars back to DB and load them to messages
+    // for transport
     publish = (vm_publish_t *)&vm_slab[vm_state.publish_start];
 
     count = vm_state.publish_count;
 
     while( count > 0 ){
 
-        memset( &batch, 0, sizeof(batch) );
-
-        for( uint32_t i = 0; i < WIFI_KV_BATCH_LEN; i++ ){
+        int32_t value = data_table[publish->addr];
+        int32_t current = 0;
+        bool changed = ( kvdb_i8_get( publish->hash, &current ) < 0 ) || ( current != value );
 
-            batch.count++;
-            batch.entries[i].hash = publish->hash;
-            batch.entries[i].data = data_table[publish->addr];
+        if( changed ){
 
-            publish++;
-            count--;
-
-            if( count == 0 ){
-
-                break;
-            }
+            kvdb_i8_set( publish->hash, value );
         }
 
-        ln = list_ln_create_node( &batch, sizeof(batch) );
+        if( changed || full_refresh ){
 
-        if( ln < 0 ){
+            add_kv_batch_entry( &batch, publish->hash, value );
+        }
+        else{
 
-            break;
+            kv_suppressed++;
         }
 
-        list_v_insert_head( &kv_send_list, ln );
+        publish++;
+        count--;
     }
 
-    // load write keys from DB
+    // load changed write keys from DB
     count = vm_state.write_keys_count;
     uint32_t *hash = (uint32_t *)&vm_slab[vm_state.write_keys_start];
 
-    while( count > 0 ){
+    int32_t *shadow = 0;
 
-        memset( &batch, 0, sizeof(batch) );
+    if( write_keys_shadow_h >= 0 ){
 
-        for( uint32_t i = 0; i < WIFI_KV_BATCH_LEN; i++ ){
+        shadow = (int32_t *)mem2_vp_get_ptr( write_keys_shadow_h );
+    }
 
-            batch.count++;
-            batch.entries[i].hash = *hash;
+    while( count > 0 ){
 
-            // access the data this way prevents an alignment error when
-            // loading the batch array
-            int32_t data = 0;
-            kvdb_i8_get( *hash, &data );
-            batch.entries[i].data = data;
+        // access the data this way prevents an alignment error when
+        // loading the batch array
+        int32_t data = 0;
+        kvdb_i8_get( *hash, &data );
 
-            hash++;
-            count--;
+        if( ( shadow == 0 ) || ( *shadow != data ) || full_refresh ){
 
-            if( count == 0 ){
+            add_kv_batch_entry( &batch, *hash, data );
 
-                break;
+            if( shadow != 0 ){
+
+                *shadow = data;
             }
         }
+        else{
 
-        ln = list_ln_create_node( &batch, sizeof(batch) );
+            kv_suppressed++;
+        }
 
-        if( ln < 0 ){
+        if( shadow != 0 ){
 
-            break;
+            shadow++;
         }
 
-        list_v_insert_head( &kv_send_list, ln );
+        hash++;
+        count--;
     }
 
+    flush_kv_batch( &batch );
 
 end:
     return return_code;
@@ -274,6 +332,12 @@ void vm_v_reset( void ){
     vm_len = 0;
     memset( vm_slab, 0, sizeof(vm_slab) );
 
+    if( write_keys_shadow_h >= 0 ){
+
+        mem2_v_free( write_keys_shadow_h );
+        write_keys_shadow_h = -1;
+    }
+
 }
 
 int8_t vm_i8_load( uint8_t *data, uint16_t len ){
@@ -339,39 +403,41 @@ int8_t vm_i8_load( uint8_t *data, uint16_t len ){
         // init database
         kvdb_v_delete_tag( KVDB_VM_RUNNER_TAG );
 
-        uint32_t count = vm_state.write_keys_count;
-        uint32_t *hash = (uint32_t *)&vm_slab[vm_state.write_keys_start];
-    
-        while( count > 0 ){        
-
-            kvdb_i8_add( *hash, 0, KVDB_VM_RUNNER_TAG, 0 );
+        kvdb_i8_add_batch( (uint32_t *)&vm_slab[vm_state.write_keys_start],
+                           vm_state.write_keys_count,
+                           KVDB_VM_RUNNER_TAG );
 
-            hash++;
-            count--;
-        }
+        kvdb_i8_add_batch( (uint32_t *)&vm_slab[vm_state.read_keys_start],
+                           vm_state.read_keys_count,
+                           KVDB_VM_RUNNER_TAG );
 
-        count = vm_state.read_keys_count;
-        hash = (uint32_t *)&vm_slab[vm_state.read_keys_start];
+        uint32_t count = vm_state.publish_count;
+        vm_publish_t *publish = (vm_publish_t *)&vm_slab[vm_state.publish_start];
     
         while( count > 0 ){        
 
-            kvdb_i8_add( *hash, 0, KVDB_VM_RUNNER_TAG, 0 );
+            kvdb_i8_add( publish->hash, 0, KVDB_VM_RUNNER_TAG, 0 );
 
-            hash++;
+            publish++;
             count--;
         }
 
-        count = vm_state.publish_count;
-        vm_publish_t *publish = (vm_publish_t *)&vm_slab[vm_state.publish_start];
-    
-        while( count > 0 ){        
+        // set up write key change tracking.
+        // if this allocation fails, all write keys are sent every frame.
+        if( write_keys_shadow_h >= 0 ){
 
-            kvdb_i8_add( publish->hash, 0, KVDB_VM_RUNNER_TAG, 0 );
+            mem2_v_free( write_keys_shadow_h );
+            write_keys_shadow_h = -1;
+        }
 
-            publish++;
-            count--;
+        if( vm_state.write_keys_count > 0 ){
+
+            write_keys_shadow_h = mem2_h_alloc( vm_state.write_keys_count * sizeof(int32_t) );
         }
 
+        // new program, send everything on the first frame
+        kv_full_refresh = true;
+
         status = _vm_i8_run_vm( true );
     }
 
@@ -485,5 +551,11 @@ void vm_v_get_send_list( list_t **list ){
     *list = &kv_send_list;
 }
 
+void vm_v_get_kv_stats( uint32_t *sent, uint32_t *suppressed ){
+
+    *sent = kv_sent;
+    *suppressed = kv_suppressed;
+}
+
 
 
@@ -48,5 +48,6 @@ void vm_v_set_reg( uint8_t addr, int32_t data );
 
 void vm_v_run_fader( void );
 void vm_v_get_send_list( list_t **list );
+void vm_v_get_kv_stats( uint32_t *sent, uint32_t *suppressed );
 
 #endif
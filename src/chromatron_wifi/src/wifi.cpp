@@ -53,6 +53,8 @@ static uint32_t rx_udp_fifo_overruns;
 static uint32_t rx_udp_port_overruns;
 static uint32_t udp_received;
 static uint32_t udp_sent;
+static uint32_t udp_rx_bytes;
+static uint16_t udp_rx_max_time;
 static uint16_t connects;
 
 static bool request_ap_mode;
@@ -325,6 +327,8 @@ void wifi_v_process( void ){
             continue;
         }
 
+        uint32_t start = micros();
+
         // allocate memory
         list_node_t ln = list_ln_create_node( 0, sizeof(wifi_msg_udp_header_t) + packet_len );
 
@@ -356,6 +360,19 @@ void wifi_v_process( void ){
         rx_header->crc = crc_u16_block( rx_data, packet_len );
     
         udp_received++;
+        udp_rx_bytes += packet_len;
+
+        uint32_t elapsed = micros() - start;
+
+        if( elapsed > udp_rx_max_time ){
+
+            if( elapsed > UINT16_MAX ){
+
+                elapsed = UINT16_MAX;
+            }
+
+            udp_rx_max_time = elapsed;
+        }
 
         port_rx_depth[i]++;
 
@@ -616,3 +633,13 @@ uint32_t wifi_u32_get_udp_sent( void ){
 
     return udp_sent;
 }
+
+uint32_t wifi_u32_get_udp_rx_bytes( void ){
+
+    return udp_rx_bytes;
+}
+
+uint16_t wifi_u16_get_udp_rx_max_time( void ){
+
+    return udp_rx_max_time;
+}
@@ -62,5 +62,7 @@ uint32_t wifi_u32_get_rx_udp_fifo_overruns( void );
 uint32_t wifi_u32_get_rx_udp_port_overruns( void );
 uint32_t wifi_u32_get_udp_received( void );
 uint32_t wifi_u32_get_udp_sent( void );
+uint32_t wifi_u32_get_udp_rx_bytes( void );
+uint16_t wifi_u16_get_udp_rx_max_time( void );
 
 #endif
@@ -0,0 +1,12 @@
+// host stand-in for the Arduino core header, for the tests in this directory.
+
+#ifndef _ARDUINO_H_HOST
+#define _ARDUINO_H_HOST
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define TRUE    true
+#define FALSE   false
+
+#endif
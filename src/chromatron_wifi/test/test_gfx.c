@@ -0,0 +1,446 @@
+/*
+// <license>
+//
+//     This file is part of the Sapphire Operating System.
+//
+//     Copyright (C) 2013-2018  Jeremy Billheimer
+//
+//
+//     This program is free software: you can redistribute it and/or modify
+//     it under the terms of the GNU General Public License as published by
+//     the Free Software Foundation, either version 3 of the License, or
+//     (at your option) any later version.
+//
+//     This program is distributed in the hope that it will be useful,
+//     but WITHOUT ANY WARRANTY; without even the implied warranty of
+//     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//     GNU General Public License for more details.
+//
+//     You should have received a copy of the GNU General Public License
+//     along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+// </license>
+ */
+
+/*
+
+Host tests for gfx_lib.c.
+
+gfx_lib.c is included directly so the tests can reach its static state.
+Build and run from src/chromatron_wifi:
+
+gcc -O2 -DESP8266 -Itest -Isrc -o test_gfx test/test_gfx.c src/util.c src/trig.c -lm && ./test_gfx
+
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <time.h>
+
+#define __KV__gfx_frame_rate                1
+#define __KV__gfx_hsfade                    2
+#define __KV__gfx_interleave_x              3
+#define __KV__gfx_master_dimmer             4
+#define __KV__gfx_sub_dimmer                5
+#define __KV__gfx_transpose                 6
+#define __KV__gfx_vfade                     7
+#define __KV__gfx_virtual_array_length      8
+#define __KV__gfx_virtual_array_start       9
+#define __KV__noise                         10
+#define __KV__pix_count                     11
+#define __KV__pix_mode                      12
+#define __KV__pix_size_x                    13
+#define __KV__pix_size_y                    14
+#define __KV__test_lib_call                 15
+
+#include "gfx_lib.c"
+
+int8_t kvdb_i8_add( catbus_hash_t32 hash, int32_t data, uint8_t tag, char name[CATBUS_STRING_LEN] ){
+
+    return 0;
+}
+
+uint8_t rnd_u8_get_int( void ){
+
+    return rand();
+}
+
+
+static int failures;
+
+#define CHECK( cond, ... ) \
+    if( !( cond ) ){ printf( "FAIL %s:%d: ", __FILE__, __LINE__ ); printf( __VA_ARGS__ ); printf( "\n" ); failures++; }
+
+
+#define TEST_PIXELS 300
+
+static const uint8_t test_curves[] = { 8, 64, 128, 200, 255 };
+
+static void set_test_params( uint8_t curve, uint8_t mode ){
+
+    gfx_params_t params;
+    gfx_v_get_params( &params );
+
+    params.version          = GFX_VERSION;
+    params.pix_count        = TEST_PIXELS;
+    params.pix_size_x       = TEST_PIXELS;
+    params.pix_size_y       = 1;
+    params.pix_mode         = PIX_MODE_WS2811;
+    params.dimmer_curve     = curve;
+    params.hsv_mode         = mode;
+
+    gfx_v_set_params( &params );
+}
+
+static void random_pixels( void ){
+
+    for( uint16_t i = 0; i < TEST_PIXELS; i++ ){
+
+        hue[i] = rand();
+        sat[i] = ( rand() % 4 ) ? 65535 - ( rand() % 8000 ) : rand();
+        val[i] = rand();
+    }
+}
+
+// 10 bit output of channel ch (8 bits plus 2 dither bits)
+static uint16_t output10( uint8_t ch, uint16_t i ){
+
+    uint8_t *channels[3] = { gfx_u8p_get_ch0(), gfx_u8p_get_ch1(), gfx_u8p_get_ch2() };
+
+    return ( channels[ch][i] << 2 ) | ( ( gfx_u8p_get_dither()[i] >> ( 4 - ( ch * 2 ) ) ) & 0x03 );
+}
+
+
+// the slope interpolated dimmer curve must match the divide based lookup
+static void test_dimmer_curve_exact( void ){
+
+    for( uint8_t c = 0; c < sizeof(test_curves); c++ ){
+
+        set_test_params( test_curves[c], GFX_HSV_MODE_EXACT );
+
+        for( uint32_t x = 0; x <= 65535; x++ ){
+
+            uint16_t expected = linterp_table_lookup( x, dimmer_lookup );
+            uint16_t actual = _gfx_u16_dimmer_curve( x );
+
+            if( actual != expected ){
+
+                CHECK( 0, "curve %d x %u: %u != %u", test_curves[c], x, actual, expected );
+                break;
+            }
+        }
+    }
+}
+
+// exact mode sync must match the scalar converter bit for bit
+static void test_sync_exact( void ){
+
+    for( uint8_t c = 0; c < sizeof(test_curves); c++ ){
+
+        set_test_params( test_curves[c], GFX_HSV_MODE_EXACT );
+
+        for( uint16_t rep = 0; rep < 100; rep++ ){
+
+            current_dimmer = rep == 0 ? 65535 : rand();
+            random_pixels();
+
+            sync_needed = TRUE;
+            gfx_v_sync_array();
+
+            for( uint16_t i = 0; i < TEST_PIXELS; i++ ){
+
+                uint16_t rgb[3];
+                uint16_t dimmed = linterp_table_lookup( ( (uint32_t)val[i] * current_dimmer ) / 65536, dimmer_lookup );
+                gfx_v_hsv_to_rgb( hue[i], sat[i], dimmed, &rgb[0], &rgb[1], &rgb[2] );
+
+                for( uint8_t ch = 0; ch < 3; ch++ ){
+
+                    CHECK( output10( ch, i ) == ( rgb[ch] >> 6 ),
+                           "curve %d pixel %d ch %d: %u != %u",
+                           test_curves[c], i, ch, output10( ch, i ), rgb[ch] >> 6 );
+                }
+            }
+        }
+    }
+}
+
+// fast mode error against exact mode, in LSBs of the 10 bit output.
+// the 8 bit dimmer table is coarsest in its first step, so the error
+// grows with steeper curves.
+static void test_sync_fast_error( void ){
+
+    static uint16_t exact[3][TEST_PIXELS];
+
+    for( uint8_t c = 0; c < sizeof(test_curves); c++ ){
+
+        uint16_t max_error = 0;
+        uint64_t total_error = 0;
+        uint32_t samples = 0;
+
+        for( uint16_t rep = 0; rep < 100; rep++ ){
+
+            current_dimmer = rep == 0 ? 65535 : rand();
+            random_pixels();
+
+            set_test_params( test_curves[c], GFX_HSV_MODE_EXACT );
+            sync_needed = TRUE;
+            gfx_v_sync_array();
+
+            for( uint16_t i = 0; i < TEST_PIXELS; i++ ){
+
+                for( uint8_t ch = 0; ch < 3; ch++ ){
+
+                    exact[ch][i] = output10( ch, i );
+                }
+            }
+
+            set_test_params( test_curves[c], GFX_HSV_MODE_FAST );
+            sync_needed = TRUE;
+            gfx_v_sync_array();
+
+            for( uint16_t i = 0; i < TEST_PIXELS; i++ ){
+
+                for( uint8_t ch = 0; ch < 3; ch++ ){
+
+                    uint16_t error = abs( (int32_t)output10( ch, i ) - exact[ch][i] );
+
+                    if( error > max_error ){
+
+                        max_error = error;
+                    }
+
+                    total_error += error;
+                    samples++;
+                }
+            }
+        }
+
+        printf( "fast mode curve %3d: max error %3d mean %.2f LSB\n",
+                test_curves[c], max_error, (double)total_error / samples );
+
+        if( test_curves[c] >= GFX_DIMMER_CURVE_DEFAULT ){
+
+            CHECK( max_error <= 16, "curve %d max error %d", test_curves[c], max_error );
+        }
+        else{
+
+            CHECK( max_error <= 256, "curve %d max error %d", test_curves[c], max_error );
+        }
+
+        CHECK( ( total_error / samples ) <= 2, "curve %d mean error", test_curves[c] );
+    }
+}
+
+
+#define ARRAY_PIXELS MAX_PIXELS
+
+static gfx_pixel_array_t test_arrays[2] = {
+    { 0,   ARRAY_PIXELS, ARRAY_PIXELS, 1, FALSE, { 0 } },
+    { 300, 50,           50,           1, FALSE, { 0 } }, // wraps past the end
+};
+
+static const int32_t test_operands[] = {
+    0, 1, -1, 2, 3, 7, 100, -100, 255, 1000, -1000,
+    32767, -32767, 65534, 65535, 65536, -65535, -65536, 70000, -70000
+};
+
+static void set_array_params( void ){
+
+    gfx_params_t params;
+    gfx_v_get_params( &params );
+
+    params.version          = GFX_VERSION;
+    params.pix_count        = ARRAY_PIXELS;
+    params.pix_size_x       = ARRAY_PIXELS;
+    params.pix_size_y       = 1;
+
+    gfx_v_set_params( &params );
+    gfx_v_init_pixel_arrays( test_arrays, 2 );
+}
+
+// add and sub as the per pixel loops did them: hue wraps, the other
+// attributes saturate.
+static uint16_t reference_add( uint8_t attr, uint16_t a, int32_t src ){
+
+    int32_t x = (int32_t)a + src;
+
+    if( attr == PIX_ATTR_HUE ){
+
+        return x;
+    }
+
+    if( x > 65535 ){
+
+        return 65535;
+    }
+
+    if( x < 0 ){
+
+        return 0;
+    }
+
+    return x;
+}
+
+static void test_array_add_sub( void ){
+
+    static uint16_t expected[ARRAY_PIXELS];
+
+    set_array_params();
+
+    const uint8_t attrs[] = { PIX_ATTR_HUE, PIX_ATTR_SAT, PIX_ATTR_VAL };
+
+    for( uint8_t a = 0; a < sizeof(attrs); a++ ){
+
+        uint16_t *ptr = _gfx_u16p_get_array_ptr( attrs[a] );
+
+        for( uint8_t obj = 0; obj < 2; obj++ ){
+
+            for( uint8_t o = 0; o < sizeof(test_operands) / sizeof(test_operands[0]); o++ ){
+
+                for( uint8_t neg = 0; neg < 2; neg++ ){
+
+                    int32_t src = test_operands[o];
+
+                    for( uint16_t i = 0; i < ARRAY_PIXELS; i++ ){
+
+                        ptr[i] = rand();
+                        expected[i] = ptr[i];
+                    }
+
+                    for( uint16_t i = 0; i < test_arrays[obj].count; i++ ){
+
+                        uint16_t index = ( test_arrays[obj].index + i ) % ARRAY_PIXELS;
+
+                        expected[index] = reference_add( attrs[a], expected[index], neg ? -src : src );
+                    }
+
+                    if( neg ){
+
+                        gfx_v_array_sub( obj, attrs[a], src );
+                    }
+                    else{
+
+                        gfx_v_array_add( obj, attrs[a], src );
+                    }
+
+                    for( uint16_t i = 0; i < ARRAY_PIXELS; i++ ){
+
+                        if( ptr[i] != expected[i] ){
+
+                            CHECK( 0, "%s attr %d obj %d src %d pixel %d: %u != %u",
+                                   neg ? "sub" : "add", attrs[a], obj, src, i, ptr[i], expected[i] );
+                            break;
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
+// the reciprocal divide must be exact for every 16 bit dividend
+static void test_reciprocal_div( void ){
+
+    for( uint32_t d = 2; d <= 65535; d++ ){
+
+        // every divisor up to 1024, then a spread of larger ones
+        if( ( d > 1024 ) && ( ( d % 251 ) != 0 ) && ( d != 65535 ) && ( ( d & ( d - 1 ) ) != 0 ) ){
+
+            continue;
+        }
+
+        uint32_t m = _gfx_u32_reciprocal( d );
+
+        for( uint32_t a = 0; a <= 65535; a++ ){
+
+            if( ( ( (uint64_t)a * m ) >> 32 ) != ( a / d ) ){
+
+                CHECK( 0, "%u / %u", a, d );
+                break;
+            }
+        }
+    }
+}
+
+static double elapsed_ns( struct timespec *start ){
+
+    struct timespec now;
+    clock_gettime( CLOCK_MONOTONIC, &now );
+
+    return ( now.tv_sec - start->tv_sec ) * 1e9 + ( now.tv_nsec - start->tv_nsec );
+}
+
+// host timing of the array ops over a full 320 pixel array.
+// informational only, nothing is checked.
+static void bench_array_ops( void ){
+
+    set_array_params();
+
+    struct timespec start;
+    uint32_t reps = 100000;
+    double pixel_ops = (double)reps * ARRAY_PIXELS;
+
+    clock_gettime( CLOCK_MONOTONIC, &start );
+    for( uint32_t i = 0; i < reps; i++ ){
+
+        gfx_v_array_add( 0, PIX_ATTR_VAL, 100 );
+    }
+    printf( "pixels.val += 100:   %.2f ns/pixel\n", elapsed_ns( &start ) / pixel_ops );
+
+    clock_gettime( CLOCK_MONOTONIC, &start );
+    for( uint32_t i = 0; i < reps; i++ ){
+
+        gfx_v_array_add( 0, PIX_ATTR_HUE, 100 );
+    }
+    printf( "pixels.hue += 100:   %.2f ns/pixel\n", elapsed_ns( &start ) / pixel_ops );
+
+    clock_gettime( CLOCK_MONOTONIC, &start );
+    for( uint32_t i = 0; i < reps; i++ ){
+
+        gfx_v_array_move( 0, PIX_ATTR_VAL, 60000 );
+    }
+    printf( "pixels.val = 60000:  %.2f ns/pixel\n", elapsed_ns( &start ) / pixel_ops );
+
+    clock_gettime( CLOCK_MONOTONIC, &start );
+    for( uint32_t i = 0; i < reps; i++ ){
+
+        gfx_v_array_mul( 0, PIX_ATTR_VAL, 2 );
+    }
+    printf( "pixels.val *= 2:     %.2f ns/pixel\n", elapsed_ns( &start ) / pixel_ops );
+
+    clock_gettime( CLOCK_MONOTONIC, &start );
+    for( uint32_t i = 0; i < reps; i++ ){
+
+        gfx_v_array_div( 0, PIX_ATTR_VAL, 3 );
+    }
+    printf( "pixels.val /= 3:     %.2f ns/pixel\n", elapsed_ns( &start ) / pixel_ops );
+}
+
+
+int main( void ){
+
+    srand( 11 );
+
+    gfxlib_v_init();
+
+    test_dimmer_curve_exact();
+    test_sync_exact();
+    test_sync_fast_error();
+    test_array_add_sub();
+    test_reciprocal_div();
+
+    bench_array_ops();
+
+    if( failures > 0 ){
+
+        printf( "%d failures\n", failures );
+
+        return 1;
+    }
+
+    printf( "all tests passed\n" );
+
+    return 0;
+}
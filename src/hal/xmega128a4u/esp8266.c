@@ -114,6 +114,15 @@ static uint16_t intf_max_time;
 static uint16_t vm_max_time;
 static uint16_t wifi_max_time;
 static uint16_t mem_max_time;
+static uint32_t wifi_comm_tx_bytes;
+static uint32_t wifi_vm_kv_sent;
+static uint32_t wifi_vm_kv_suppressed;
+static uint32_t wifi_udp_rx_bytes;
+static uint16_t wifi_udp_rx_max_time;
+
+// local UDP receive stats
+static uint32_t rx_udp_copy_bytes;
+static uint16_t rx_udp_max_time;
 
 
 static uint16_t wifi_version;
@@ -123,6 +132,7 @@ static uint8_t next_msg_id;
 static netmsg_t rx_netmsg;
 static uint16_t rx_netmsg_index;
 static uint16_t rx_netmsg_crc;
+static uint16_t rx_netmsg_partial_crc;
 
 static uint8_t router;
 
@@ -171,6 +181,15 @@ KV_SECTION_META kv_meta_t wifi_info_kv[] = {
     { SAPPHIRE_TYPE_UINT16,        0, 0, &vm_max_time,                      0,   "wifi_proc_vm_max_time" },
     { SAPPHIRE_TYPE_UINT16,        0, 0, &wifi_max_time,                    0,   "wifi_proc_wifi_max_time" },
     { SAPPHIRE_TYPE_UINT16,        0, 0, &mem_max_time,                     0,   "wifi_proc_mem_max_time" },
+
+    { SAPPHIRE_TYPE_UINT32,        0, 0, &wifi_comm_tx_bytes,               0,   "wifi_comm_tx_bytes" },
+    { SAPPHIRE_TYPE_UINT32,        0, 0, &wifi_vm_kv_sent,                  0,   "wifi_vm_kv_sent" },
+    { SAPPHIRE_TYPE_UINT32,        0, 0, &wifi_vm_kv_suppressed,            0,   "wifi_vm_kv_suppressed" },
+
+    { SAPPHIRE_TYPE_UINT32,        0, 0, &wifi_udp_rx_bytes,                0,   "wifi_udp_rx_bytes" },
+    { SAPPHIRE_TYPE_UINT16,        0, 0, &wifi_udp_rx_max_time,             0,   "wifi_udp_rx_max_time" },
+    { SAPPHIRE_TYPE_UINT32,        0, 0, &rx_udp_copy_bytes,                0,   "wifi_rx_udp_copy_bytes" },
+    { SAPPHIRE_TYPE_UINT16,        0, 0, &rx_udp_max_time,                  0,   "wifi_rx_udp_max_time" },
 };
 
 
@@ -1650,97 +1669,33 @@ PT_END( pt );
 }
 
 
-static int8_t process_rx_data( void ){
-
-    if( wifi_i8_rx_data_received() < 0 ){
-
-        return -1;
-    }
-
-    
-    uint8_t buf[WIFI_UART_RX_BUF_SIZE];
-    wifi_data_header_t *header = (wifi_data_header_t *)&rx_buf[1];
-
-    memcpy( buf, &rx_buf[1], sizeof(wifi_data_header_t) + header->len );
-
-    wifi_v_set_rx_ready();
-
-    header = (wifi_data_header_t *)buf;
-    uint8_t *data = (uint8_t *)( header + 1 );
+static bool check_frame_crc( wifi_data_header_t *header ){
 
     uint16_t msg_crc = header->crc;
     header->crc = 0;
 
-
     if( crc_u16_block( (uint8_t *)header, header->len + sizeof(wifi_data_header_t) ) != msg_crc ){
 
         log_v_debug_P( PSTR("Wifi crc error") );
-        return -2;
+        return FALSE;
     }
 
+    return TRUE;
+}
 
-    if( header->data_id == WIFI_DATA_ID_STATUS ){
-
-        if( header->len != sizeof(wifi_msg_status_t) ){
-
-            goto len_error;
-        }
-
-        wifi_msg_status_t *msg = (wifi_msg_status_t *)data;
-
-        wifi_status_reg = msg->flags;
-    }  
-    else if( header->data_id == WIFI_DATA_ID_INFO ){
-
-        if( header->len != sizeof(wifi_msg_info_t) ){
-
-            goto len_error;
-        }
-
-        wifi_msg_info_t *msg = (wifi_msg_info_t *)data;
-
-        wifi_version            = msg->version;
-        wifi_rssi               = msg->rssi;
-        memcpy( wifi_mac, msg->mac, sizeof(wifi_mac) );
-
-        uint64_t current_device_id = 0;
-        cfg_i8_get( CFG_PARAM_DEVICE_ID, &current_device_id );
-        uint64_t device_id = 0;
-        memcpy( &device_id, wifi_mac, sizeof(wifi_mac) );
-
-        if( current_device_id != device_id ){
-
-            cfg_v_set( CFG_PARAM_DEVICE_ID, &device_id );
-        }
+// process a UDP header or data frame.
+// this runs in place in the receive buffer, so the payload is copied
+// once, straight into the netmsg data handle.
+static int8_t process_rx_udp( wifi_data_header_t *header ){
 
-        cfg_v_set( CFG_PARAM_IP_ADDRESS, &msg->ip );
-        cfg_v_set( CFG_PARAM_IP_SUBNET_MASK, &msg->subnet );
-        cfg_v_set( CFG_PARAM_DNS_SERVER, &msg->dns );
+    uint8_t *data = (uint8_t *)( header + 1 );
 
-        wifi_rx_udp_fifo_overruns   = msg->rx_udp_fifo_overruns;
-        wifi_rx_udp_port_overruns   = msg->rx_udp_port_overruns;
-        wifi_udp_received           = msg->udp_received;
-        wifi_udp_sent               = msg->udp_sent;
-        wifi_comm_errors            = msg->comm_errors;
-        mem_heap_peak               = msg->mem_heap_peak;
+    if( !check_frame_crc( header ) ){
 
-        intf_max_time               = msg->intf_max_time;
-        vm_max_time                 = msg->vm_max_time;
-        wifi_max_time               = msg->wifi_max_time;
-        mem_max_time                = msg->mem_max_time;
+        return -2;
     }
-    else if( header->data_id == WIFI_DATA_ID_DEBUG ){
-
-        if( header->len != sizeof(wifi_msg_debug_t) ){
 
-            goto len_error;
-        }
-
-        wifi_msg_debug_t *msg = (wifi_msg_debug_t *)data;
-
-        log_v_debug_P( PSTR("ESP free heap: %u"), msg->free_heap );
-    }
-    else if( header->data_id == WIFI_DATA_ID_UDP_HEADER ){
+    if( header->data_id == WIFI_DATA_ID_UDP_HEADER ){
 
         if( header->len != sizeof(wifi_msg_udp_header_t) ){
 
@@ -1796,10 +1751,11 @@ static int8_t process_rx_data( void ){
         state->raddr.ipaddr = msg->addr;
 
         rx_netmsg_crc       = msg->crc;
+        rx_netmsg_partial_crc = crc_u16_start();
 
         rx_netmsg_index = 0;
     }
-    else if( header->data_id == WIFI_DATA_ID_UDP_DATA ){
+    else{
 
         if( rx_netmsg <= 0 ){
 
@@ -1826,13 +1782,19 @@ static int8_t process_rx_data( void ){
 
         memcpy( &ptr[rx_netmsg_index], data, header->len );
 
+        rx_udp_copy_bytes += header->len;
+
+        // check the packet crc as it arrives, instead of making
+        // another pass over the whole packet at the end
+        rx_netmsg_partial_crc = crc_u16_partial_block( rx_netmsg_partial_crc, data, header->len );
+
         rx_netmsg_index += header->len;
 
         // message is complete
         if( rx_netmsg_index == total_len ){
 
             // check crc
-            if( crc_u16_block( ptr, total_len ) != rx_netmsg_crc ){
+            if( crc_u16_finish( rx_netmsg_partial_crc ) != rx_netmsg_crc ){
 
                 netmsg_v_release( rx_netmsg );
                 rx_netmsg = 0;
@@ -1846,6 +1808,137 @@ static int8_t process_rx_data( void ){
             rx_netmsg = 0;
         }   
     }
+
+    return 0;
+
+len_error:
+
+    log_v_debug_P( PSTR("Wifi len error") );
+    return -3;    
+
+error:
+    return -4;    
+}
+
+static int8_t process_rx_data( void ){
+
+    if( wifi_i8_rx_data_received() < 0 ){
+
+        return -1;
+    }
+
+    wifi_data_header_t *header = (wifi_data_header_t *)&rx_buf[1];
+
+    if( ( header->data_id == WIFI_DATA_ID_UDP_HEADER ) ||
+        ( header->data_id == WIFI_DATA_ID_UDP_DATA ) ){
+
+        uint32_t start = tmr_u32_get_system_time_us();
+
+        int8_t status = process_rx_udp( header );
+
+        // receive buffer is free now
+        wifi_v_set_rx_ready();
+
+        uint32_t elapsed = tmr_u32_elapsed_time_us( start );
+
+        if( elapsed > rx_udp_max_time ){
+
+            if( elapsed > UINT16_MAX ){
+
+                elapsed = UINT16_MAX;
+            }
+
+            rx_udp_max_time = elapsed;
+        }
+
+        return status;
+    }
+
+    // other messages are copied out so the receive buffer can be
+    // released before they are processed
+    uint8_t buf[WIFI_UART_RX_BUF_SIZE];
+
+    memcpy( buf, &rx_buf[1], sizeof(wifi_data_header_t) + header->len );
+
+    wifi_v_set_rx_ready();
+
+    header = (wifi_data_header_t *)buf;
+    uint8_t *data = (uint8_t *)( header + 1 );
+
+    if( !check_frame_crc( header ) ){
+
+        return -2;
+    }
+
+
+    if( header->data_id == WIFI_DATA_ID_STATUS ){
+
+        if( header->len != sizeof(wifi_msg_status_t) ){
+
+            goto len_error;
+        }
+
+        wifi_msg_status_t *msg = (wifi_msg_status_t *)data;
+
+        wifi_status_reg = msg->flags;
+    }  
+    else if( header->data_id == WIFI_DATA_ID_INFO ){
+
+        if( header->len != sizeof(wifi_msg_info_t) ){
+
+            goto len_error;
+        }
+
+        wifi_msg_info_t *msg = (wifi_msg_info_t *)data;
+
+        wifi_version            = msg->version;
+        wifi_rssi               = msg->rssi;
+        memcpy( wifi_mac, msg->mac, sizeof(wifi_mac) );
+
+        uint64_t current_device_id = 0;
+        cfg_i8_get( CFG_PARAM_DEVICE_ID, &current_device_id );
+        uint64_t device_id = 0;
+        memcpy( &device_id, wifi_mac, sizeof(wifi_mac) );
+
+        if( current_device_id != device_id ){
+
+            cfg_v_set( CFG_PARAM_DEVICE_ID, &device_id );
+        }
+
+        cfg_v_set( CFG_PARAM_IP_ADDRESS, &msg->ip );
+        cfg_v_set( CFG_PARAM_IP_SUBNET_MASK, &msg->subnet );
+        cfg_v_set( CFG_PARAM_DNS_SERVER, &msg->dns );
+
+        wifi_rx_udp_fifo_overruns   = msg->rx_udp_fifo_overruns;
+        wifi_rx_udp_port_overruns   = msg->rx_udp_port_overruns;
+        wifi_udp_received           = msg->udp_received;
+        wifi_udp_sent               = msg->udp_sent;
+        wifi_comm_errors            = msg->comm_errors;
+        mem_heap_peak               = msg->mem_heap_peak;
+
+        intf_max_time               = msg->intf_max_time;
+        vm_max_time                 = msg->vm_max_time;
+        wifi_max_time               = msg->wifi_max_time;
+        mem_max_time                = msg->mem_max_time;
+
+        wifi_comm_tx_bytes          = msg->comm_tx_bytes;
+        wifi_vm_kv_sent             = msg->vm_kv_sent;
+        wifi_vm_kv_suppressed       = msg->vm_kv_suppressed;
+
+        wifi_udp_rx_bytes           = msg->udp_rx_bytes;
+        wifi_udp_rx_max_time        = msg->udp_rx_max_time;
+    }
+    else if( header->data_id == WIFI_DATA_ID_DEBUG ){
+
+        if( header->len != sizeof(wifi_msg_debug_t) ){
+
+            goto len_error;
+        }
+
+        wifi_msg_debug_t *msg = (wifi_msg_debug_t *)data;
+
+        log_v_debug_P( PSTR("ESP free heap: %u"), msg->free_heap );
+    }
     // else if( header->data_id == WIFI_DATA_ID_WIFI_SCAN_RESULTS ){
     
     //     if( wifi_networks_handle < 0 ){        
@@ -1877,9 +1970,6 @@ len_error:
 
     log_v_debug_P( PSTR("Wifi len error") );
     return -3;    
-
-error:
-    return -4;    
 }
 
 
@@ -41,6 +41,9 @@
 // #define ENABLE_POWER
 #define ENABLE_USB
 // #define ENABLE_WIFI_USB_LOADER
+// double buffered pixel frames, costs MAX_PIXELS * 4 bytes of SRAM.
+// off until heap headroom has been measured on hardware.
+// #define ENABLE_PIX_DOUBLE_BUFFER
 
 // list
 // #define ENABLE_LIST_ATOMIC
@@ -49,8 +52,15 @@
 #define MAX_MEM_HANDLES         64
 #define MEM_MAX_STACK           1024
 
+// key value
+// RAM copy of the KV hash index, off until heap headroom has been
+// measured.  needs about 9 bytes per firmware key.
+#define KV_RAM_INDEX_BUDGET     0
+
 // flash fs
 #define FLASH_FS_MAX_USER_FILES 24
+#define FFS_PAGE_CACHE_SIZE     3
+#define FFS_BLOCK_MAP_CACHE_SIZE 2
 
 // virtual fs
 #define FS_MAX_VIRTUAL_FILES 16
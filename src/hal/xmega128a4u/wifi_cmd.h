@@ -96,6 +96,11 @@ typedef struct __attribute__((packed)){
     uint16_t vm_max_time;
     uint16_t wifi_max_time;
     uint16_t mem_max_time;
+    uint32_t comm_tx_bytes;
+    uint32_t vm_kv_sent;
+    uint32_t vm_kv_suppressed;
+    uint32_t udp_rx_bytes;          // UDP payload bytes received
+    uint16_t udp_rx_max_time;       // longest time to receive one packet, in microseconds
 } wifi_msg_info_t;
 #define WIFI_DATA_ID_INFO               0x03
 
@@ -37,18 +37,42 @@ static int32_t trigger = 0;
 
 static mem_handle_t trigger_index_handle = -1;
 static file_t f = -1;
+static uint16_t file_version;
+static uint32_t rules_pos;
+
+typedef struct{
+    uint16_t offset;
+    uint16_t last_used;
+    mem_handle_t handle;
+} rule_cache_entry_t;
+
+static rule_cache_entry_t rule_cache[AUTOMATON_RULE_CACHE_SLOTS];
+static uint16_t rule_cache_size;
+static uint16_t rule_cache_clock;
+static uint32_t rule_cache_hits;
+static uint32_t rule_cache_misses;
 
 KV_SECTION_META kv_meta_t automaton_info_kv[] = {
     { SAPPHIRE_TYPE_INT8,      0, 0,                   &automaton_status,    0,   "automaton_status" },
     { SAPPHIRE_TYPE_BOOL,      0, 0,                   &automaton_enable,    0,   "automaton_enable" },
+    { SAPPHIRE_TYPE_UINT16,    0, KV_FLAGS_READ_ONLY,  &rule_cache_size,     0,   "automaton_cache_size" },
+    { SAPPHIRE_TYPE_UINT32,    0, KV_FLAGS_READ_ONLY,  &rule_cache_hits,     0,   "automaton_cache_hits" },
+    { SAPPHIRE_TYPE_UINT32,    0, KV_FLAGS_READ_ONLY,  &rule_cache_misses,   0,   "automaton_cache_misses" },
 };
 
 
 PT_THREAD( automaton_thread( pt_t *pt, void *state ) );
 PT_THREAD( automaton_clock_thread( pt_t *pt, void *state ) );
 
+static void _auto_v_flush_rule_cache( void );
+
 void auto_v_init( void ){
 
+    for( uint8_t i = 0; i < cnt_of_array(rule_cache); i++ ){
+
+        rule_cache[i].handle = -1;
+    }
+
     if( sys_u8_get_mode() == SYS_MODE_SAFE ){
 
         return;
@@ -124,7 +148,11 @@ int8_t _auto_i8_load_trigger_index( void ){
         status = -3;
         goto end;
     }
-    
+
+    // rules follow the trigger index
+    rules_pos = pos + index_size;
+    file_version = fs_u16_get_version( f );
+
     status = 0;
 
 end:
@@ -142,6 +170,8 @@ int8_t _auto_i8_load_file( void ){
     // delete existing database entries
     kvdb_v_delete_tag( AUTOMATON_KV_TAG );
 
+    _auto_v_flush_rule_cache();
+
 
     f = fs_f_open_P( PSTR("automaton.auto"), FS_MODE_READ_ONLY );
 
@@ -260,56 +290,173 @@ end:
 // elapsed = tmr_u64_elapsed_time_us( elapsed );
 
 
-int8_t _auto_i8_process_rule( uint16_t index ){
+static void _auto_v_evict_rule( uint8_t slot ){
 
-    if( f < 0 ){
+    if( rule_cache[slot].handle < 0 ){
 
-        return -1;
+        return;
     }
 
-    fs_v_seek( f, 0 );
+    rule_cache_size -= mem2_u16_get_size( rule_cache[slot].handle );
 
-    int8_t status = -1;
+    mem2_v_free( rule_cache[slot].handle );
+    rule_cache[slot].handle = -1;
+}
 
-    automaton_file_t header;
+static void _auto_v_flush_rule_cache( void ){
 
-    if( fs_i16_read( f, (uint8_t *)&header, sizeof(header) ) < 0 ){
+    for( uint8_t i = 0; i < cnt_of_array(rule_cache); i++ ){
 
-        goto end;
+        _auto_v_evict_rule( i );
     }
 
-    // verify magic number
-    if( header.magic != AUTOMATON_FILE_MAGIC ){
+    rule_cache_size = 0;
+}
 
-        status = -1;
+// evict least recently used rules until there is a free slot and room
+// for len more bytes.  returns the free slot.
+static uint8_t _auto_u8_make_room( uint16_t len ){
 
-        goto end;
+    while(1){
+
+        int8_t free_slot = -1;
+        int8_t lru_slot = -1;
+
+        for( uint8_t i = 0; i < cnt_of_array(rule_cache); i++ ){
+
+            if( rule_cache[i].handle < 0 ){
+
+                free_slot = i;
+            }
+            else if( ( lru_slot < 0 ) ||
+                     ( (uint16_t)( rule_cache_clock - rule_cache[i].last_used ) >
+                       (uint16_t)( rule_cache_clock - rule_cache[lru_slot].last_used ) ) ){
+
+                lru_slot = i;
+            }
+        }
+
+        if( ( free_slot >= 0 ) &&
+            ( ( rule_cache_size + len ) <= AUTOMATON_RULE_CACHE_SIZE ) ){
+
+            return free_slot;
+        }
+
+        // len never exceeds the cache size, so there is always
+        // something to evict here
+        _auto_v_evict_rule( lru_slot );
     }
+}
 
-    int32_t registers[AUTOMATON_REG_COUNT];
-    uint8_t code[AUTOMATON_CODE_LEN];
-    memset( code, 0xff, sizeof(code) );
+// get a rule, from the cache if possible, otherwise from the file.
+// if cached is set to FALSE, the caller must free the returned handle.
+static mem_handle_t _auto_h_get_rule( uint16_t offset, bool *cached ){
 
-    // skip to condition index
-    uint32_t pos = sizeof(header) + 
-                   ( header.var_len * sizeof(automaton_var_t) ) +
-                   ( header.send_len * sizeof(automaton_link_t) ) +
-                   ( header.recv_len * sizeof(automaton_link_t) ) +
-                   ( header.trigger_index_len * sizeof(automaton_trigger_index_t) ) +
-                   index;
+    for( uint8_t i = 0; i < cnt_of_array(rule_cache); i++ ){
 
-    fs_v_seek( f, pos );
+        if( ( rule_cache[i].handle >= 0 ) && ( rule_cache[i].offset == offset ) ){
+
+            rule_cache_hits++;
+            rule_cache[i].last_used = ++rule_cache_clock;
+            *cached = TRUE;
+
+            return rule_cache[i].handle;
+        }
+    }
+
+    rule_cache_misses++;
+
+    fs_v_seek( f, rules_pos + offset );
 
     // read magic to verify we got to the right place
     automaton_rule_t rule;
-    fs_i16_read( f, (uint8_t *)&rule, sizeof(rule) );
+
+    if( fs_i16_read( f, (uint8_t *)&rule, sizeof(rule) ) != sizeof(rule) ){
+
+        return -2;
+    }
 
     if( rule.magic != AUTOMATON_RULE_MAGIC ){
 
-        status = -2;
+        return -2;
+    }
+
+    uint16_t len = sizeof(rule) +
+                   ( rule.condition_data_len * sizeof(int32_t) ) +
+                   ( rule.condition_kv_len * sizeof(automaton_kv_load_t) ) +
+                   rule.condition_code_len +
+                   ( rule.action_data_len * sizeof(int32_t) ) +
+                   ( rule.action_kv_len * sizeof(automaton_kv_load_t) ) +
+                   rule.action_code_len;
+
+    int8_t slot = -1;
+
+    if( len <= AUTOMATON_RULE_CACHE_SIZE ){
+
+        slot = _auto_u8_make_room( len );
+    }
+
+    mem_handle_t h = mem2_h_alloc( len );
+
+    if( h < 0 ){
+
+        return -10;
+    }
+
+    uint8_t *ptr = mem2_vp_get_ptr( h );
+
+    memcpy( ptr, &rule, sizeof(rule) );
+
+    if( fs_i16_read( f, ptr + sizeof(rule), len - sizeof(rule) ) != (int16_t)( len - sizeof(rule) ) ){
+
+        mem2_v_free( h );
+
+        return -4;
+    }
+
+    *cached = FALSE;
+
+    if( slot >= 0 ){
+
+        rule_cache[slot].offset = offset;
+        rule_cache[slot].last_used = ++rule_cache_clock;
+        rule_cache[slot].handle = h;
+        rule_cache_size += len;
+
+        *cached = TRUE;
+    }
+
+    return h;
+}
+
+int8_t _auto_i8_process_rule( uint16_t index ){
+
+    if( f < 0 ){
+
+        return -1;
+    }
+
+    int8_t status = -1;
+    bool cached = FALSE;
+
+    mem_handle_t h = _auto_h_get_rule( index, &cached );
+
+    if( h < 0 ){
+
+        status = h;
         goto end;
     }
 
+    int32_t registers[AUTOMATON_REG_COUNT];
+    uint8_t code[AUTOMATON_CODE_LEN];
+    memset( code, 0xff, sizeof(code) );
+
+    automaton_rule_t rule;
+    uint8_t *ptr = mem2_vp_get_ptr( h );
+
+    memcpy( &rule, ptr, sizeof(rule) );
+    ptr += sizeof(rule);
+
     
     // CONDITION
 
@@ -322,21 +469,15 @@ int8_t _auto_i8_process_rule( uint16_t index ){
         goto end;
     }
 
-    if( fs_i16_read( f, (uint8_t *)registers, ( rule.condition_data_len * sizeof(int32_t) ) ) < 0 ){
-
-        status = -4;
-        goto end;
-    }
+    memcpy( registers, ptr, rule.condition_data_len * sizeof(int32_t) );
+    ptr += rule.condition_data_len * sizeof(int32_t);
 
     // load KV
     for( uint8_t i = 0; i < rule.condition_kv_len; i++ ){
 
         automaton_kv_load_t kv_load;
-        if( fs_i16_read( f, (uint8_t *)&kv_load, sizeof(kv_load) ) < 0 ){
-
-            status = -5;
-            goto end;
-        }
+        memcpy( &kv_load, ptr, sizeof(kv_load) );
+        ptr += sizeof(kv_load);
 
         if( kv_load.addr >= cnt_of_array(registers) ){
 
@@ -359,11 +500,8 @@ int8_t _auto_i8_process_rule( uint16_t index ){
         goto end;
     }
 
-    if( fs_i16_read( f, code, rule.condition_code_len ) < 0 ){
-
-        status = -9;
-        goto end;
-    }
+    memcpy( code, ptr, rule.condition_code_len );
+    ptr += rule.condition_code_len;
 
     int32_t result = 0;
     int8_t vm_status = vm_i8_eval( code, registers, &result );
@@ -380,6 +518,7 @@ int8_t _auto_i8_process_rule( uint16_t index ){
 
     // load registers
     memset( registers, 0, sizeof(registers) );
+    memset( code, 0xff, sizeof(code) );
 
     if( rule.action_data_len > cnt_of_array(registers) ){
 
@@ -387,24 +526,18 @@ int8_t _auto_i8_process_rule( uint16_t index ){
         goto end;
     }
 
-    if( fs_i16_read( f, (uint8_t *)registers, ( rule.action_data_len * sizeof(int32_t) ) ) < 0 ){
-
-        status = -21;
-        goto end;
-    }
+    memcpy( registers, ptr, rule.action_data_len * sizeof(int32_t) );
+    ptr += rule.action_data_len * sizeof(int32_t);
 
     // load KV
-    // remember our file position, we'll come back to this
-    int32_t kv_load_pos = fs_i32_tell( f );
+    // remember our position, we'll come back to this
+    uint8_t *kv_load_ptr = ptr;
 
     for( uint8_t i = 0; i < rule.action_kv_len; i++ ){
 
         automaton_kv_load_t kv_load;
-        if( fs_i16_read( f, (uint8_t *)&kv_load, sizeof(kv_load) ) < 0 ){
-
-            status = -22;
-            goto end;
-        }
+        memcpy( &kv_load, ptr, sizeof(kv_load) );
+        ptr += sizeof(kv_load);
 
         if( kv_load.addr >= cnt_of_array(registers) ){
 
@@ -427,32 +560,19 @@ int8_t _auto_i8_process_rule( uint16_t index ){
         goto end;
     }
 
-    if( fs_i16_read( f, code, rule.action_code_len ) < 0 ){
-
-        status = -26;
-        goto end;
-    }
+    memcpy( code, ptr, rule.action_code_len );
 
     result = 0;
     vm_status = vm_i8_eval( code, registers, &result );
 
     // write KV to database
-    fs_v_seek( f, kv_load_pos );
+    ptr = kv_load_ptr;
 
     for( uint8_t i = 0; i < rule.action_kv_len; i++ ){
 
         automaton_kv_load_t kv_load;
-        if( fs_i16_read( f, (uint8_t *)&kv_load, sizeof(kv_load) ) < 0 ){
-
-            status = -27;
-            goto end;
-        }
-
-        if( kv_load.addr >= cnt_of_array(registers) ){
-
-            status = -28;
-            goto end;      
-        }
+        memcpy( &kv_load, ptr, sizeof(kv_load) );
+        ptr += sizeof(kv_load);
 
         // check if item changed
         int32_t data = 0;
@@ -480,6 +600,11 @@ int8_t _auto_i8_process_rule( uint16_t index ){
     status = 0;
 
 end:
+    if( ( h >= 0 ) && !cached ){
+
+        mem2_v_free( h );
+    }
+
     if( status < 0 ){
 
         log_v_error_P( PSTR("error: %d"), status );
@@ -527,13 +652,16 @@ PT_BEGIN( pt );
 
         while(1){
 
-            THREAD_WAIT_WHILE( pt, ( trigger == 0 ) && ( fs_i32_get_size( f ) >= 0 ) );
+            THREAD_WAIT_WHILE( pt, ( trigger == 0 ) && 
+                                   ( fs_i32_get_size( f ) >= 0 ) &&
+                                   ( fs_u16_get_version( f ) == file_version ) );
 
-            if( trigger == 0 ){
+            if( ( fs_i32_get_size( f ) < 0 ) ||
+                ( fs_u16_get_version( f ) != file_version ) ){
 
-                // this means our file got deleted
+                // this means our file got deleted or changed,
+                // the rule cache is no longer valid
                 goto restart;
-
             }
 
             // elapsed = tmr_u64_get_system_time_us();
@@ -593,6 +721,8 @@ restart:
             trigger_index_handle = -1;
         }
 
+        _auto_v_flush_rule_cache();
+
         f = -1;
 
         // purge all locally created links
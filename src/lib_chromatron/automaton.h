@@ -36,6 +36,12 @@
 #define AUTOMATON_MAX_ACTIVE_RULES  8
 #define AUTOMATON_CODE_LEN          192
 
+// compiled rules are cached in RAM so triggers do not need to read the file.
+// least recently used rules are evicted when either limit is reached, and
+// are read back from the file the next time they fire.
+#define AUTOMATON_RULE_CACHE_SLOTS  8
+#define AUTOMATON_RULE_CACHE_SIZE   512 // bytes
+
 #define AUTOMATON_FILE_MAGIC        0x4F545541  // 'AUTO'
 #define AUTOMATON_RULE_MAGIC        0x454C5552  // 'RULE'
 #define AUTOMATON_VERSION           1
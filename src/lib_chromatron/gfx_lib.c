@@ -21,6 +21,7 @@
 // </license>
 
 #include <inttypes.h>
+#include <string.h>
 
 #ifdef ESP8266
 
@@ -38,9 +39,12 @@
 #define pgm_read_word(a) *a
 #endif
 
-static uint8_t array_red[MAX_PIXELS];
-static uint8_t array_green[MAX_PIXELS];
-static uint8_t array_blue[MAX_PIXELS];
+// output arrays are stored in the pixel driver's channel order
+// (pix_rgb_order), so the AVR side can stream them out unchanged.
+// array_ch0 holds the first channel on the wire, etc.
+static uint8_t array_ch0[MAX_PIXELS];
+static uint8_t array_ch1[MAX_PIXELS];
+static uint8_t array_ch2[MAX_PIXELS];
 static uint8_t array_misc[MAX_PIXELS];
 
 static uint16_t pix0_16bit_red;
@@ -64,6 +68,17 @@ static int16_t hue_step[MAX_PIXELS];
 static int16_t sat_step[MAX_PIXELS];
 static int16_t val_step[MAX_PIXELS];
 
+// bitmap of pixels the fader needs to look at: a fade is in progress, or a
+// target or fade time changed and the fader hasn't picked it up yet.
+// a pixel not in this set is at its target with all of its fader steps
+// cleared, so gfx_v_process_faders can skip it.
+#define FADER_ACTIVE_WORDS ( ( MAX_PIXELS + 31 ) / 32 )
+static uint32_t fader_active[FADER_ACTIVE_WORDS];
+
+// set whenever the HSV arrays, dimmer or output settings change.
+// gfx_v_sync_array skips the conversion when this is clear.
+static bool sync_needed = TRUE;
+
 static uint16_t pix_master_dimmer = 0;
 static uint16_t pix_sub_dimmer = 0;
 static uint16_t target_dimmer = 0;
@@ -71,6 +86,7 @@ static uint16_t current_dimmer = 0;
 static int16_t dimmer_step = 0;
 
 static uint8_t pix_mode;
+static uint8_t pix_rgb_order;
 static uint16_t pix_count;
 static uint16_t pix_size_x;
 static uint16_t pix_size_y;
@@ -89,11 +105,26 @@ static uint32_t scaled_virtual_array_length;
 static uint16_t gfx_frame_rate = 100;
 
 static uint8_t dimmer_curve = GFX_DIMMER_CURVE_DEFAULT;
+static uint8_t hsv_mode = GFX_HSV_MODE_EXACT;
 
 
 #define DIMMER_LOOKUP_SIZE 256
 static uint16_t dimmer_lookup[DIMMER_LOOKUP_SIZE];
 
+// per segment slope of dimmer_lookup, so the curve can be interpolated
+// without a divide.
+static uint16_t dimmer_slope[DIMMER_LOOKUP_SIZE];
+
+// fast mode: dimmer curve with current_dimmer already applied, indexed
+// directly by the upper 8 bits of val.
+static uint16_t dimmed_val_lookup[DIMMER_LOOKUP_SIZE];
+static uint16_t dimmed_val_lookup_dimmer;
+static bool dimmed_val_lookup_valid;
+
+// fast mode: fully saturated RGB for each of 256 hue steps
+#define HUE_LOOKUP_SIZE 256
+static uint16_t hue_lookup[HUE_LOOKUP_SIZE][3];
+
 
 // smootherstep is an 8 bit lookup table for the function:
 // 6 * pow(x, 5) - 15 * pow(x, 4) + 10 * pow(x, 3)
@@ -107,6 +138,33 @@ static uint8_t noise_table[NOISE_TABLE_SIZE];
 static int32_t kv_test_key;
 
 
+static inline void _gfx_v_set_fader_active( uint16_t index ){
+
+    fader_active[index / 32] |= (uint32_t)1 << ( index % 32 );
+}
+
+static void _gfx_v_set_fader_active_range( uint16_t start, uint16_t len ){
+
+    while( len > 0 ){
+
+        // fill whole words when we can
+        if( ( ( start % 32 ) == 0 ) && ( len >= 32 ) ){
+
+            fader_active[start / 32] = 0xffffffff;
+
+            start += 32;
+            len -= 32;
+        }
+        else{
+
+            _gfx_v_set_fader_active( start );
+
+            start++;
+            len--;
+        }
+    }
+}
+
 static void compute_dimmer_lookup( void ){
 
     float curve_exp = (float)dimmer_curve / 64.0;
@@ -117,6 +175,31 @@ static void compute_dimmer_lookup( void ){
 
         dimmer_lookup[i] = (uint16_t)( pow( input, curve_exp ) * 65535.0 );
     }
+
+    for( uint32_t i = 0; i < DIMMER_LOOKUP_SIZE - 1; i++ ){
+
+        dimmer_slope[i] = dimmer_lookup[i + 1] - dimmer_lookup[i];
+    }
+
+    dimmed_val_lookup_valid = FALSE;
+}
+
+static void compute_hue_lookup( void ){
+
+    for( uint32_t i = 0; i < HUE_LOOKUP_SIZE; i++ ){
+
+        // sample the middle of each step
+        uint16_t h = ( i << 8 ) + 128;
+
+        gfx_v_hsv_to_rgb(
+            h,
+            65535,
+            65535,
+            &hue_lookup[i][0],
+            &hue_lookup[i][1],
+            &hue_lookup[i][2]
+        );
+    }
 }
 
 static void setup_master_array( void ){
@@ -260,6 +343,7 @@ void gfx_v_set_params( gfx_params_t *params ){
     pix_interleave_x        = params->interleave_x;
     pix_transpose           = params->transpose;
     pix_mode                = params->pix_mode;
+    pix_rgb_order           = params->pix_rgb_order;
     global_hs_fade          = params->hs_fade;
     global_v_fade           = params->v_fade;
     pix_master_dimmer       = params->master_dimmer;
@@ -272,6 +356,13 @@ void gfx_v_set_params( gfx_params_t *params ){
 
     setup_master_array();
 
+    hsv_mode                = params->hsv_mode;
+
+    if( hsv_mode > GFX_HSV_MODE_FAST ){
+
+        hsv_mode = GFX_HSV_MODE_EXACT;
+    }
+
     // only run if dimmer curve is changing
     if( old_dimmer_curve != dimmer_curve ){
         
@@ -282,6 +373,8 @@ void gfx_v_set_params( gfx_params_t *params ){
 
     sync_db();
 
+    sync_needed = TRUE;
+
     virtual_array_sub_position      = virtual_array_start / pix_count;
     scaled_pix_count                = (uint32_t)pix_count * 65536;
     scaled_virtual_array_length     = (uint32_t)virtual_array_length * 65536;
@@ -304,6 +397,8 @@ void gfx_v_get_params( gfx_params_t *params ){
     params->dimmer_curve            = dimmer_curve;
     params->virtual_array_start     = virtual_array_start;
     params->virtual_array_length    = virtual_array_length;
+    params->hsv_mode                = hsv_mode;
+    params->pix_rgb_order           = pix_rgb_order;
 }
 
 int32_t gfx_i32_lib_call( catbus_hash_t32 func_hash, int32_t *params, uint16_t param_len ){
@@ -362,6 +457,8 @@ int32_t gfx_i32_get_obj_attr( uint8_t obj, uint8_t attr, uint8_t addr ){
 void gfx_v_set_pix_count( uint16_t setting ){
 
     pix_count = setting;
+
+    sync_needed = TRUE;
 }
 
 uint16_t gfx_u16_get_pix_count( void ){
@@ -465,6 +562,8 @@ void _gfx_v_set_hue_1d( uint16_t h, uint16_t index ){
 
     // reset fader, this will trigger the fader process to recalculate the fader steps.
     hue_step[index] = 0;
+
+    _gfx_v_set_fader_active( index );
 }
 
 void _gfx_v_set_sat_1d( uint16_t s, uint16_t index ){
@@ -479,6 +578,8 @@ void _gfx_v_set_sat_1d( uint16_t s, uint16_t index ){
     
     // reset fader, this will trigger the fader process to recalculate the fader steps.
     sat_step[index] = 0;
+
+    _gfx_v_set_fader_active( index );
 }
 
 void _gfx_v_set_val_1d( uint16_t v, uint16_t index ){
@@ -493,6 +594,8 @@ void _gfx_v_set_val_1d( uint16_t v, uint16_t index ){
 
     // reset fader, this will trigger the fader process to recalculate the fader steps.
     val_step[index] = 0;
+
+    _gfx_v_set_fader_active( index );
 }
 
 void _gfx_v_set_hs_fade_1d( uint16_t a, uint16_t index ){
@@ -508,6 +611,8 @@ void _gfx_v_set_hs_fade_1d( uint16_t a, uint16_t index ){
     // reset fader, this will trigger the fader process to recalculate the fader steps.
     hue_step[index] = 0;
     sat_step[index] = 0;
+
+    _gfx_v_set_fader_active( index );
 }
 
 void _gfx_v_set_v_fade_1d( uint16_t a, uint16_t index ){
@@ -522,6 +627,8 @@ void _gfx_v_set_v_fade_1d( uint16_t a, uint16_t index ){
 
     // reset fader, this will trigger the fader process to recalculate the fader steps.
     val_step[index] = 0;
+
+    _gfx_v_set_fader_active( index );
 }
 
 
@@ -554,351 +661,532 @@ static uint16_t* _gfx_u16p_get_array_ptr( uint8_t attr ){
     return ptr;
 }
 
-void gfx_v_array_move( uint8_t obj, uint8_t attr, int32_t src ){
+// the pixel arrays are processed two 16 bit pixels at a time in a 32 bit
+// word.  may_alias tells the compiler these words overlap the uint16_t arrays.
+typedef uint32_t __attribute__((__may_alias__)) gfx_pixel_pair_t;
+
+#define PAIR_MSB        0x80008000
+#define PAIR_LOW        0x7fff7fff
+
+typedef void ( *gfx_array_kernel_t )( uint16_t *ptr, uint16_t len, int32_t src );
+
+static void _gfx_v_reset_fader_steps( uint8_t attr, uint16_t start, uint16_t len ){
+
+    // reset faders, this will trigger the fader process to recalculate the fader steps.
+    if( attr == PIX_ATTR_HUE ){
+
+        memset( &hue_step[start], 0, len * sizeof(hue_step[0]) );
+    }
+    else if( attr == PIX_ATTR_SAT ){
+
+        memset( &sat_step[start], 0, len * sizeof(sat_step[0]) );
+    }
+    else if( attr == PIX_ATTR_HS_FADE ){
+
+        memset( &hue_step[start], 0, len * sizeof(hue_step[0]) );
+        memset( &sat_step[start], 0, len * sizeof(sat_step[0]) );
+    }
+    else{
+
+        // val and v_fade
+        memset( &val_step[start], 0, len * sizeof(val_step[0]) );
+    }
+}
+
+// runs kernel over the pixels in obj.
+// arrays that run past the end of the pixel buffer wrap around to 0, so
+// the kernel is called once per contiguous segment.
+static void _gfx_v_array_apply( uint8_t obj, uint8_t attr, gfx_array_kernel_t kernel, int32_t src ){
 
     if( obj >= pix_array_count ){
 
         return;
     }
 
-    for( uint16_t i = 0; i < pix_arrays[obj].count; i++ ){
+    uint16_t *ptr = _gfx_u16p_get_array_ptr( attr );
 
-        uint16_t index = i + pix_arrays[obj].index;
+    uint16_t start = pix_arrays[obj].index % pix_count;
+    uint16_t remaining = pix_arrays[obj].count;
 
-        index %= pix_count;
+    while( remaining > 0 ){
 
-        int32_t a = src;
+        uint16_t len = pix_count - start;
 
-        if( attr == PIX_ATTR_HUE ){
+        if( len > remaining ){
 
-            a %= 65536;
+            len = remaining;
         }
-        else{
 
-            if( a > 65535 ){
+        kernel( ptr + start, len, src );
 
-                a = 65535;
-            }
-            else if( a < 0 ){
+        _gfx_v_reset_fader_steps( attr, start, len );
+        _gfx_v_set_fader_active_range( start, len );
 
-                a = 0;
-            }
-        }
+        remaining -= len;
+        start = 0;
+    }
+}
 
-        if( attr == PIX_ATTR_HUE ){
+static void _gfx_v_kernel_fill( uint16_t *ptr, uint16_t len, int32_t src ){
 
-            _gfx_v_set_hue_1d( a, index );
-        }
-        else if( attr == PIX_ATTR_SAT ){
+    uint16_t a = src;
 
-            _gfx_v_set_sat_1d( a, index );
-        }
-        else if( attr == PIX_ATTR_HS_FADE ){
+    if( ( ( (uint32_t)ptr & 0x03 ) != 0 ) && ( len > 0 ) ){
 
-            _gfx_v_set_hs_fade_1d( a, index );
-        }
-        else if( attr == PIX_ATTR_V_FADE ){
+        *ptr++ = a;
+        len--;
+    }
 
-            _gfx_v_set_v_fade_1d( a, index );
-        }   
-        else{
+    uint32_t pair = ( (uint32_t)a << 16 ) | a;
+    gfx_pixel_pair_t *p = (gfx_pixel_pair_t *)ptr;
+    uint16_t pairs = len / 2;
 
-            _gfx_v_set_val_1d( a, index );
-        }
+    while( pairs >= 2 ){
+
+        p[0] = pair;
+        p[1] = pair;
+
+        p += 2;
+        pairs -= 2;
+    }
+
+    if( pairs > 0 ){
+
+        *p++ = pair;
+    }
+
+    if( len & 1 ){
+
+        *(uint16_t *)p = a;
     }
 }
 
-void gfx_v_array_add( uint8_t obj, uint8_t attr, int32_t src ){
+static void _gfx_v_kernel_add_wrap( uint16_t *ptr, uint16_t len, int32_t src ){
 
-    if( obj >= pix_array_count ){
+    uint16_t a = src;
 
-        return;
+    if( ( ( (uint32_t)ptr & 0x03 ) != 0 ) && ( len > 0 ) ){
+
+        *ptr++ += a;
+        len--;
     }
 
-    uint16_t *ptr = _gfx_u16p_get_array_ptr( attr );
-    
-    for( uint16_t i = 0; i < pix_arrays[obj].count; i++ ){
+    uint32_t y = ( (uint32_t)a << 16 ) | a;
+    gfx_pixel_pair_t *p = (gfx_pixel_pair_t *)ptr;
+    uint16_t pairs = len / 2;
 
-        uint16_t index = i + pix_arrays[obj].index;
+    while( pairs >= 2 ){
 
-        index %= pix_count;
+        uint32_t x0 = p[0];
+        uint32_t x1 = p[1];
 
-        int32_t a = *( ptr + index );
+        // add without carrying between lanes
+        p[0] = ( ( x0 & PAIR_LOW ) + ( y & PAIR_LOW ) ) ^ ( ( x0 ^ y ) & PAIR_MSB );
+        p[1] = ( ( x1 & PAIR_LOW ) + ( y & PAIR_LOW ) ) ^ ( ( x1 ^ y ) & PAIR_MSB );
 
-        a += src;
+        p += 2;
+        pairs -= 2;
+    }
 
-        if( attr == PIX_ATTR_HUE ){
+    if( pairs > 0 ){
 
-            a %= 65536;
-        }
-        else{
+        uint32_t x = *p;
 
-            if( a > 65535 ){
+        *p++ = ( ( x & PAIR_LOW ) + ( y & PAIR_LOW ) ) ^ ( ( x ^ y ) & PAIR_MSB );
+    }
 
-                a = 65535;
-            }
-            else if( a < 0 ){
+    if( len & 1 ){
 
-                a = 0;
-            }
-        }
+        *(uint16_t *)p += a;
+    }
+}
 
-        if( attr == PIX_ATTR_HUE ){
+static inline uint32_t _gfx_u32_add_sat_pair( uint32_t x, uint32_t y ){
 
-            _gfx_v_set_hue_1d( a, index );
-        }
-        else if( attr == PIX_ATTR_SAT ){
+    uint32_t t = ( ( x & PAIR_LOW ) + ( y & PAIR_LOW ) ) ^ ( ( x ^ y ) & PAIR_MSB );
+    uint32_t carry = ( ( x & y ) | ( ( x | y ) & ~t ) ) & PAIR_MSB;
 
-            _gfx_v_set_sat_1d( a, index );
-        }
-        else if( attr == PIX_ATTR_HS_FADE ){
+    // expand carry bits to 0xffff in each lane that overflowed
+    return t | ( ( carry >> 15 ) * 0xffff );
+}
 
-            _gfx_v_set_hs_fade_1d( a, index );
-        }
-        else if( attr == PIX_ATTR_V_FADE ){
+static inline uint32_t _gfx_u32_sub_sat_pair( uint32_t x, uint32_t y ){
 
-            _gfx_v_set_v_fade_1d( a, index );
-        }   
-        else{
+    uint32_t t = ( ( x | PAIR_MSB ) - ( y & PAIR_LOW ) ) ^ ( ( x ^ ~y ) & PAIR_MSB );
+    uint32_t borrow = ( ( ~x & y ) | ( ~( x ^ y ) & t ) ) & PAIR_MSB;
 
-            _gfx_v_set_val_1d( a, index );
-        }
+    // clear each lane that underflowed
+    return t & ~( ( borrow >> 15 ) * 0xffff );
+}
+
+// src must be 1 to 65534
+static void _gfx_v_kernel_add_sat( uint16_t *ptr, uint16_t len, int32_t src ){
+
+    if( ( ( (uint32_t)ptr & 0x03 ) != 0 ) && ( len > 0 ) ){
+
+        int32_t a = *ptr + src;
+
+        *ptr++ = a > 65535 ? 65535 : a;
+        len--;
+    }
+
+    uint32_t y = ( (uint32_t)src << 16 ) | (uint16_t)src;
+    gfx_pixel_pair_t *p = (gfx_pixel_pair_t *)ptr;
+    uint16_t pairs = len / 2;
+
+    while( pairs >= 2 ){
+
+        p[0] = _gfx_u32_add_sat_pair( p[0], y );
+        p[1] = _gfx_u32_add_sat_pair( p[1], y );
+
+        p += 2;
+        pairs -= 2;
+    }
+
+    if( pairs > 0 ){
+
+        *p = _gfx_u32_add_sat_pair( *p, y );
+        p++;
+    }
+
+    if( len & 1 ){
+
+        uint16_t *t = (uint16_t *)p;
+        int32_t a = *t + src;
+
+        *t = a > 65535 ? 65535 : a;
     }
 }
 
+// src must be 1 to 65534
+static void _gfx_v_kernel_sub_sat( uint16_t *ptr, uint16_t len, int32_t src ){
 
-void gfx_v_array_sub( uint8_t obj, uint8_t attr, int32_t src ){
+    if( ( ( (uint32_t)ptr & 0x03 ) != 0 ) && ( len > 0 ) ){
 
-    if( obj >= pix_array_count ){
+        int32_t a = *ptr - src;
 
-        return;
+        *ptr++ = a < 0 ? 0 : a;
+        len--;
     }
 
-    uint16_t *ptr = _gfx_u16p_get_array_ptr( attr );
-    
-    for( uint16_t i = 0; i < pix_arrays[obj].count; i++ ){
+    uint32_t y = ( (uint32_t)src << 16 ) | (uint16_t)src;
+    gfx_pixel_pair_t *p = (gfx_pixel_pair_t *)ptr;
+    uint16_t pairs = len / 2;
 
-        uint16_t index = i + pix_arrays[obj].index;
+    while( pairs >= 2 ){
 
-        index %= pix_count;
+        p[0] = _gfx_u32_sub_sat_pair( p[0], y );
+        p[1] = _gfx_u32_sub_sat_pair( p[1], y );
 
-        int32_t a = *( ptr + index );
+        p += 2;
+        pairs -= 2;
+    }
 
-        a -= src;
+    if( pairs > 0 ){
 
-        if( attr == PIX_ATTR_HUE ){
+        *p = _gfx_u32_sub_sat_pair( *p, y );
+        p++;
+    }
 
-            a %= 65536;
-        }
-        else{
+    if( len & 1 ){
 
-            if( a > 65535 ){
+        uint16_t *t = (uint16_t *)p;
+        int32_t a = *t - src;
 
-                a = 65535;
-            }
-            else if( a < 0 ){
+        *t = a < 0 ? 0 : a;
+    }
+}
 
-                a = 0;
-            }
-        }
+static void _gfx_v_kernel_mul_wrap( uint16_t *ptr, uint16_t len, int32_t src ){
 
-        if( attr == PIX_ATTR_HUE ){
+    uint32_t m = src;
 
-            _gfx_v_set_hue_1d( a, index );
-        }
-        else if( attr == PIX_ATTR_SAT ){
+    while( len >= 2 ){
 
-            _gfx_v_set_sat_1d( a, index );
-        }
-        else if( attr == PIX_ATTR_HS_FADE ){
+        ptr[0] = ptr[0] * m;
+        ptr[1] = ptr[1] * m;
 
-            _gfx_v_set_hs_fade_1d( a, index );
-        }
-        else if( attr == PIX_ATTR_V_FADE ){
+        ptr += 2;
+        len -= 2;
+    }
 
-            _gfx_v_set_v_fade_1d( a, index );
-        }   
-        else{
+    if( len > 0 ){
 
-            _gfx_v_set_val_1d( a, index );
-        }
+        *ptr = *ptr * m;
     }
 }
 
+// src must be 1 to 65536
+static void _gfx_v_kernel_mul_sat( uint16_t *ptr, uint16_t len, int32_t src ){
 
-void gfx_v_array_mul( uint8_t obj, uint8_t attr, int32_t src ){
+    uint32_t m = src;
 
-    if( obj >= pix_array_count ){
+    while( len >= 2 ){
 
-        return;
+        uint32_t a0 = ptr[0] * m;
+        uint32_t a1 = ptr[1] * m;
+
+        ptr[0] = a0 > 65535 ? 65535 : a0;
+        ptr[1] = a1 > 65535 ? 65535 : a1;
+
+        ptr += 2;
+        len -= 2;
     }
 
-    uint16_t *ptr = _gfx_u16p_get_array_ptr( attr );
-    
-    for( uint16_t i = 0; i < pix_arrays[obj].count; i++ ){
+    if( len > 0 ){
 
-        uint16_t index = i + pix_arrays[obj].index;
+        uint32_t a = *ptr * m;
 
-        index %= pix_count;
+        *ptr = a > 65535 ? 65535 : a;
+    }
+}
 
-        int32_t a = *( ptr + index );
+// reciprocal for dividing 16 bit values by d, d must be 2 to 65535.
+// ( a * m ) >> 32 is exact for all a < 65536, since the rounding error
+// in m is less than d.
+static uint32_t _gfx_u32_reciprocal( uint32_t d ){
 
-        a *= src;
+    return ( 0xffffffff / d ) + 1;
+}
 
-        if( attr == PIX_ATTR_HUE ){
+// src must be 2 to 65535.
+// the result is negated (and wrapped) for the hue divide by a negative.
+static void _gfx_v_kernel_div( uint16_t *ptr, uint16_t len, int32_t src ){
 
-            a %= 65536;
-        }
-        else{
+    uint32_t m = _gfx_u32_reciprocal( src );
 
-            if( a > 65535 ){
+    while( len >= 2 ){
 
-                a = 65535;
-            }
-            else if( a < 0 ){
+        ptr[0] = ( (uint64_t)ptr[0] * m ) >> 32;
+        ptr[1] = ( (uint64_t)ptr[1] * m ) >> 32;
 
-                a = 0;
-            }
-        }
+        ptr += 2;
+        len -= 2;
+    }
 
-        if( attr == PIX_ATTR_HUE ){
+    if( len > 0 ){
 
-            _gfx_v_set_hue_1d( a, index );
-        }
-        else if( attr == PIX_ATTR_SAT ){
+        *ptr = ( (uint64_t)*ptr * m ) >> 32;
+    }
+}
 
-            _gfx_v_set_sat_1d( a, index );
-        }
-        else if( attr == PIX_ATTR_HS_FADE ){
+static void _gfx_v_kernel_div_neg_wrap( uint16_t *ptr, uint16_t len, int32_t src ){
 
-            _gfx_v_set_hs_fade_1d( a, index );
-        }
-        else if( attr == PIX_ATTR_V_FADE ){
+    uint32_t m = _gfx_u32_reciprocal( src );
 
-            _gfx_v_set_v_fade_1d( a, index );
-        }   
-        else{
+    while( len > 0 ){
 
-            _gfx_v_set_val_1d( a, index );
-        }
+        *ptr = -(uint16_t)( ( (uint64_t)*ptr * m ) >> 32 );
+
+        ptr++;
+        len--;
     }
 }
 
+static void _gfx_v_kernel_neg_wrap( uint16_t *ptr, uint16_t len, int32_t src ){
 
-void gfx_v_array_div( uint8_t obj, uint8_t attr, int32_t src ){
+    (void)src;
 
-    if( obj >= pix_array_count ){
+    while( len > 0 ){
 
-        return;
+        *ptr = -*ptr;
+
+        ptr++;
+        len--;
     }
+}
 
-    uint16_t *ptr = _gfx_u16p_get_array_ptr( attr );
-    
-    for( uint16_t i = 0; i < pix_arrays[obj].count; i++ ){
+static void _gfx_v_kernel_nop( uint16_t *ptr, uint16_t len, int32_t src ){
 
-        uint16_t index = i + pix_arrays[obj].index;
+    (void)ptr;
+    (void)len;
+    (void)src;
+}
 
-        index %= pix_count;
+// src must be 2 to 65535
+static void _gfx_v_kernel_mod( uint16_t *ptr, uint16_t len, int32_t src ){
 
-        int32_t a = *( ptr + index );
+    uint32_t d = src;
+    uint32_t m = _gfx_u32_reciprocal( d );
 
-        a /= src;
+    while( len >= 2 ){
 
-        if( attr == PIX_ATTR_HUE ){
+        uint32_t q0 = ( (uint64_t)ptr[0] * m ) >> 32;
+        uint32_t q1 = ( (uint64_t)ptr[1] * m ) >> 32;
 
-            a %= 65536;
-        }
-        else{
+        ptr[0] -= q0 * d;
+        ptr[1] -= q1 * d;
+
+        ptr += 2;
+        len -= 2;
+    }
 
-            if( a > 65535 ){
+    if( len > 0 ){
 
-                a = 65535;
-            }
-            else if( a < 0 ){
+        uint32_t q = ( (uint64_t)*ptr * m ) >> 32;
 
-                a = 0;
-            }
-        }
+        *ptr -= q * d;
+    }
+}
 
-        if( attr == PIX_ATTR_HUE ){
 
-            _gfx_v_set_hue_1d( a, index );
-        }
-        else if( attr == PIX_ATTR_SAT ){
+// hue wraps around the 16 bit range, all other attributes saturate at 0
+// and 65535.  the kernel for each operation is picked once per call.
 
-            _gfx_v_set_sat_1d( a, index );
+void gfx_v_array_move( uint8_t obj, uint8_t attr, int32_t src ){
+
+    if( attr != PIX_ATTR_HUE ){
+
+        if( src > 65535 ){
+
+            src = 65535;
         }
-        else if( attr == PIX_ATTR_HS_FADE ){
+        else if( src < 0 ){
 
-            _gfx_v_set_hs_fade_1d( a, index );
+            src = 0;
         }
-        else if( attr == PIX_ATTR_V_FADE ){
+    }
 
-            _gfx_v_set_v_fade_1d( a, index );
-        }   
-        else{
+    _gfx_v_array_apply( obj, attr, _gfx_v_kernel_fill, src );
+}
 
-            _gfx_v_set_val_1d( a, index );
-        }
+void gfx_v_array_add( uint8_t obj, uint8_t attr, int32_t src ){
+
+    if( attr == PIX_ATTR_HUE ){
+
+        _gfx_v_array_apply( obj, attr, _gfx_v_kernel_add_wrap, src );
+    }
+    else if( src >= 65535 ){
+
+        _gfx_v_array_apply( obj, attr, _gfx_v_kernel_fill, 65535 );
+    }
+    else if( src <= -65535 ){
+
+        _gfx_v_array_apply( obj, attr, _gfx_v_kernel_fill, 0 );
+    }
+    else if( src > 0 ){
+
+        _gfx_v_array_apply( obj, attr, _gfx_v_kernel_add_sat, src );
+    }
+    else if( src < 0 ){
+
+        _gfx_v_array_apply( obj, attr, _gfx_v_kernel_sub_sat, -src );
+    }
+    else{
+
+        // values don't change, but the faders still reset
+        _gfx_v_array_apply( obj, attr, _gfx_v_kernel_nop, 0 );
     }
 }
 
+void gfx_v_array_sub( uint8_t obj, uint8_t attr, int32_t src ){
 
-void gfx_v_array_mod( uint8_t obj, uint8_t attr, int32_t src ){
+    if( attr == PIX_ATTR_HUE ){
 
-    if( obj >= pix_array_count ){
+        _gfx_v_array_apply( obj, attr, _gfx_v_kernel_add_wrap, (uint16_t)( 0 - (uint32_t)src ) );
+    }
+    else if( src >= 65535 ){
 
-        return;
+        _gfx_v_array_apply( obj, attr, _gfx_v_kernel_fill, 0 );
     }
+    else if( src <= -65535 ){
 
-    uint16_t *ptr = _gfx_u16p_get_array_ptr( attr );
-    
-    for( uint16_t i = 0; i < pix_arrays[obj].count; i++ ){
+        _gfx_v_array_apply( obj, attr, _gfx_v_kernel_fill, 65535 );
+    }
+    else if( src > 0 ){
 
-        uint16_t index = i + pix_arrays[obj].index;
+        _gfx_v_array_apply( obj, attr, _gfx_v_kernel_sub_sat, src );
+    }
+    else if( src < 0 ){
 
-        index %= pix_count;
+        _gfx_v_array_apply( obj, attr, _gfx_v_kernel_add_sat, -src );
+    }
+    else{
 
-        int32_t a = *( ptr + index );
+        _gfx_v_array_apply( obj, attr, _gfx_v_kernel_nop, 0 );
+    }
+}
 
-        a %= src;
+void gfx_v_array_mul( uint8_t obj, uint8_t attr, int32_t src ){
 
-        if( attr == PIX_ATTR_HUE ){
+    if( attr == PIX_ATTR_HUE ){
 
-            a %= 65536;
-        }
-        else{
+        _gfx_v_array_apply( obj, attr, _gfx_v_kernel_mul_wrap, src );
+    }
+    else if( src <= 0 ){
 
-            if( a > 65535 ){
+        _gfx_v_array_apply( obj, attr, _gfx_v_kernel_fill, 0 );
+    }
+    else{
 
-                a = 65535;
-            }
-            else if( a < 0 ){
+        // anything above 65536 saturates the same as 65536
+        if( src > 65536 ){
 
-                a = 0;
-            }
+            src = 65536;
         }
 
-        if( attr == PIX_ATTR_HUE ){
+        _gfx_v_array_apply( obj, attr, _gfx_v_kernel_mul_sat, src );
+    }
+}
 
-            _gfx_v_set_hue_1d( a, index );
-        }
-        else if( attr == PIX_ATTR_SAT ){
+void gfx_v_array_div( uint8_t obj, uint8_t attr, int32_t src ){
 
-            _gfx_v_set_sat_1d( a, index );
-        }
-        else if( attr == PIX_ATTR_HS_FADE ){
+    // divide by 0 results in 0, same as the VM's div instruction
+    if( src == 0 ){
 
-            _gfx_v_set_hs_fade_1d( a, index );
-        }
-        else if( attr == PIX_ATTR_V_FADE ){
+        _gfx_v_array_apply( obj, attr, _gfx_v_kernel_fill, 0 );
+    }
+    else if( src == 1 ){
 
-            _gfx_v_set_v_fade_1d( a, index );
-        }   
-        else{
+        _gfx_v_array_apply( obj, attr, _gfx_v_kernel_nop, 0 );
+    }
+    else if( src > 65535 ){
 
-            _gfx_v_set_val_1d( a, index );
-        }
+        _gfx_v_array_apply( obj, attr, _gfx_v_kernel_fill, 0 );
+    }
+    else if( src > 0 ){
+
+        _gfx_v_array_apply( obj, attr, _gfx_v_kernel_div, src );
+    }
+    else if( attr != PIX_ATTR_HUE ){
+
+        // negative results saturate to 0
+        _gfx_v_array_apply( obj, attr, _gfx_v_kernel_fill, 0 );
+    }
+    else if( src == -1 ){
+
+        _gfx_v_array_apply( obj, attr, _gfx_v_kernel_neg_wrap, 0 );
+    }
+    else if( src < -65535 ){
+
+        _gfx_v_array_apply( obj, attr, _gfx_v_kernel_fill, 0 );
+    }
+    else{
+
+        _gfx_v_array_apply( obj, attr, _gfx_v_kernel_div_neg_wrap, -src );
+    }
+}
+
+void gfx_v_array_mod( uint8_t obj, uint8_t attr, int32_t src ){
+
+    // the sign of the result follows the (positive) pixel value,
+    // so the sign of src does not matter.
+    if( ( src > 65535 ) || ( src < -65535 ) ){
+
+        _gfx_v_array_apply( obj, attr, _gfx_v_kernel_nop, 0 );
+    }
+    else if( ( src >= -1 ) && ( src <= 1 ) ){
+
+        // mod by 0 results in 0, same as the VM's mod instruction
+        _gfx_v_array_apply( obj, attr, _gfx_v_kernel_fill, 0 );
+    }
+    else if( src < 0 ){
+
+        _gfx_v_array_apply( obj, attr, _gfx_v_kernel_mod, -src );
+    }
+    else{
+
+        _gfx_v_array_apply( obj, attr, _gfx_v_kernel_mod, src );
     }
 }
 
@@ -918,19 +1206,19 @@ uint16_t *gfx_u16p_get_val( void ){
     return target_val;
 }
 
-uint8_t *gfx_u8p_get_red( void ){
+uint8_t *gfx_u8p_get_ch0( void ){
 
-    return array_red;
+    return array_ch0;
 }
 
-uint8_t *gfx_u8p_get_green( void ){
+uint8_t *gfx_u8p_get_ch1( void ){
 
-    return array_green;
+    return array_ch1;
 }
 
-uint8_t *gfx_u8p_get_blue( void ){
+uint8_t *gfx_u8p_get_ch2( void ){
 
-    return array_blue;
+    return array_ch2;
 }
 
 uint8_t *gfx_u8p_get_dither( void ){
@@ -1145,6 +1433,8 @@ void gfx_v_set_hs_fade( uint16_t a, uint16_t x, uint16_t y, uint8_t obj ){
     // reset fader, this will trigger the fader process to recalculate the fader steps.
     hue_step[index] = 0;
     sat_step[index] = 0;
+
+    _gfx_v_set_fader_active( index );
 }
 
 uint16_t gfx_u16_get_hs_fade( uint16_t x, uint16_t y, uint8_t obj ){
@@ -1168,6 +1458,8 @@ void gfx_v_set_v_fade( uint16_t a, uint16_t x, uint16_t y, uint8_t obj ){
 
     // reset fader, this will trigger the fader process to recalculate the fader steps.
     val_step[index] = 0;
+
+    _gfx_v_set_fader_active( index );
 }
 
 uint16_t gfx_u16_get_v_fade( uint16_t x, uint16_t y, uint8_t obj ){
@@ -1248,6 +1540,11 @@ void gfx_v_reset( void ){
         v_fade[i]  = global_v_fade;
     }
 
+    // everything is at its target now
+    memset( fader_active, 0, sizeof(fader_active) );
+
+    sync_needed = TRUE;
+
     // reset pixel objects
     pix_array_count = 0;
 
@@ -1288,216 +1585,299 @@ static uint16_t linterp_table_lookup( uint16_t x, uint16_t *table ){
     return y;
 }
 
-uint16_t gfx_u16_get_dimmed_val( uint16_t _val ){
+// same result as linterp_table_lookup( x, dimmer_lookup ), using the
+// precomputed slopes.
+static inline uint16_t _gfx_u16_dimmer_curve( uint16_t x ){
+
+    uint8_t index = x >> 8;
+
+    // the last segment runs to 65535 and is only 255 wide
+    if( index == ( DIMMER_LOOKUP_SIZE - 1 ) ){
+
+        return linterp_table_lookup( x, dimmer_lookup );
+    }
+
+    return dimmer_lookup[index] + ( ( (uint32_t)( x & 0xff ) * dimmer_slope[index] ) >> 8 );
+}
+
+static inline uint16_t _gfx_u16_get_dimmed_val( uint16_t _val ){
 
     uint16_t x = ( (uint32_t)_val * current_dimmer ) / 65536;
 
-    return linterp_table_lookup( x, dimmer_lookup );
+    return _gfx_u16_dimmer_curve( x );
 }
 
-void gfx_v_process_faders( void ){
+uint16_t gfx_u16_get_dimmed_val( uint16_t _val ){
 
-    // update master dimmer
-    if( dimmer_step != 0 ){
+    return _gfx_u16_get_dimmed_val( _val );
+}
 
-        int32_t diff = (int32_t)target_dimmer - (int32_t)current_dimmer;
+static void update_dimmed_val_lookup( void ){
 
-        if( abs32( diff ) < abs16( dimmer_step ) ){
+    if( dimmed_val_lookup_valid && ( dimmed_val_lookup_dimmer == current_dimmer ) ){
 
-            current_dimmer = target_dimmer;
-            dimmer_step = 0;
-        }
-        else{
+        return;
+    }
 
-            current_dimmer += dimmer_step;
-        }
+    for( uint32_t i = 0; i < DIMMER_LOOKUP_SIZE; i++ ){
+
+        // sample the middle of each step
+        dimmed_val_lookup[i] = _gfx_u16_get_dimmed_val( ( i << 8 ) + 128 );
     }
 
-    for( uint16_t i = 0; i < pix_count; i++ ){
+    dimmed_val_lookup_dimmer = current_dimmer;
+    dimmed_val_lookup_valid = TRUE;
+}
 
-        // check if fader step needs to be updated
-        if( ( hue_step[i] == 0 ) && ( target_hue[i] != hue[i] ) ){
+// runs one fader step on pixel i.
+// returns FALSE once the pixel has settled at its target.
+static bool _gfx_b_process_pixel_fader( uint16_t i ){
 
-            int32_t diff, step;
+    // check if fader step needs to be updated
+    if( ( hue_step[i] == 0 ) && ( target_hue[i] != hue[i] ) ){
 
-            uint16_t hs_fade_steps = hs_fade[i] / FADER_RATE;
+        int32_t diff, step;
 
-            if( hs_fade_steps <= 1 ){
+        uint16_t hs_fade_steps = hs_fade[i] / FADER_RATE;
 
-                hs_fade_steps = 2;
-            }
+        if( hs_fade_steps <= 1 ){
 
-            diff = (int32_t)target_hue[i] - (int32_t)hue[i];
+            hs_fade_steps = 2;
+        }
 
-            // adjust to shortest distance and allow the fade to wrap around
-            // the hue circle
-            if( abs32(diff) > 32768 ){
+        diff = (int32_t)target_hue[i] - (int32_t)hue[i];
 
-                if( diff > 0 ){
+        // adjust to shortest distance and allow the fade to wrap around
+        // the hue circle
+        if( abs32(diff) > 32768 ){
 
-                    diff -= 65536;
-                }
-                else{
+            if( diff > 0 ){
 
-                    diff += 65536;
-                }
+                diff -= 65536;
             }
+            else{
 
-            step = diff / hs_fade_steps;
+                diff += 65536;
+            }
+        }
+
+        step = diff / hs_fade_steps;
+
+        if( step > 32768 ){
 
-            if( step > 32768 ){
+            step = 32768;
+        }
+        else if( step < -32767 ){
+
+            step = -32767;
+        }
+        else if( step == 0 ){
 
-                step = 32768;
+            if( diff >= 0 ){
+
+                step = 1;
             }
-            else if( step < -32767 ){
+            else{
 
-                step = -32767;
+                step = -1;
             }
-            else if( step == 0 ){
+        }
 
-                if( diff >= 0 ){
+        hue_step[i] = step;
+    }
 
-                    step = 1;
-                }
-                else{
+    if( hue_step[i] != 0 ){
 
-                    step = -1;
-                }
-            }
+        sync_needed = TRUE;
+
+        uint16_t h = hue[i];
+        uint16_t th = target_hue[i];
+        int16_t step_h = hue_step[i];
+
+        int32_t diff = (int32_t)th - (int32_t)h;
+
+        if( abs32( diff ) < abs16( step_h ) ){
+
+            hue[i] = th;
+            hue_step[i] = 0;
+        }
+        else{
+
+            hue[i] += step_h;
+        }
+    }
+
+    // check if fader step needs to be updated
+    if( ( sat_step[i] == 0 ) && ( target_sat[i] != sat[i] ) ){
+
+        int32_t diff, step;
 
-            hue_step[i] = step;
+        uint16_t hs_fade_steps = hs_fade[i] / FADER_RATE;
+
+        if( hs_fade_steps <= 1 ){
+
+            hs_fade_steps = 2;
         }
 
-        if( hue_step[i] != 0 ){
+        diff = (int32_t)target_sat[i] - (int32_t)sat[i];
+        step = diff / hs_fade_steps;
 
-            uint16_t h = hue[i];
-            uint16_t th = target_hue[i];
-            int16_t step_h = hue_step[i];
+        if( step > 32768 ){
 
-            int32_t diff = (int32_t)th - (int32_t)h;
+            step = 32768;
+        }
+        else if( step < -32767 ){
 
-            if( abs32( diff ) < abs16( step_h ) ){
+            step = -32767;
+        }
+        else if( step == 0 ){
 
-                hue[i] = th;
-                hue_step[i] = 0;
+            if( diff >= 0 ){
+
+                step = 1;
             }
             else{
 
-                hue[i] += step_h;
+                step = -1;
             }
         }
 
-        // check if fader step needs to be updated
-        if( ( sat_step[i] == 0 ) && ( target_sat[i] != sat[i] ) ){
+        sat_step[i] = step;
+    }
 
-            int32_t diff, step;
+    if( sat_step[i] != 0 ){
 
-            uint16_t hs_fade_steps = hs_fade[i] / FADER_RATE;
+        sync_needed = TRUE;
 
-            if( hs_fade_steps <= 1 ){
+        uint16_t s = sat[i];
+        uint16_t ts = target_sat[i];
+        int16_t step_s = sat_step[i];
 
-                hs_fade_steps = 2;
-            }
+        int32_t diff = (int32_t)ts - (int32_t)s;
 
-            diff = (int32_t)target_sat[i] - (int32_t)sat[i];
-            step = diff / hs_fade_steps;
+        if( abs32( diff ) < abs16( step_s ) ){
 
-            if( step > 32768 ){
+            sat[i] = ts;
+            sat_step[i] = 0;
+        }
+        else{
 
-                step = 32768;
-            }
-            else if( step < -32767 ){
+            sat[i] += step_s;
+        }
+    }
 
-                step = -32767;
-            }
-            else if( step == 0 ){
+    // check if fader step needs to be updated
+    if( ( val_step[i] == 0 ) && ( target_val[i] != val[i] ) ){
 
-                if( diff >= 0 ){
+        int32_t diff, step;
 
-                    step = 1;
-                }
-                else{
+        uint16_t v_fade_steps = v_fade[i] / FADER_RATE;
 
-                    step = -1;
-                }
-            }
+        if( v_fade_steps <= 1 ){
 
-            sat_step[i] = step;
+            v_fade_steps = 2;
         }
 
-        if( sat_step[i] != 0 ){
+        diff = (int32_t)target_val[i] - (int32_t)val[i];
+        step = diff / v_fade_steps;
+
+        if( step > 32768 ){
 
-            uint16_t s = sat[i];
-            uint16_t ts = target_sat[i];
-            int16_t step_s = sat_step[i];
+            step = 32768;
+        }
+        else if( step < -32767 ){
 
-            int32_t diff = (int32_t)ts - (int32_t)s;
+            step = -32767;
+        }
+        else if( step == 0 ){
 
-            if( abs32( diff ) < abs16( step_s ) ){
+            if( diff >= 0 ){
 
-                sat[i] = ts;
-                sat_step[i] = 0;
+                step = 1;
             }
             else{
 
-                sat[i] += step_s;
+                step = -1;
             }
         }
 
-        // check if fader step needs to be updated
-        if( ( val_step[i] == 0 ) && ( target_val[i] != val[i] ) ){
+        val_step[i] = step;   
+    }
 
-            int32_t diff, step;
+    if( val_step[i] != 0 ){
 
-            uint16_t v_fade_steps = v_fade[i] / FADER_RATE;
+        sync_needed = TRUE;
 
-            if( v_fade_steps <= 1 ){
+        uint16_t v = val[i];
+        uint16_t tv = target_val[i];
+        int16_t step_v = val_step[i];
 
-                v_fade_steps = 2;
-            }
+        int32_t diff = (int32_t)tv - (int32_t)v;
 
-            diff = (int32_t)target_val[i] - (int32_t)val[i];
-            step = diff / v_fade_steps;
+        if( abs32( diff ) < abs16( step_v ) ){
 
-            if( step > 32768 ){
+            val[i] = tv;
+            val_step[i] = 0;
+        }
+        else{
 
-                step = 32768;
-            }
-            else if( step < -32767 ){
+            val[i] += step_v;
+        }
+    }
 
-                step = -32767;
-            }
-            else if( step == 0 ){
+    if( ( hue_step[i] == 0 ) && ( sat_step[i] == 0 ) && ( val_step[i] == 0 ) &&
+        ( target_hue[i] == hue[i] ) &&
+        ( target_sat[i] == sat[i] ) &&
+        ( target_val[i] == val[i] ) ){
 
-                if( diff >= 0 ){
+        return FALSE;
+    }
 
-                    step = 1;
-                }
-                else{
+    return TRUE;
+}
 
-                    step = -1;
-                }
-            }
+void gfx_v_process_faders( void ){
+
+    // update master dimmer
+    if( dimmer_step != 0 ){
+
+        int32_t diff = (int32_t)target_dimmer - (int32_t)current_dimmer;
+
+        if( abs32( diff ) < abs16( dimmer_step ) ){
 
-            val_step[i] = step;   
+            current_dimmer = target_dimmer;
+            dimmer_step = 0;
         }
+        else{
+
+            current_dimmer += dimmer_step;
+        }
+
+        sync_needed = TRUE;
+    }
+
+    // only visit pixels in the active set
+    uint16_t words = ( pix_count + 31 ) / 32;
+
+    for( uint16_t w = 0; w < words; w++ ){
+
+        uint32_t bits = fader_active[w];
 
-        if( val_step[i] != 0 ){
+        while( bits != 0 ){
 
-            uint16_t v = val[i];
-            uint16_t tv = target_val[i];
-            int16_t step_v = val_step[i];
+            uint8_t bit = __builtin_ctz( bits );
+            bits &= bits - 1;
 
-            int32_t diff = (int32_t)tv - (int32_t)v;
+            uint16_t i = ( w * 32 ) + bit;
 
-            if( abs32( diff ) < abs16( step_v ) ){
+            if( i >= pix_count ){
 
-                val[i] = tv;
-                val_step[i] = 0;
+                break;
             }
-            else{
 
-                val[i] += step_v;
+            if( !_gfx_b_process_pixel_fader( i ) ){
+
+                fader_active[w] &= ~( (uint32_t)1 << bit );
             }
         }
     }
@@ -1508,6 +1888,7 @@ void gfxlib_v_init( void ){
     param_error_check();
 
     compute_dimmer_lookup();
+    compute_hue_lookup();
 
     // initialize pixel arrays to defaults
     gfx_v_reset();
@@ -1516,10 +1897,34 @@ void gfxlib_v_init( void ){
 }
 
 // convert all HSV to RGB
+static inline void _gfx_v_hsv_to_rgb(
+    uint16_t h,
+    uint16_t s,
+    uint16_t v,
+    uint16_t *r,
+    uint16_t *g,
+    uint16_t *b );
+
+static inline void _gfx_v_hsv_to_rgb_fast(
+    uint16_t h,
+    uint16_t s,
+    uint16_t v,
+    uint16_t *r,
+    uint16_t *g,
+    uint16_t *b );
+
 void gfx_v_sync_array( void ){
 
+    // nothing has changed since the last sync, the output arrays are
+    // already up to date.
+    if( !sync_needed ){
+
+        return;
+    }
+
+    sync_needed = FALSE;
+
     uint16_t r, g, b, w;
-    uint8_t dither;
     uint16_t dimmed_val;
 
     // PWM modes will use pixel 0 and need 16 bits.
@@ -1538,12 +1943,40 @@ void gfx_v_sync_array( void ){
         &pix0_16bit_blue
     );
 
+    if( hsv_mode == GFX_HSV_MODE_FAST ){
+
+        update_dimmed_val_lookup();
+    }
+
+    // resolve the channel order once per sync, so the conversion loops
+    // write straight into wire order.
+    uint8_t *channels[3] = { array_ch0, array_ch1, array_ch2 };
+    uint8_t ch_r = pix_u8_get_channel( pix_rgb_order, PIX_COLOR_RED );
+    uint8_t ch_g = pix_u8_get_channel( pix_rgb_order, PIX_COLOR_GREEN );
+    uint8_t ch_b = pix_u8_get_channel( pix_rgb_order, PIX_COLOR_BLUE );
+
+    uint8_t *out_r = channels[ch_r];
+    uint8_t *out_g = channels[ch_g];
+    uint8_t *out_b = channels[ch_b];
+
+    // dither bits for wire channel 0 are in bits 5:4, channel 2 in bits 1:0
+    uint8_t dither_shift_r = 4 - ( ch_r * 2 );
+    uint8_t dither_shift_g = 4 - ( ch_g * 2 );
+    uint8_t dither_shift_b = 4 - ( ch_b * 2 );
+
     if( pix_mode == PIX_MODE_SK6812_RGBW ){
 
         for( uint16_t i = 0; i < pix_count; i++ ){
 
             // process master dimmer
-            dimmed_val = gfx_u16_get_dimmed_val( val[i] );
+            if( hsv_mode == GFX_HSV_MODE_FAST ){
+
+                dimmed_val = dimmed_val_lookup[val[i] >> 8];
+            }
+            else{
+
+                dimmed_val = _gfx_u16_get_dimmed_val( val[i] );
+            }
 
             gfx_v_hsv_to_rgbw(
                 hue[i],
@@ -1554,55 +1987,59 @@ void gfx_v_sync_array( void ){
                 &b,
                 &w
             );
-      
-            r /= 256;
-            g /= 256;
-            b /= 256;
-            w /= 256;
         
-            array_red[i] = r;
-            array_green[i] = g;
-            array_blue[i] = b;
-            array_misc[i] = w;
+            out_r[i] = r >> 8;
+            out_g[i] = g >> 8;
+            out_b[i] = b >> 8;
+            array_misc[i] = w >> 8;
         }
     }
-    else{
+    else if( hsv_mode == GFX_HSV_MODE_FAST ){
 
         for( uint16_t i = 0; i < pix_count; i++ ){
 
-            // process master dimmer
-            dimmed_val = gfx_u16_get_dimmed_val( val[i] );
+            _gfx_v_hsv_to_rgb_fast(
+                hue[i],
+                sat[i],
+                dimmed_val_lookup[val[i] >> 8],
+                &r,
+                &g,
+                &b
+            );
 
-            gfx_v_hsv_to_rgb(
+            // bits 7 and 6 of each channel are the dither bits
+            out_r[i] = r >> 8;
+            out_g[i] = g >> 8;
+            out_b[i] = b >> 8;
+            array_misc[i] = ( ( ( r >> 6 ) & 0x03 ) << dither_shift_r ) |
+                            ( ( ( g >> 6 ) & 0x03 ) << dither_shift_g ) |
+                            ( ( ( b >> 6 ) & 0x03 ) << dither_shift_b );
+        }
+    }
+    else{
+
+        for( uint16_t i = 0; i < pix_count; i++ ){
+
+            _gfx_v_hsv_to_rgb(
                 hue[i],
                 sat[i],
-                dimmed_val,
+                _gfx_u16_get_dimmed_val( val[i] ),
                 &r,
                 &g,
                 &b
             );
-      
-            r /= 64;
-            g /= 64;
-            b /= 64;
-
-            dither =  ( r & 0x0003 ) << 4;
-            dither |= ( g & 0x0003 ) << 2;
-            dither |= ( b & 0x0003 );
-
-            r /= 4;
-            g /= 4;
-            b /= 4;
-        
-            array_red[i] = r;
-            array_green[i] = g;
-            array_blue[i] = b;
-            array_misc[i] = dither;
+
+            // bits 7 and 6 of each channel are the dither bits
+            out_r[i] = r >> 8;
+            out_g[i] = g >> 8;
+            out_b[i] = b >> 8;
+            array_misc[i] = ( ( ( r >> 6 ) & 0x03 ) << dither_shift_r ) |
+                            ( ( ( g >> 6 ) & 0x03 ) << dither_shift_g ) |
+                            ( ( ( b >> 6 ) & 0x03 ) << dither_shift_b );
         }
     }
 }
 
-
 // Value noise implementation
 
 void gfx_v_init_noise( void ){
@@ -2430,12 +2867,49 @@ Other HSV to RGB code for reference
 //     }
 // }e
 
+// fast mode conversion: hue comes from the 8 bit hue table.
+static inline void _gfx_v_hsv_to_rgb_fast(
+    uint16_t h,
+    uint16_t s,
+    uint16_t v,
+    uint16_t *r,
+    uint16_t *g,
+    uint16_t *b ){
+
+    uint16_t *temp = hue_lookup[h >> 8];
+    uint16_t temp_r = temp[0];
+    uint16_t temp_g = temp[1];
+    uint16_t temp_b = temp[2];
+    uint16_t temp_s = 65535 - s;
+
+    // floor saturation
+    if( temp_r < temp_s ){
+
+        temp_r = temp_s;
+    }
+
+    if( temp_g < temp_s ){
+
+        temp_g = temp_s;
+    }
+
+    if( temp_b < temp_s ){
+
+        temp_b = temp_s;
+    }
+
+    // apply brightness
+    *r = ( (uint32_t)temp_r * v ) / 65536;
+    *g = ( (uint32_t)temp_g * v ) / 65536;
+    *b = ( (uint32_t)temp_b * v ) / 65536;
+}
+
 #else
 
 #endif
 
 
-void gfx_v_hsv_to_rgb(
+static inline void _gfx_v_hsv_to_rgb(
     uint16_t h,
     uint16_t s,
     uint16_t v,
@@ -2532,6 +3006,17 @@ void gfx_v_hsv_to_rgb(
     *b = ( (uint32_t)temp_b * v ) / 65536;
 }
 
+void gfx_v_hsv_to_rgb(
+    uint16_t h,
+    uint16_t s,
+    uint16_t v,
+    uint16_t *r,
+    uint16_t *g,
+    uint16_t *b ){
+
+    _gfx_v_hsv_to_rgb( h, s, v, r, g, b );
+}
+
 void gfx_v_hsv_to_rgbw(
     uint16_t h,
     uint16_t s,
@@ -33,7 +33,7 @@
 
 #define FADER_RATE              20
 
-#define GFX_VERSION             1
+#define GFX_VERSION             3
 
 typedef struct  __attribute__((packed)){
     uint8_t version;
@@ -51,6 +51,8 @@ typedef struct  __attribute__((packed)){
     uint16_t dimmer_curve;
     uint16_t virtual_array_start;
     uint16_t virtual_array_length;
+    uint8_t hsv_mode;
+    uint8_t pix_rgb_order;
 } gfx_params_t;
 
 typedef struct  __attribute__((packed)){
@@ -61,6 +63,10 @@ typedef struct  __attribute__((packed)){
 
 #define GFX_DIMMER_CURVE_DEFAULT    128
 
+// HSV to RGB conversion precision
+#define GFX_HSV_MODE_EXACT          0 // full 16 bit dimmer and hue math
+#define GFX_HSV_MODE_FAST           1 // 8 bit indexed dimmer and hue tables
+
 #define ARRAY_OBJ_TYPE      0
 #define PIX_OBJ_TYPE        1
 
@@ -136,9 +142,9 @@ uint16_t *gfx_u16p_get_hue( void );
 uint16_t *gfx_u16p_get_sat( void );
 uint16_t *gfx_u16p_get_val( void );
 
-uint8_t *gfx_u8p_get_red( void );
-uint8_t *gfx_u8p_get_green( void );
-uint8_t *gfx_u8p_get_blue( void );
+uint8_t *gfx_u8p_get_ch0( void );
+uint8_t *gfx_u8p_get_ch1( void );
+uint8_t *gfx_u8p_get_ch2( void );
 uint8_t *gfx_u8p_get_dither( void );
 
 void gfx_v_set_background_hsv( int32_t h, int32_t s, int32_t v );
@@ -50,6 +50,7 @@ static bool gfx_interleave_x;
 static bool gfx_transpose;
 static uint16_t gfx_frame_rate = 100;
 static uint8_t gfx_dimmer_curve = GFX_DIMMER_CURVE_DEFAULT;
+static uint8_t gfx_hsv_mode = GFX_HSV_MODE_EXACT;
 
 static uint16_t gfx_virtual_array_start;
 static uint16_t gfx_virtual_array_length;
@@ -143,6 +144,11 @@ static void param_error_check( void ){
 
         gfx_dimmer_curve = GFX_DIMMER_CURVE_DEFAULT;
     }
+
+    if( gfx_hsv_mode > GFX_HSV_MODE_FAST ){
+
+        gfx_hsv_mode = GFX_HSV_MODE_EXACT;
+    }
 }
 
 
@@ -179,6 +185,7 @@ KV_SECTION_META kv_meta_t gfx_info_kv[] = {
     { SAPPHIRE_TYPE_UINT16,  0, KV_FLAGS_PERSIST, &v_fade,                      gfx_i8_kv_handler,   "gfx_vfade" },
     { SAPPHIRE_TYPE_UINT16,  0, KV_FLAGS_PERSIST, &gfx_frame_rate,              gfx_i8_kv_handler,   "gfx_frame_rate" },
     { SAPPHIRE_TYPE_UINT8,   0, KV_FLAGS_PERSIST, &gfx_dimmer_curve,            gfx_i8_kv_handler,   "gfx_dimmer_curve" },
+    { SAPPHIRE_TYPE_UINT8,   0, KV_FLAGS_PERSIST, &gfx_hsv_mode,                gfx_i8_kv_handler,   "gfx_hsv_mode" },
     
     { SAPPHIRE_TYPE_UINT16,  0, KV_FLAGS_PERSIST, &gfx_virtual_array_start,     gfx_i8_kv_handler,   "gfx_varray_start" },
     { SAPPHIRE_TYPE_UINT16,  0, KV_FLAGS_PERSIST, &gfx_virtual_array_length,    gfx_i8_kv_handler,   "gfx_varray_length" },
@@ -202,6 +209,7 @@ void gfx_v_set_params( gfx_params_t *params ){
     gfx_sub_dimmer              = params->sub_dimmer;
     gfx_frame_rate              = params->frame_rate;
     gfx_dimmer_curve            = params->dimmer_curve;
+    gfx_hsv_mode                = params->hsv_mode;
     gfx_virtual_array_start     = params->virtual_array_start;
     gfx_virtual_array_length    = params->virtual_array_length;
 
@@ -228,7 +236,9 @@ void gfx_v_get_params( gfx_params_t *params ){
     params->sub_dimmer          = gfx_sub_dimmer;
     params->frame_rate          = gfx_frame_rate;   
     params->dimmer_curve        = gfx_dimmer_curve;
+    params->hsv_mode            = gfx_hsv_mode;
     params->pix_mode            = pixel_u8_get_mode();
+    params->pix_rgb_order       = pixel_u8_get_rgb_order();
 
     params->virtual_array_start   = gfx_virtual_array_start;
     params->virtual_array_length  = gfx_virtual_array_length;
@@ -287,6 +297,13 @@ uint16_t gfx_u16_get_submaster_dimmer( void ){
     return gfx_sub_dimmer;
 }
 
+void gfx_v_request_params( void ){
+
+    ATOMIC;
+    run_flags |= FLAG_RUN_PARAMS;
+    END_ATOMIC;
+}
+
 
 PT_THREAD( gfx_control_thread( pt_t *pt, void *state ) );
 
@@ -486,13 +503,14 @@ int8_t wifi_i8_msg_handler( uint8_t data_id, uint8_t *data, uint8_t len ){
 
             wifi_msg_rgb_array_t *msg = (wifi_msg_rgb_array_t *)data;
 
-            // unpack RGBD pointers
-            uint8_t *r = msg->rgbd_array;
-            uint8_t *g = r + msg->count;
-            uint8_t *b = g + msg->count;
-            uint8_t *d = b + msg->count;
+            // unpack channel pointers.
+            // the ESP has already arranged these in wire order.
+            uint8_t *ch0 = msg->rgbd_array;
+            uint8_t *ch1 = ch0 + msg->count;
+            uint8_t *ch2 = ch1 + msg->count;
+            uint8_t *d = ch2 + msg->count;
 
-            pixel_v_load_rgb( msg->index, msg->count, r, g, b, d );   
+            pixel_v_load_channels( msg->index, msg->count, ch0, ch1, ch2, d );
         }
     }
     else if( data_id == WIFI_DATA_ID_VM_INFO ){
@@ -53,6 +53,7 @@ void gfx_v_reset_frame_sync( void );
 #endif
 
 void gfx_v_sync_params( void );
+void gfx_v_request_params( void );
 
 void gfx_v_set_subscribed_keys( mem_handle_t h );
 void gfx_v_reset_subscribed( void );
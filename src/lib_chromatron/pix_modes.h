@@ -23,6 +23,8 @@
 #ifndef _PIX_MODES_H_
 #define _PIX_MODES_H_
 
+#include <stdint.h>
+
 
 #define PIX_MODE_OFF            0
 #define PIX_MODE_WS2801         1
@@ -32,5 +34,37 @@
 #define PIX_MODE_SK6812_RGBW    5
 #define PIX_MODE_ANALOG         128
 
+#define PIX_ORDER_RGB       0
+#define PIX_ORDER_RBG       1
+#define PIX_ORDER_GRB       2
+#define PIX_ORDER_BGR       3
+#define PIX_ORDER_BRG       4
+#define PIX_ORDER_GBR       5
+
+#define PIX_COLOR_RED       0
+#define PIX_COLOR_GREEN     1
+#define PIX_COLOR_BLUE      2
+
+// position on the wire (0 is sent first) of a PIX_COLOR_* channel
+// for a PIX_ORDER_* setting.
+static inline uint8_t pix_u8_get_channel( uint8_t order, uint8_t color ){
+
+    static const uint8_t channels[][3] = {
+        { 0, 1, 2 }, // RGB
+        { 0, 2, 1 }, // RBG
+        { 1, 0, 2 }, // GRB
+        { 2, 1, 0 }, // BGR
+        { 1, 2, 0 }, // BRG
+        { 2, 0, 1 }, // GBR
+    };
+
+    if( order > PIX_ORDER_GBR ){
+
+        order = PIX_ORDER_RGB;
+    }
+
+    return channels[order][color];
+}
+
 
 #endif
\ No newline at end of file
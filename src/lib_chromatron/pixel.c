@@ -45,6 +45,16 @@
 
 #define PIXEL_TIMER_RATE TC_CLKSEL_DIV64_gc
 
+// number of frame starts a partially loaded frame may wait before
+// it is sent anyway (for sources that only update part of the strip).
+#define PIX_FRAME_LATE_LIMIT 4
+
+#ifdef ENABLE_PIX_DOUBLE_BUFFER
+#define PIX_FRAME_COUNT 2
+#else
+#define PIX_FRAME_COUNT 1
+#endif
+
 static bool pix_dither;
 static uint8_t pix_mode;
 
@@ -53,13 +63,34 @@ static uint8_t pix_rgb_order;
 static uint8_t pix_apa102_dimmer = 31;
 static bool apa102_trailer;
 
-static uint8_t array_r[MAX_PIXELS];
-static uint8_t array_g[MAX_PIXELS];
-static uint8_t array_b[MAX_PIXELS];
-static union{
-    uint8_t dither[MAX_PIXELS];
-    uint8_t white[MAX_PIXELS];
-} array_misc;
+// channel arrays are stored in wire order (see pix_rgb_order),
+// ch0 is shifted out first.
+typedef struct{
+    uint8_t ch0[MAX_PIXELS];
+    uint8_t ch1[MAX_PIXELS];
+    uint8_t ch2[MAX_PIXELS];
+    union{
+        uint8_t dither[MAX_PIXELS];
+        uint8_t white[MAX_PIXELS];
+    } misc;
+} pix_frame_t;
+
+// with ENABLE_PIX_DOUBLE_BUFFER, the DMA ISRs only read the front frame
+// and loads only write the back frame.  the two are swapped at frame start.
+// this costs another sizeof(pix_frame_t) (MAX_PIXELS * 4 bytes) of SRAM.
+// without it, front and back are the same frame.
+static pix_frame_t frames[PIX_FRAME_COUNT];
+static pix_frame_t *front_frame = &frames[0];
+static pix_frame_t *back_frame = &frames[PIX_FRAME_COUNT - 1];
+
+static volatile bool back_ready;            // back frame is complete
+static volatile bool back_loading;          // a sequential load is in progress
+static volatile bool back_synced = TRUE;    // back frame has no pixels older than the front
+static uint16_t load_end;                   // end of the sequential load so far
+static uint8_t load_frame_starts;           // frame starts seen during the sequential load
+
+static uint32_t pix_frames_dropped;
+static uint32_t pix_frames_late;
 
 static uint8_t pixels_per_buf;
 
@@ -68,6 +99,19 @@ static uint8_t pix_buf_A[PIX_DMA_BUF_SIZE];
 static uint8_t pix_buf_B[PIX_DMA_BUF_SIZE];
 static uint8_t dither_cycle;
 
+// encodes count pixels starting at current_pixel into buf,
+// returns number of bytes written.
+typedef uint8_t (*pix_encoder_t)( uint8_t *buf, uint8_t count );
+static pix_encoder_t pix_encoder;
+
+// average CPU cycles per pixel spent in the encoder.
+// the ISR only accumulates, the average is computed when the key is read.
+static uint16_t pix_isr_cycles;
+static uint32_t isr_ticks;
+static uint32_t isr_pixels;
+
+static void select_encoder( void );
+
 
 int8_t pix_i8_kv_handler(
     kv_op_t8 op,
@@ -76,7 +120,24 @@ int8_t pix_i8_kv_handler(
     uint16_t len )
 {
 
-    if( op == KV_OP_SET ){
+    if( op == KV_OP_GET ){
+
+        if( hash == __KV__pix_isr_cycles ){
+
+            // KV calls handlers atomically
+            if( isr_pixels > 0 ){
+
+                // timer ticks are 64 CPU cycles
+                pix_isr_cycles = ( isr_ticks * 64 ) / isr_pixels;
+
+                isr_ticks = 0;
+                isr_pixels = 0;
+            }
+
+            memcpy( data, &pix_isr_cycles, len );
+        }
+    }
+    else if( op == KV_OP_SET ){
 
         if( hash == __KV__pix_apa102_dimmer ){
 
@@ -86,6 +147,22 @@ int8_t pix_i8_kv_handler(
                 pix_apa102_dimmer = 31;
             }
         }
+        else if( hash == __KV__pix_dither ){
+
+            ATOMIC;
+            select_encoder();
+            END_ATOMIC;
+        }
+        else if( hash == __KV__pix_rgb_order ){
+
+            // channel order is applied by the graphics processor
+            gfx_v_request_params();
+        }
+        else if( ( hash == __KV__pix_frames_dropped ) ||
+                 ( hash == __KV__pix_frames_late ) ){
+
+            // writing a counter resets it, nothing else to do
+        }
         else{
 
             // reset pixel drivers
@@ -97,11 +174,14 @@ int8_t pix_i8_kv_handler(
 }
 
 KV_SECTION_META kv_meta_t pixel_info_kv[] = {
-    { SAPPHIRE_TYPE_UINT8,   0, KV_FLAGS_PERSIST,                 &pix_rgb_order,       0,                    "pix_rgb_order" },
+    { SAPPHIRE_TYPE_UINT8,   0, KV_FLAGS_PERSIST,                 &pix_rgb_order,       pix_i8_kv_handler,    "pix_rgb_order" },
     { SAPPHIRE_TYPE_UINT8,   0, KV_FLAGS_PERSIST,                 &pix_clock,           pix_i8_kv_handler,    "pix_clock" },
-    { SAPPHIRE_TYPE_BOOL,    0, KV_FLAGS_PERSIST,                 &pix_dither,          0,                    "pix_dither" },
+    { SAPPHIRE_TYPE_BOOL,    0, KV_FLAGS_PERSIST,                 &pix_dither,          pix_i8_kv_handler,    "pix_dither" },
     { SAPPHIRE_TYPE_UINT8,   0, KV_FLAGS_PERSIST,                 &pix_mode,            pix_i8_kv_handler,    "pix_mode" },
     { SAPPHIRE_TYPE_UINT8,   0, KV_FLAGS_PERSIST,                 &pix_apa102_dimmer,   pix_i8_kv_handler,    "pix_apa102_dimmer" },
+    { SAPPHIRE_TYPE_UINT16,  0, KV_FLAGS_READ_ONLY,               &pix_isr_cycles,      pix_i8_kv_handler,    "pix_isr_cycles" },
+    { SAPPHIRE_TYPE_UINT32,  0, 0,                                &pix_frames_dropped,  pix_i8_kv_handler,    "pix_frames_dropped" },
+    { SAPPHIRE_TYPE_UINT32,  0, 0,                                &pix_frames_late,     pix_i8_kv_handler,    "pix_frames_late" },
 };
 
 static const PROGMEM uint8_t ws2811_lookup[256][3] = {
@@ -190,6 +270,184 @@ static void setup_tx_dma_B( uint8_t *buf, uint8_t len ){
 //     return ( DMA.INTFLAGS & PIXEL_DMA_CH_A_TRNIF_FLAG ) != 0;
 // }
 
+static inline uint8_t apply_dither( uint8_t data, uint8_t bits, uint8_t cycle ){
+
+    if( ( data < 255 ) && ( bits > cycle ) ){
+
+        data++;
+    }
+
+    return data;
+}
+
+static inline uint8_t *ws2811_encode( uint8_t *buf, uint8_t data ){
+
+    const uint8_t *ptr = ws2811_lookup[data];
+
+    *buf++ = pgm_read_byte( ptr++ );
+    *buf++ = pgm_read_byte( ptr++ );
+    *buf++ = pgm_read_byte( ptr );
+
+    return buf;
+}
+
+static uint8_t encode_rgb( uint8_t *buf, uint8_t count ){
+
+    uint8_t *ch0 = &front_frame->ch0[current_pixel];
+    uint8_t *ch1 = &front_frame->ch1[current_pixel];
+    uint8_t *ch2 = &front_frame->ch2[current_pixel];
+
+    for( uint8_t i = 0; i < count; i++ ){
+
+        *buf++ = *ch0++;
+        *buf++ = *ch1++;
+        *buf++ = *ch2++;
+    }
+
+    return count * 3;
+}
+
+static uint8_t encode_rgb_dither( uint8_t *buf, uint8_t count ){
+
+    uint8_t *ch0 = &front_frame->ch0[current_pixel];
+    uint8_t *ch1 = &front_frame->ch1[current_pixel];
+    uint8_t *ch2 = &front_frame->ch2[current_pixel];
+    uint8_t *d = &front_frame->misc.dither[current_pixel];
+    uint8_t cycle = dither_cycle & 0x03;
+
+    for( uint8_t i = 0; i < count; i++ ){
+
+        uint8_t bits = *d++;
+
+        *buf++ = apply_dither( *ch0++, ( bits >> 4 ) & 0x03, cycle );
+        *buf++ = apply_dither( *ch1++, ( bits >> 2 ) & 0x03, cycle );
+        *buf++ = apply_dither( *ch2++, ( bits >> 0 ) & 0x03, cycle );
+    }
+
+    return count * 3;
+}
+
+static uint8_t encode_apa102( uint8_t *buf, uint8_t count ){
+
+    uint8_t *ch0 = &front_frame->ch0[current_pixel];
+    uint8_t *ch1 = &front_frame->ch1[current_pixel];
+    uint8_t *ch2 = &front_frame->ch2[current_pixel];
+    uint8_t header = 0xe0 | pix_apa102_dimmer; // APA102 global brightness control
+
+    for( uint8_t i = 0; i < count; i++ ){
+
+        *buf++ = header;
+        *buf++ = *ch0++;
+        *buf++ = *ch1++;
+        *buf++ = *ch2++;
+    }
+
+    return count * 4;
+}
+
+static uint8_t encode_apa102_dither( uint8_t *buf, uint8_t count ){
+
+    uint8_t *ch0 = &front_frame->ch0[current_pixel];
+    uint8_t *ch1 = &front_frame->ch1[current_pixel];
+    uint8_t *ch2 = &front_frame->ch2[current_pixel];
+    uint8_t *d = &front_frame->misc.dither[current_pixel];
+    uint8_t cycle = dither_cycle & 0x03;
+    uint8_t header = 0xe0 | pix_apa102_dimmer;
+
+    for( uint8_t i = 0; i < count; i++ ){
+
+        uint8_t bits = *d++;
+
+        *buf++ = header;
+        *buf++ = apply_dither( *ch0++, ( bits >> 4 ) & 0x03, cycle );
+        *buf++ = apply_dither( *ch1++, ( bits >> 2 ) & 0x03, cycle );
+        *buf++ = apply_dither( *ch2++, ( bits >> 0 ) & 0x03, cycle );
+    }
+
+    return count * 4;
+}
+
+static uint8_t encode_ws2811( uint8_t *buf, uint8_t count ){
+
+    uint8_t *ch0 = &front_frame->ch0[current_pixel];
+    uint8_t *ch1 = &front_frame->ch1[current_pixel];
+    uint8_t *ch2 = &front_frame->ch2[current_pixel];
+
+    for( uint8_t i = 0; i < count; i++ ){
+
+        buf = ws2811_encode( buf, *ch0++ );
+        buf = ws2811_encode( buf, *ch1++ );
+        buf = ws2811_encode( buf, *ch2++ );
+    }
+
+    return count * 9;
+}
+
+static uint8_t encode_ws2811_dither( uint8_t *buf, uint8_t count ){
+
+    uint8_t *ch0 = &front_frame->ch0[current_pixel];
+    uint8_t *ch1 = &front_frame->ch1[current_pixel];
+    uint8_t *ch2 = &front_frame->ch2[current_pixel];
+    uint8_t *d = &front_frame->misc.dither[current_pixel];
+    uint8_t cycle = dither_cycle & 0x03;
+
+    for( uint8_t i = 0; i < count; i++ ){
+
+        uint8_t bits = *d++;
+
+        buf = ws2811_encode( buf, apply_dither( *ch0++, ( bits >> 4 ) & 0x03, cycle ) );
+        buf = ws2811_encode( buf, apply_dither( *ch1++, ( bits >> 2 ) & 0x03, cycle ) );
+        buf = ws2811_encode( buf, apply_dither( *ch2++, ( bits >> 0 ) & 0x03, cycle ) );
+    }
+
+    return count * 9;
+}
+
+// RGBW uses the misc array for white, so there is no dithered variant
+static uint8_t encode_sk6812_rgbw( uint8_t *buf, uint8_t count ){
+
+    uint8_t *ch0 = &front_frame->ch0[current_pixel];
+    uint8_t *ch1 = &front_frame->ch1[current_pixel];
+    uint8_t *ch2 = &front_frame->ch2[current_pixel];
+    uint8_t *w = &front_frame->misc.white[current_pixel];
+
+    for( uint8_t i = 0; i < count; i++ ){
+
+        buf = ws2811_encode( buf, *ch0++ );
+        buf = ws2811_encode( buf, *ch1++ );
+        buf = ws2811_encode( buf, *ch2++ );
+        buf = ws2811_encode( buf, *w++ );
+    }
+
+    return count * 12;
+}
+
+// must be called with the pixel DMA interrupts masked
+static void select_encoder( void ){
+
+    if( pix_mode == PIX_MODE_APA102 ){
+
+        pix_encoder = pix_dither ? encode_apa102_dither : encode_apa102;
+    }
+    else if( pix_mode == PIX_MODE_WS2811 ){
+
+        pix_encoder = pix_dither ? encode_ws2811_dither : encode_ws2811;
+    }
+    else if( pix_mode == PIX_MODE_SK6812_RGBW ){
+
+        pix_encoder = encode_sk6812_rgbw;
+    }
+    else{
+
+        // WS2801, Pixie
+        pix_encoder = pix_dither ? encode_rgb_dither : encode_rgb;
+    }
+
+    pix_isr_cycles = 0;
+    isr_ticks = 0;
+    isr_pixels = 0;
+}
+
 static uint8_t setup_pixel_buffer( uint8_t *buf, uint8_t len ){
 
     uint8_t transfer_pixel_count = pixels_per_buf;
@@ -205,127 +463,100 @@ static uint8_t setup_pixel_buffer( uint8_t *buf, uint8_t len ){
         return 0;
     }
 
-    uint8_t buf_index = 0;
-
-    uint8_t r, g, b, dither;
-    uint8_t rd, gd, bd;
+    // the pixel timer is free running as the frame watchdog while
+    // DMA is active, so we can use it to time the encoder.
+    bool timing = PIXEL_TIMER.CTRLA == PIXEL_TIMER_RATE;
+    uint16_t start = PIXEL_TIMER.CNT;
 
-    for( uint8_t i = 0; i < transfer_pixel_count; i++ ){
+    uint8_t count = pix_encoder( buf, transfer_pixel_count );
 
-        r = array_r[current_pixel];
-        g = array_g[current_pixel];
-        b = array_b[current_pixel];
+    uint16_t end = PIXEL_TIMER.CNT;
 
-        if( pix_mode == PIX_MODE_SK6812_RGBW ){
+    if( timing && ( end >= start ) ){
 
-        }
-        else if( pix_dither ){
+        isr_ticks += end - start;
+        isr_pixels += transfer_pixel_count;
+    }
 
-            dither = array_misc.dither[current_pixel];
+    current_pixel += transfer_pixel_count;
 
-            rd = ( dither >> 4 ) & 0x03;
-            gd = ( dither >> 2 ) & 0x03;
-            bd = ( dither >> 0 ) & 0x03;
+    return count;
+}
 
-            if( ( r < 255 ) && ( rd > ( dither_cycle & 0x03 ) ) ){
 
-                r++;
-            }
+static uint16_t get_frame_pix_count( void ){
 
-            if( ( g < 255 ) && ( gd > ( dither_cycle & 0x03 ) ) ){
+    uint16_t pix_count = gfx_u16_get_pix_count();
 
-                g++;
-            }
+    if( pix_count > MAX_PIXELS ){
 
-            if( ( b < 255 ) && ( bd > ( dither_cycle & 0x03 ) ) ){
+        pix_count = MAX_PIXELS;
+    }
 
-                b++;
-            }
-        }
+    return pix_count;
+}
 
-        if( pix_mode == PIX_MODE_APA102 ){
+// copy pixels [start, end) from the front frame to the back frame
+static void copy_from_front( uint16_t start, uint16_t end ){
 
-            buf[buf_index++] = 0xe0 | pix_apa102_dimmer; // APA102 global brightness control
-        }
+    if( end <= start ){
 
-        uint8_t data0, data1, data2;
+        return;
+    }
 
-        if( pix_rgb_order == PIX_ORDER_RGB ){
+    uint16_t count = end - start;
 
-            data0 = r;
-            data1 = g;
-            data2 = b;
-        }
-        else if( pix_rgb_order == PIX_ORDER_RBG ){
+    memcpy( &back_frame->ch0[start], &front_frame->ch0[start], count );
+    memcpy( &back_frame->ch1[start], &front_frame->ch1[start], count );
+    memcpy( &back_frame->ch2[start], &front_frame->ch2[start], count );
+    memcpy( &back_frame->misc.dither[start], &front_frame->misc.dither[start], count );
+}
 
-            data0 = r;
-            data1 = b;
-            data2 = g;
-        }
-        else if( pix_rgb_order == PIX_ORDER_GRB ){
+// called from the pixel timer ISR
+static void swap_frames( void ){
 
-            data0 = g;
-            data1 = r;
-            data2 = b;
-        }
-        else if( pix_rgb_order == PIX_ORDER_BGR ){
+    if( back_loading ){
 
-            data0 = b;
-            data1 = g;
-            data2 = r;
-        }
-        else if( pix_rgb_order == PIX_ORDER_BRG ){
+        // a frame is being loaded but has not finished,
+        // send the previous frame again.
+        load_frame_starts++;
 
-            data0 = b;
-            data1 = r;
-            data2 = g;
-        }
-        else if( pix_rgb_order == PIX_ORDER_GBR ){
+        // the load began before the previous frame start
+        if( load_frame_starts == 2 ){
 
-            data0 = g;
-            data1 = b;
-            data2 = r;
+            pix_frames_late++;
         }
 
-        if( ( pix_mode == PIX_MODE_WS2811 ) ||
-            ( pix_mode == PIX_MODE_SK6812_RGBW ) ){
-
-            // ws2811 bitstream lookup
-
-            buf[buf_index++] = pgm_read_byte( &ws2811_lookup[data0][0] );
-            buf[buf_index++] = pgm_read_byte( &ws2811_lookup[data0][1] );
-            buf[buf_index++] = pgm_read_byte( &ws2811_lookup[data0][2] );
-
-            buf[buf_index++] = pgm_read_byte( &ws2811_lookup[data1][0] );
-            buf[buf_index++] = pgm_read_byte( &ws2811_lookup[data1][1] );
-            buf[buf_index++] = pgm_read_byte( &ws2811_lookup[data1][2] );
-
-            buf[buf_index++] = pgm_read_byte( &ws2811_lookup[data2][0] );
-            buf[buf_index++] = pgm_read_byte( &ws2811_lookup[data2][1] );
-            buf[buf_index++] = pgm_read_byte( &ws2811_lookup[data2][2] );
-
-            if( pix_mode == PIX_MODE_SK6812_RGBW ){
-
-                uint8_t white = array_misc.white[current_pixel];
+        if( load_frame_starts < PIX_FRAME_LATE_LIMIT ){
 
-                buf[buf_index++] = pgm_read_byte( &ws2811_lookup[white][0] );
-                buf[buf_index++] = pgm_read_byte( &ws2811_lookup[white][1] );
-                buf[buf_index++] = pgm_read_byte( &ws2811_lookup[white][2] );
-            }
+            return;
         }
-        else{
 
-            buf[buf_index++] = data0;
-            buf[buf_index++] = data1;
-            buf[buf_index++] = data2;
+        // the source stopped partway through the strip, send what it
+        // loaded.  this is rare, so the rest of the strip is copied here.
+        if( !back_synced ){
+
+            copy_from_front( load_end, get_frame_pix_count() );
         }
+    }
+    else if( !back_ready ){
 
-        current_pixel++;
+        // no new frame
+        return;
     }
 
-    return buf_index;
-}
+    #ifdef ENABLE_PIX_DOUBLE_BUFFER
+    pix_frame_t *temp = front_frame;
+    front_frame = back_frame;
+    back_frame = temp;
 
+    // the new back frame holds the previous frame
+    back_synced = FALSE;
+    #endif
+
+    back_ready = FALSE;
+    back_loading = FALSE;
+}
 
 static void pixel_v_start_frame( void ){
 
@@ -334,6 +565,8 @@ static void pixel_v_start_frame( void ){
         return;
     }
 
+    swap_frames();
+
     apa102_trailer = FALSE;
 
     dither_cycle++;
@@ -557,48 +790,15 @@ void pixel_v_set_analog_rgb( uint16_t r, uint16_t g, uint16_t b ){
         return;
     }
 
-    uint16_t data0, data1, data2;
-
-    if( pix_rgb_order == PIX_ORDER_RGB ){
-
-        data0 = r;
-        data1 = g;
-        data2 = b;
-    }
-    else if( pix_rgb_order == PIX_ORDER_RBG ){
-
-        data0 = r;
-        data1 = b;
-        data2 = g;
-    }
-    else if( pix_rgb_order == PIX_ORDER_GRB ){
-
-        data0 = g;
-        data1 = r;
-        data2 = b;
-    }
-    else if( pix_rgb_order == PIX_ORDER_BGR ){
-
-        data0 = b;
-        data1 = g;
-        data2 = r;
-    }
-    else if( pix_rgb_order == PIX_ORDER_BRG ){
-
-        data0 = b;
-        data1 = r;
-        data2 = g;
-    }
-    else if( pix_rgb_order == PIX_ORDER_GBR ){
+    uint16_t data[3];
 
-        data0 = g;
-        data1 = b;
-        data2 = r;
-    }
+    data[pix_u8_get_channel( pix_rgb_order, PIX_COLOR_RED )]    = r;
+    data[pix_u8_get_channel( pix_rgb_order, PIX_COLOR_GREEN )]  = g;
+    data[pix_u8_get_channel( pix_rgb_order, PIX_COLOR_BLUE )]   = b;
 
-    pwm_v_write( 0, data0 );
-    pwm_v_write( 1, data1 );
-    pwm_v_write( 2, data2 );
+    pwm_v_write( 0, data[0] );
+    pwm_v_write( 1, data[1] );
+    pwm_v_write( 2, data[2] );
 }
 
 void pixel_v_init( void ){
@@ -668,6 +868,8 @@ void pixel_v_init( void ){
 
     pixels_per_buf = sizeof(pix_buf_A) / bytes_per_pixel;
 
+    select_encoder();
+
     // clear transaction complete flag
     DMA.INTFLAGS = PIXEL_DMA_CH_A_TRNIF_FLAG;
     DMA.INTFLAGS = PIXEL_DMA_CH_B_TRNIF_FLAG;
@@ -743,12 +945,17 @@ uint8_t pixel_u8_get_mode( void ){
     return pix_mode;
 }
 
-void pixel_v_load_rgb(
+uint8_t pixel_u8_get_rgb_order( void ){
+
+    return pix_rgb_order;
+}
+
+void pixel_v_load_channels(
     uint16_t index,
     uint16_t len,
-    uint8_t *r,
-    uint8_t *g,
-    uint8_t *b,
+    uint8_t *ch0,
+    uint8_t *ch1,
+    uint8_t *ch2,
     uint8_t *d ){
 
     uint16_t transfer_count = len;
@@ -765,30 +972,141 @@ void pixel_v_load_rgb(
         return;
     }
 
-    // need to do the copy with interrupts disabled,
-    // so that way we have access into the arrays without
-    // the pixel driver touching them
+    uint16_t pix_count = get_frame_pix_count();
+
+    // sequential loads fill the strip from index 0 up, and the frame
+    // is complete when the end of the strip is loaded.
+    // they cover every pixel, so they never copy from the front frame.
+    if( ( index == 0 ) || ( back_loading && ( index == load_end ) ) ){
+
+        // interrupts are disabled so the pixel driver cannot swap
+        // the frames in the middle of a copy
+        ATOMIC;
+
+        if( index == 0 ){
+
+            if( back_ready ){
+
+                // the previous frame was never sent
+                if( ( pix_mode != PIX_MODE_OFF ) && ( pix_mode != PIX_MODE_ANALOG ) ){
+
+                    pix_frames_dropped++;
+                }
+
+                back_ready = FALSE;
+            }
+
+            back_loading = TRUE;
+            load_frame_starts = 0;
+        }
+
+        memcpy( &back_frame->ch0[index], ch0, transfer_count );
+        memcpy( &back_frame->ch1[index], ch1, transfer_count );
+        memcpy( &back_frame->ch2[index], ch2, transfer_count );
+        memcpy( &back_frame->misc.dither[index], d, transfer_count );
+
+        load_end = index + transfer_count;
+
+        if( load_end >= pix_count ){
+
+            back_loading = FALSE;
+            back_synced = TRUE;
+            back_ready = TRUE;
+        }
+
+        END_ATOMIC;
+
+        return;
+    }
+
+    // any other load updates part of the strip and is sent as soon
+    // as possible.  the rest of the back frame may hold an older
+    // frame, so bring it up to date first.
     ATOMIC;
 
-    memcpy( &array_r[index], r, transfer_count );
-    memcpy( &array_g[index], g, transfer_count );
-    memcpy( &array_b[index], b, transfer_count );
-    memcpy( &array_misc.dither[index], d, transfer_count );
+    bool was_loading = back_loading;
+    back_loading = FALSE;
+
+    END_ATOMIC;
+
+    // back frame is neither loading nor ready, so the pixel driver
+    // will not touch it and this does not need to be atomic.
+    if( !back_synced ){
+
+        uint16_t start = was_loading ? load_end : 0;
+        uint16_t end = index + transfer_count;
+
+        if( end < start ){
+
+            end = start;
+        }
+
+        copy_from_front( start, index );
+        copy_from_front( end, pix_count );
+
+        back_synced = TRUE;
+    }
+
+    ATOMIC;
+
+    memcpy( &back_frame->ch0[index], ch0, transfer_count );
+    memcpy( &back_frame->ch1[index], ch1, transfer_count );
+    memcpy( &back_frame->ch2[index], ch2, transfer_count );
+    memcpy( &back_frame->misc.dither[index], d, transfer_count );
+
+    back_ready = TRUE;
 
     END_ATOMIC;
 }
 
+void pixel_v_load_rgb(
+    uint16_t index,
+    uint16_t len,
+    uint8_t *r,
+    uint8_t *g,
+    uint8_t *b,
+    uint8_t *d ){
+
+    uint8_t ch_r = pix_u8_get_channel( pix_rgb_order, PIX_COLOR_RED );
+    uint8_t ch_g = pix_u8_get_channel( pix_rgb_order, PIX_COLOR_GREEN );
+    uint8_t ch_b = pix_u8_get_channel( pix_rgb_order, PIX_COLOR_BLUE );
+
+    uint8_t *channels[3];
+    channels[ch_r] = r;
+    channels[ch_g] = g;
+    channels[ch_b] = b;
+
+    // move dither bits from RGB order into wire order.
+    // RGBW uses this array for white, so leave it alone.
+    if( ( pix_mode != PIX_MODE_SK6812_RGBW ) && ( pix_rgb_order != PIX_ORDER_RGB ) ){
+
+        uint8_t shift_r = 4 - ( ch_r * 2 );
+        uint8_t shift_g = 4 - ( ch_g * 2 );
+        uint8_t shift_b = 4 - ( ch_b * 2 );
+
+        for( uint16_t i = 0; i < len; i++ ){
+
+            d[i] = ( ( ( d[i] >> 4 ) & 0x03 ) << shift_r ) |
+                   ( ( ( d[i] >> 2 ) & 0x03 ) << shift_g ) |
+                   ( ( ( d[i] >> 0 ) & 0x03 ) << shift_b );
+        }
+    }
+
+    pixel_v_load_channels( index, len, channels[0], channels[1], channels[2], d );
+}
+
 void pixel_v_get_rgb_totals( uint16_t *r, uint16_t *g, uint16_t *b ){
 
-    *r = 0;
-    *g = 0;
-    *b = 0;
+    uint16_t totals[3] = { 0, 0, 0 };
 
     for( uint16_t i = 0; i < gfx_u16_get_pix_count(); i++ ){
 
-        r += array_r[i];
-        g += array_g[i];
-        b += array_b[i];
+        totals[0] += front_frame->ch0[i];
+        totals[1] += front_frame->ch1[i];
+        totals[2] += front_frame->ch2[i];
     }
-}
 
+    *r = totals[pix_u8_get_channel( pix_rgb_order, PIX_COLOR_RED )];
+    *g = totals[pix_u8_get_channel( pix_rgb_order, PIX_COLOR_GREEN )];
+    *b = totals[pix_u8_get_channel( pix_rgb_order, PIX_COLOR_BLUE )];
+}
@@ -26,15 +26,6 @@
 #include "keyvalue.h"
 #include "pix_modes.h"
 
-#define PIX_ORDER_RGB       0
-#define PIX_ORDER_RBG       1
-#define PIX_ORDER_GRB       2
-#define PIX_ORDER_BGR       3
-#define PIX_ORDER_BRG       4
-#define PIX_ORDER_GBR       5
-
-
-
 #define PIX_DMA_BUF_SIZE 192
 
 
@@ -75,6 +66,7 @@ void pixel_v_set_analog_rgb( uint16_t r, uint16_t g, uint16_t b );
 bool pixel_b_enabled( void );
 
 uint8_t pixel_u8_get_mode( void );
+uint8_t pixel_u8_get_rgb_order( void );
 
 void pixel_v_load_rgb(
     uint16_t index,
@@ -84,6 +76,14 @@ void pixel_v_load_rgb(
     uint8_t *b,
     uint8_t *d );
 
+void pixel_v_load_channels(
+    uint16_t index,
+    uint16_t len,
+    uint8_t *ch0,
+    uint8_t *ch1,
+    uint8_t *ch2,
+    uint8_t *d );
+
 void pixel_v_get_rgb_totals( uint16_t *r, uint16_t *g, uint16_t *b );
 
 #endif
@@ -45,6 +45,8 @@ void svr_v_init( void ){
     // set timeout
     sock_v_set_timeout( sock, CHROMA_SERVER_TIMEOUT );
 
+    sock_i8_set_rx_depth( sock, CHROMA_SERVER_RX_QUEUE_DEPTH );
+
 
     // start server
     thread_t_create( server_thread,
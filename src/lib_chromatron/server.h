@@ -29,6 +29,11 @@
 
 #define CHROMA_SERVER_TIMEOUT           8
 
+// pixel frames buffered while the server is busy
+#ifndef CHROMA_SERVER_RX_QUEUE_DEPTH
+    #define CHROMA_SERVER_RX_QUEUE_DEPTH    3
+#endif
+
 #define CHROMA_MSG_TYPE_HSV                1
 #define CHROMA_MSG_TYPE_RGB                2
 typedef struct{
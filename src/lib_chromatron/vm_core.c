@@ -38,6 +38,46 @@
 
 static uint16_t cycles;
 
+
+// opcodes the loader looks for when predecoding
+#define OPCODE_COMPEQ               2
+#define OPCODE_COMPLTE              7
+#define OPCODE_ADD                  10
+#define OPCODE_SUB                  11
+#define OPCODE_MUL                  12
+#define OPCODE_JMP_IF_Z             16
+#define OPCODE_JMP_IF_L_PRE_INC     20
+#define OPCODE_LTA                  24
+#define OPCODE_LFA                  25
+#define OPCODE_LIB_CALL             44
+
+// predecoded opcodes.
+// these are never emitted by the compiler, vm_i8_load_program rewrites
+// the first opcode of a sequence in place and leaves the remaining bytes
+// alone, so instruction addresses (and jumps into the middle of a
+// sequence) are unaffected.
+#define OPCODE_COMPEQ_JMP_IF_Z      240 // through 245, same order as compares
+#define OPCODE_LFA_ADD_LTA          246
+#define OPCODE_LFA_SUB_LTA          247
+#define OPCODE_LFA_MUL_LTA          248
+#define OPCODE_LOOP_BACK            249
+
+#ifdef VM_ENABLE_PREDECODE
+// instruction lengths in bytes, including the opcode.
+// 0 indicates an invalid opcode.
+// lib_call is variable length, this is the fixed part.
+static const uint8_t opcode_len[] = {
+    3, 2, 4, 4, 4, 4, 4, 4,     // 0
+    4, 4, 4, 4, 4, 4, 4, 3,     // 8
+    4, 4, 4, 5, 5, 2, 2, 3,     // 16
+    5, 5, 7, 7, 5, 5, 5, 5,     // 24
+    5, 5, 6, 6, 6, 6, 6, 6,     // 32
+    4, 2, 1, 5, 7, 0, 0, 0,     // 40
+    0, 5, 5, 5, 5, 0, 5, 5,     // 48
+    3, 6, 6,                    // 56
+};
+#endif
+
 static int8_t _vm_i8_run_stream(
     uint8_t *stream,
     uint16_t offset,
@@ -290,16 +330,16 @@ static int8_t _vm_i8_run_stream(
         &&opcode_trap,	            // 237
         &&opcode_trap,	            // 238
         &&opcode_trap,	            // 239
-        &&opcode_trap,	            // 240
-        &&opcode_trap,	            // 241
-        &&opcode_trap,	            // 242
-        &&opcode_trap,	            // 243
-        &&opcode_trap,	            // 244
-        &&opcode_trap,	            // 245
-        &&opcode_trap,	            // 246
-        &&opcode_trap,	            // 247
-        &&opcode_trap,	            // 248
-        &&opcode_trap,	            // 249
+        &&opcode_compeq_jmp_if_z,	// 240
+        &&opcode_compneq_jmp_if_z,	// 241
+        &&opcode_compgt_jmp_if_z,	// 242
+        &&opcode_compgte_jmp_if_z,	// 243
+        &&opcode_complt_jmp_if_z,	// 244
+        &&opcode_complte_jmp_if_z,	// 245
+        &&opcode_lfa_add_lta,	    // 246
+        &&opcode_lfa_sub_lta,	    // 247
+        &&opcode_lfa_mul_lta,	    // 248
+        &&opcode_loop_back,	        // 249
         &&opcode_trap,	            // 250
         &&opcode_trap,	            // 251
         &&opcode_trap,	            // 252
@@ -314,14 +354,17 @@ static int8_t _vm_i8_run_stream(
     int32_t params[8];
     uint16_t addr;
     catbus_hash_t32 hash;
+    int8_t status;
 
-dispatch:
-    cycles++;
+    // keep the cycle counter in a register while we run.
+    // the budget is only checked on backward branches and calls, since
+    // those are the only way to run more instructions than there are
+    // in the code section.  the count itself is still per instruction,
+    // so max_cycles reports the same as before.
+    uint16_t cycle_count = cycles;
 
-    if( cycles > VM_MAX_CYCLES ){
-
-        return VM_STATUS_ERR_MAX_CYCLES;
-    }
+dispatch:
+    cycle_count++;
 
     opcode = *pc++;
 
@@ -433,6 +476,124 @@ opcode_complte:
 
 
 
+// predecoded compare followed by a jmp_if_z on the compare result.
+// layout after the opcode:
+// compare: result, op1, op2
+// jmp_if_z: opcode, op1, addr_lo, addr_hi
+opcode_compeq_jmp_if_z:
+
+    op1 = data[pc[1]] == data[pc[2]];
+    data[pc[0]] = op1;
+
+    addr = pc[5];
+    addr += pc[6] << 8;
+
+    cycle_count++;
+    pc += 7;
+
+    if( op1 == 0 ){
+
+        goto jump;
+    }
+
+    goto dispatch;
+
+
+opcode_compneq_jmp_if_z:
+
+    op1 = data[pc[1]] != data[pc[2]];
+    data[pc[0]] = op1;
+
+    addr = pc[5];
+    addr += pc[6] << 8;
+
+    cycle_count++;
+    pc += 7;
+
+    if( op1 == 0 ){
+
+        goto jump;
+    }
+
+    goto dispatch;
+
+
+opcode_compgt_jmp_if_z:
+
+    op1 = data[pc[1]] > data[pc[2]];
+    data[pc[0]] = op1;
+
+    addr = pc[5];
+    addr += pc[6] << 8;
+
+    cycle_count++;
+    pc += 7;
+
+    if( op1 == 0 ){
+
+        goto jump;
+    }
+
+    goto dispatch;
+
+
+opcode_compgte_jmp_if_z:
+
+    op1 = data[pc[1]] >= data[pc[2]];
+    data[pc[0]] = op1;
+
+    addr = pc[5];
+    addr += pc[6] << 8;
+
+    cycle_count++;
+    pc += 7;
+
+    if( op1 == 0 ){
+
+        goto jump;
+    }
+
+    goto dispatch;
+
+
+opcode_complt_jmp_if_z:
+
+    op1 = data[pc[1]] < data[pc[2]];
+    data[pc[0]] = op1;
+
+    addr = pc[5];
+    addr += pc[6] << 8;
+
+    cycle_count++;
+    pc += 7;
+
+    if( op1 == 0 ){
+
+        goto jump;
+    }
+
+    goto dispatch;
+
+
+opcode_complte_jmp_if_z:
+
+    op1 = data[pc[1]] <= data[pc[2]];
+    data[pc[0]] = op1;
+
+    addr = pc[5];
+    addr += pc[6] << 8;
+
+    cycle_count++;
+    pc += 7;
+
+    if( op1 == 0 ){
+
+        goto jump;
+    }
+
+    goto dispatch;
+
+
 opcode_and:
 
     result = *pc++;
@@ -524,8 +685,15 @@ opcode_mod:
 
 opcode_jmp:
 
-    addr = *pc++;
-    addr += ( *pc ) << 8;
+    addr = pc[0];
+    addr += pc[1] << 8;
+
+    if( ( stream + addr ) < pc ){
+
+        pc = stream + addr;
+
+        goto check_cycles;
+    }
 
     pc = stream + addr;
 
@@ -534,14 +702,16 @@ opcode_jmp:
 
 opcode_jmp_if_z:
 
-    op1_addr = *pc++;
+    op1_addr = pc[0];
 
-    addr = *pc++;
-    addr += ( *pc++ ) << 8;
+    addr = pc[1];
+    addr += pc[2] << 8;
+
+    pc += 3;
 
     if( data[op1_addr] == 0 ){
 
-        pc = stream + addr;
+        goto jump;
     }
 
     goto dispatch;
@@ -549,14 +719,16 @@ opcode_jmp_if_z:
 
 opcode_jmp_if_not_z:
 
-    op1_addr = *pc++;
+    op1_addr = pc[0];
 
-    addr = *pc++;
-    addr += ( *pc++ ) << 8;
+    addr = pc[1];
+    addr += pc[2] << 8;
+
+    pc += 3;
 
     if( data[op1_addr] != 0 ){
 
-        pc = stream + addr;
+        goto jump;
     }
 
     goto dispatch;
@@ -564,34 +736,36 @@ opcode_jmp_if_not_z:
 
 opcode_jmp_if_z_dec:
 
-    op1_addr = *pc++;
+    op1_addr = pc[0];
 
-    addr = *pc++;
-    addr += ( *pc++ ) << 8;
+    addr = pc[1];
+    addr += pc[2] << 8;
+
+    pc += 3;
 
     if( data[op1_addr] == 0 ){
 
-        pc = stream + addr;
+        goto jump;
     }
-    else{
 
-        data[op1_addr]--;
-    }
+    data[op1_addr]--;
 
     goto dispatch;
 
 
 opcode_jmp_if_gte:
 
-    op1_addr = *pc++;
-    op2_addr = *pc++;
+    op1_addr = pc[0];
+    op2_addr = pc[1];
 
-    addr = *pc++;
-    addr += ( *pc++ ) << 8;
+    addr = pc[2];
+    addr += pc[3] << 8;
+
+    pc += 4;
 
     if( data[op1_addr] >= data[op2_addr] ){
 
-        pc = stream + addr;
+        goto jump;
     }
 
     goto dispatch;
@@ -599,21 +773,74 @@ opcode_jmp_if_gte:
 
 opcode_jmp_if_l_pre_inc:
 
-    op1_addr = *pc++;
-    op2_addr = *pc++;
+    op1_addr = pc[0];
+    op2_addr = pc[1];
 
     data[op1_addr]++;
 
     if( data[op1_addr] < data[op2_addr] ){
 
-        addr = *pc++;
-        addr += ( *pc ) << 8;
+        addr = pc[2];
+        addr += pc[3] << 8;
+
+        pc += 4;
+
+        goto jump;
+    }
+
+    pc += 4;
+
+    goto dispatch;
+
+
+// predecoded jmp_if_l_pre_inc with a backward target (a loop head).
+// the loader has already verified the target, so we can go straight
+// to the budget check.
+opcode_loop_back:
+
+    op1_addr = pc[0];
+    op2_addr = pc[1];
+
+    data[op1_addr]++;
+
+    if( data[op1_addr] < data[op2_addr] ){
+
+        addr = pc[2];
+        addr += pc[3] << 8;
 
         pc = stream + addr;
+
+        goto check_cycles;
     }
-    else{
 
-        pc += 2;
+    pc += 4;
+
+    goto dispatch;
+
+
+// common tail for conditional jumps.
+// pc must already point to the next instruction.
+jump:
+
+    if( ( stream + addr ) < pc ){
+
+        pc = stream + addr;
+
+        goto check_cycles;
+    }
+
+    pc = stream + addr;
+
+    goto dispatch;
+
+
+check_cycles:
+
+    if( cycle_count > VM_MAX_CYCLES ){
+
+        status = VM_STATUS_ERR_MAX_CYCLES;
+
+        goto exit;
     }
 
     goto dispatch;
@@ -633,18 +860,33 @@ opcode_ret:
     op1_addr = *pc++;
     data[RETURN_VAL_ADDR] = data[op1_addr];
 
-    return VM_STATUS_OK;
+    status = VM_STATUS_OK;
+
+    goto exit;
 
 
 opcode_call:
     addr = *pc++;
     addr += ( *pc++ ) << 8;
 
-    // call function, by recursively calling into VM
-    int8_t status = _vm_i8_run_stream( stream, addr, rng_seed, data );
+    if( cycle_count > VM_MAX_CYCLES ){
+
+        status = VM_STATUS_ERR_MAX_CYCLES;
+
+        goto exit;
+    }
+
+    // call function, by recursively calling into VM.
+    // the callee picks up the cycle count from the global.
+    cycles = cycle_count;
+
+    status = _vm_i8_run_stream( stream, addr, rng_seed, data );
+
+    cycle_count = cycles;
+
     if( status < 0 ){
 
-        return status;
+        goto exit;
     }
 
     goto dispatch;
@@ -678,6 +920,64 @@ opcode_lfa:
     goto dispatch;
 
 
+// predecoded lfa + op + lta on the same array element.
+// the loader only fuses these when the index and size registers are not
+// written by the sequence, so we can compute the element once.
+// layout after the opcode:
+// lfa: dest, src, index, size
+// op:  opcode, result, op1, op2
+// lta: opcode, dest, src, index, size
+opcode_lfa_add_lta:
+
+    index = data[pc[2]];
+    size = data[pc[3]];
+
+    index %= size;
+
+    data[pc[0]] = data[pc[1] + index];
+    data[pc[5]] = data[pc[6]] + data[pc[7]];
+    data[pc[1] + index] = data[pc[10]];
+
+    cycle_count += 2;
+    pc += 13;
+
+    goto dispatch;
+
+
+opcode_lfa_sub_lta:
+
+    index = data[pc[2]];
+    size = data[pc[3]];
+
+    index %= size;
+
+    data[pc[0]] = data[pc[1] + index];
+    data[pc[5]] = data[pc[6]] - data[pc[7]];
+    data[pc[1] + index] = data[pc[10]];
+
+    cycle_count += 2;
+    pc += 13;
+
+    goto dispatch;
+
+
+opcode_lfa_mul_lta:
+
+    index = data[pc[2]];
+    size = data[pc[3]];
+
+    index %= size;
+
+    data[pc[0]] = data[pc[1] + index];
+    data[pc[5]] = data[pc[6]] * data[pc[7]];
+    data[pc[1] + index] = data[pc[10]];
+
+    cycle_count += 2;
+    pc += 13;
+
+    goto dispatch;
+
+
 opcode_lfa2d:
 
     dest = *pc++;
@@ -1117,16 +1417,18 @@ opcode_assert:
         #ifndef VM_TARGET_ESP
         // log_v_debug_P( PSTR("VM assertion failed") );
         #endif
-        return VM_STATUS_ASSERT;
+        status = VM_STATUS_ASSERT;
+
+        goto exit;
     }
 
     goto dispatch;
 
 opcode_halt:
 
-    return VM_STATUS_HALT;
+    status = VM_STATUS_HALT;
 
-    goto dispatch;
+    goto exit;
 
 
 opcode_is_fading:
@@ -1198,9 +1500,132 @@ opcode_db_store:
 
 
 opcode_trap:
-    return VM_STATUS_TRAP;
+    status = VM_STATUS_TRAP;
+
+exit:
+    cycles = cycle_count;
+
+    return status;
+}
+
+
+#ifdef VM_ENABLE_PREDECODE
+static uint8_t _vm_u8_instruction_len( uint8_t *pc, uint8_t *end ){
+
+    if( *pc >= sizeof(opcode_len) ){
+
+        return 0;
+    }
+
+    uint8_t len = opcode_len[*pc];
+
+    if( ( len == 0 ) || ( ( pc + len ) > end ) ){
+
+        return 0;
+    }
+
+    if( *pc == OPCODE_LIB_CALL ){
+
+        len += pc[6];
+
+        if( ( pc + len ) > end ){
+
+            return 0;
+        }
+    }
+
+    return len;
 }
 
+// rewrite common instruction sequences into predecoded superinstructions.
+// only the first opcode of each sequence is changed.
+static void _vm_v_predecode( uint8_t *code, uint16_t code_len ){
+
+    uint8_t *pc = code;
+    uint8_t *end = code + code_len;
+
+    while( pc < end ){
+
+        uint8_t len = _vm_u8_instruction_len( pc, end );
+
+        if( len == 0 ){
+
+            // unknown opcode (or the zero padding at the end of the
+            // code section running off the end), stop here.
+            // the rest of the code runs unmodified.
+            break;
+        }
+
+        uint8_t *next = pc + len;
+        uint8_t next_len = 0;
+
+        if( next < end ){
+
+            next_len = _vm_u8_instruction_len( next, end );
+        }
+
+        // compare followed by jmp_if_z on the compare result
+        if( ( pc[0] >= OPCODE_COMPEQ ) &&
+            ( pc[0] <= OPCODE_COMPLTE ) &&
+            ( next_len > 0 ) &&
+            ( next[0] == OPCODE_JMP_IF_Z ) &&
+            ( next[1] == pc[1] ) ){
+
+            pc[0] = OPCODE_COMPEQ_JMP_IF_Z + ( pc[0] - OPCODE_COMPEQ );
+        }
+        // lfa, arithmetic, lta on the same array element
+        else if( ( pc[0] == OPCODE_LFA ) &&
+                 ( next_len > 0 ) &&
+                 ( ( next[0] == OPCODE_ADD ) ||
+                   ( next[0] == OPCODE_SUB ) ||
+                   ( next[0] == OPCODE_MUL ) ) &&
+                 ( ( next + next_len ) < end ) &&
+                 ( _vm_u8_instruction_len( next + next_len, end ) > 0 ) ){
+
+            uint8_t *lta = next + next_len;
+
+            // lta must store to the element we loaded, and neither the
+            // lfa nor the op may overwrite the index or size registers.
+            if( ( lta[0] == OPCODE_LTA ) &&
+                ( lta[1] == pc[2] ) &&
+                ( lta[3] == pc[3] ) &&
+                ( lta[4] == pc[4] ) &&
+                ( pc[1] != pc[3] ) &&
+                ( pc[1] != pc[4] ) &&
+                ( next[1] != pc[3] ) &&
+                ( next[1] != pc[4] ) ){
+
+                if( next[0] == OPCODE_ADD ){
+
+                    pc[0] = OPCODE_LFA_ADD_LTA;
+                }
+                else if( next[0] == OPCODE_SUB ){
+
+                    pc[0] = OPCODE_LFA_SUB_LTA;
+                }
+                else{
+
+                    pc[0] = OPCODE_LFA_MUL_LTA;
+                }
+            }
+        }
+        // loop head: jmp_if_l_pre_inc jumping backwards
+        else if( pc[0] == OPCODE_JMP_IF_L_PRE_INC ){
+
+            uint16_t addr = pc[3];
+            addr += pc[4] << 8;
+
+            if( ( code + addr ) <= pc ){
+
+                pc[0] = OPCODE_LOOP_BACK;
+            }
+        }
+
+        pc = next;
+    }
+}
+#endif
+
 
 int8_t vm_i8_run(
     uint8_t *stream,
@@ -1439,6 +1864,10 @@ int8_t vm_i8_load_program(
 
     state->data_start += sizeof(uint32_t);
 
+    #ifdef VM_ENABLE_PREDECODE
+    _vm_v_predecode( stream + state->code_start, prog_header->code_len );
+    #endif
+
     // init RNG seed
     state->rng_seed = 1;
 
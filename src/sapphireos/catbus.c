@@ -51,7 +51,11 @@ typedef struct{
     catbus_hash_t32 source_hash;
     catbus_hash_t32 dest_hash;
     int8_t ttl;
+    uint8_t flags;
+    uint8_t expire_tick;
+    list_node_t wheel_next;
 } catbus_send_data_entry_t;
+#define CATBUS_SEND_FLAGS_BATCH         0x01
 
 typedef struct{
     sock_addr_t raddr;
@@ -59,14 +63,72 @@ typedef struct{
     int32_t data;
     uint16_t sequence;
     int8_t ttl;
+    uint8_t expire_tick;
+    list_node_t wheel_next;
 } catbus_receive_data_entry_t;
 
+// send and receive entries expire on a timing wheel that advances once
+// per announce cycle.  a refresh only moves the entry's expire tick.
+// when a wheel slot comes due, each entry chained on it is either
+// expired or refiled under its current expire tick.
+// the ttl field is only updated for the vfile readers.
+#define CATBUS_LINK_TTL                 32 // seconds
+#define CATBUS_LINK_TICK                4  // seconds per wheel tick
+#define CATBUS_LINK_TTL_TICKS           ( ( CATBUS_LINK_TTL / CATBUS_LINK_TICK ) + 1 )
+#define CATBUS_LINK_WHEEL_SLOTS         16 // power of 2, more than CATBUS_LINK_TTL_TICKS
+
 static bool link_enable;
 static list_t links;
 static list_t send_list;
 static list_t receive_cache;
 static uint16_t sequence;
 static uint8_t send_list_locked;
+
+#if ( CATBUS_SEND_INDEX_SLOTS > 128 ) || ( CATBUS_RX_CACHE_INDEX_SLOTS > 128 )
+    #error "catbus index tables are limited to 128 slots"
+#endif
+
+static uint8_t link_tick;
+static list_node_t send_wheel[CATBUS_LINK_WHEEL_SLOTS];
+static list_node_t receive_wheel[CATBUS_LINK_WHEEL_SLOTS];
+
+// open addressed indexes of list nodes.
+// send_index is keyed by source hash, receive_index by sender and dest hash.
+static list_node_t send_index[CATBUS_SEND_INDEX_SLOTS];
+static uint8_t send_index_overflow;
+static list_node_t receive_index[CATBUS_RX_CACHE_INDEX_SLOTS];
+static uint8_t receive_index_overflow;
+
+#if CATBUS_PUBLISH_SLOTS > 32
+    #error "CATBUS_PUBLISH_SLOTS must be 32 or fewer"
+#endif
+
+// publish engine state.
+// a slot is in use while its bit is set in either pending or sending.
+static catbus_hash_t32 publish_hashes[CATBUS_PUBLISH_SLOTS];
+static uint32_t publish_pending;
+static uint32_t publish_sending;
+// set when the slots overflow or on the periodic refresh:
+// the next pass sends every send entry.
+static bool publish_all_pending;
+static bool publish_all_sending;
+static uint32_t publish_pending_since;
+static uint8_t publish_tokens;
+static uint32_t publish_token_time;
+
+static uint32_t publish_sent;
+static uint32_t publish_coalesced;
+static uint32_t publish_overflows;
+static uint16_t publish_latency;
+static uint16_t publish_max_latency;
+
+KV_SECTION_META kv_meta_t catbus_publish_kv[] = {
+    { SAPPHIRE_TYPE_UINT32,  0, KV_FLAGS_READ_ONLY, &publish_sent,        0, "catbus_publish_sent" },
+    { SAPPHIRE_TYPE_UINT32,  0, KV_FLAGS_READ_ONLY, &publish_coalesced,   0, "catbus_publish_coalesced" },
+    { SAPPHIRE_TYPE_UINT32,  0, KV_FLAGS_READ_ONLY, &publish_overflows,   0, "catbus_publish_overflows" },
+    { SAPPHIRE_TYPE_UINT16,  0, KV_FLAGS_READ_ONLY, &publish_latency,     0, "catbus_publish_latency" },
+    { SAPPHIRE_TYPE_UINT16,  0, KV_FLAGS_READ_ONLY, &publish_max_latency, 0, "catbus_publish_max_latency" },
+};
 #endif
 
 static socket_t sock;
@@ -80,6 +142,9 @@ static catbus_hash_t32 meta_tag_hashes[CATBUS_QUERY_LEN];
 
 PT_THREAD( catbus_server_thread( pt_t *pt, void *state ) );
 PT_THREAD( catbus_announce_thread( pt_t *pt, void *state ) );
+#ifdef ENABLE_CATBUS_LINK
+PT_THREAD( catbus_publish_thread( pt_t *pt, void *state ) );
+#endif
 
 
 // static uint32_t test_array[8];
@@ -120,6 +185,219 @@ static const PROGMEM catbus_hash_t32 meta_tag_names[CATBUS_QUERY_LEN] = {
 };
 
 #ifdef ENABLE_CATBUS_LINK
+static uint8_t _catbus_u8_send_key_home( catbus_hash_t32 source_hash ){
+
+    source_hash ^= source_hash >> 16;
+    source_hash ^= source_hash >> 8;
+
+    return source_hash & ( CATBUS_SEND_INDEX_SLOTS - 1 );
+}
+
+static uint8_t _catbus_u8_send_home( list_node_t ln ){
+
+    catbus_send_data_entry_t *entry = (catbus_send_data_entry_t *)list_vp_get_data( ln );
+
+    return _catbus_u8_send_key_home( entry->source_hash );
+}
+
+static uint8_t _catbus_u8_receive_key_home( sock_addr_t *raddr, catbus_hash_t32 dest_hash ){
+
+    uint32_t h = dest_hash ^ ip_u32_to_int( raddr->ipaddr ) ^ raddr->port;
+
+    h ^= h >> 16;
+    h ^= h >> 8;
+
+    return h & ( CATBUS_RX_CACHE_INDEX_SLOTS - 1 );
+}
+
+static uint8_t _catbus_u8_receive_home( list_node_t ln ){
+
+    catbus_receive_data_entry_t *entry = (catbus_receive_data_entry_t *)list_vp_get_data( ln );
+
+    return _catbus_u8_receive_key_home( &entry->raddr, entry->dest_hash );
+}
+
+static void _catbus_v_index_insert( 
+    list_node_t *index, 
+    uint8_t size, 
+    uint8_t home, 
+    list_node_t ln,
+    uint8_t *overflow ){
+
+    for( uint8_t i = 0; i < size; i++ ){
+
+        uint8_t slot = ( home + i ) & ( size - 1 );
+
+        if( index[slot] < 0 ){
+
+            index[slot] = ln;
+
+            return;
+        }
+    }
+
+    // table full, lookups will fall back to the list
+    (*overflow)++;
+}
+
+static void _catbus_v_index_remove( 
+    list_node_t *index, 
+    uint8_t size, 
+    uint8_t (*home)( list_node_t ln ), 
+    list_node_t ln,
+    uint8_t *overflow ){
+
+    uint8_t mask = size - 1;
+    uint8_t slot = home( ln );
+    uint8_t i;
+
+    for( i = 0; i < size; i++ ){
+
+        if( index[slot] == ln ){
+
+            break;
+        }
+
+        if( index[slot] < 0 ){
+
+            i = size;
+            break;
+        }
+
+        slot = ( slot + 1 ) & mask;
+    }
+
+    if( i >= size ){
+
+        // was not indexed
+        if( *overflow > 0 ){
+
+            (*overflow)--;
+        }
+
+        return;
+    }
+
+    // backward shift delete: pull later entries in the probe run
+    // into the hole if that does not move them before their home.
+    uint8_t hole = slot;
+    uint8_t next = slot;
+
+    for( uint8_t j = 1; j < size; j++ ){
+
+        next = ( next + 1 ) & mask;
+
+        if( index[next] < 0 ){
+
+            break;
+        }
+
+        uint8_t h = home( index[next] );
+
+        if( ( ( next - h ) & mask ) >= ( ( next - hole ) & mask ) ){
+
+            index[hole] = index[next];
+            hole = next;
+        }
+    }
+
+    index[hole] = -1;
+}
+
+static void _catbus_v_wheel_insert( list_node_t *wheel, list_node_t ln, uint8_t expire_tick, list_node_t *wheel_next ){
+
+    uint8_t slot = expire_tick & ( CATBUS_LINK_WHEEL_SLOTS - 1 );
+
+    *wheel_next = wheel[slot];
+    wheel[slot] = ln;
+}
+
+static int8_t _catbus_i8_ttl( uint8_t expire_tick ){
+
+    return ( (int8_t)( expire_tick - link_tick ) * CATBUS_LINK_TICK ) - CATBUS_LINK_TICK;
+}
+
+static void _catbus_v_update_ttls( void ){
+
+    list_node_t ln = send_list.head;
+
+    while( ln > 0 ){
+
+        catbus_send_data_entry_t *entry = (catbus_send_data_entry_t *)list_vp_get_data( ln );
+
+        entry->ttl = _catbus_i8_ttl( entry->expire_tick );
+
+        ln = list_ln_next( ln );
+    }
+
+    ln = receive_cache.head;
+
+    while( ln > 0 ){
+
+        catbus_receive_data_entry_t *entry = (catbus_receive_data_entry_t *)list_vp_get_data( ln );
+
+        entry->ttl = _catbus_i8_ttl( entry->expire_tick );
+
+        ln = list_ln_next( ln );
+    }
+}
+
+// process the wheel slots due on the current tick
+static void _catbus_v_expire_send_list( void ){
+
+    uint8_t slot = link_tick & ( CATBUS_LINK_WHEEL_SLOTS - 1 );
+    list_node_t ln = send_wheel[slot];
+    send_wheel[slot] = -1;
+
+    while( ln > 0 ){
+
+        catbus_send_data_entry_t *entry = (catbus_send_data_entry_t *)list_vp_get_data( ln );
+        list_node_t next_ln = entry->wheel_next;
+
+        if( (int8_t)( link_tick - entry->expire_tick ) >= 0 ){
+
+            _catbus_v_index_remove( send_index, CATBUS_SEND_INDEX_SLOTS, _catbus_u8_send_home, ln, &send_index_overflow );
+
+            list_v_remove( &send_list, ln );
+            list_v_release_node( ln );
+        }
+        else{
+
+            // refreshed since it was filed
+            _catbus_v_wheel_insert( send_wheel, ln, entry->expire_tick, &entry->wheel_next );
+        }
+
+        ln = next_ln;
+    }
+}
+
+static void _catbus_v_expire_receive_cache( void ){
+
+    uint8_t slot = link_tick & ( CATBUS_LINK_WHEEL_SLOTS - 1 );
+    list_node_t ln = receive_wheel[slot];
+    receive_wheel[slot] = -1;
+
+    while( ln > 0 ){
+
+        catbus_receive_data_entry_t *entry = (catbus_receive_data_entry_t *)list_vp_get_data( ln );
+        list_node_t next_ln = entry->wheel_next;
+
+        if( (int8_t)( link_tick - entry->expire_tick ) >= 0 ){
+
+            _catbus_v_index_remove( receive_index, CATBUS_RX_CACHE_INDEX_SLOTS, _catbus_u8_receive_home, ln, &receive_index_overflow );
+
+            list_v_remove( &receive_cache, ln );
+            list_v_release_node( ln );
+        }
+        else{
+
+            _catbus_v_wheel_insert( receive_wheel, ln, entry->expire_tick, &entry->wheel_next );
+        }
+
+        ln = next_ln;
+    }
+}
+
 static uint16_t links_vfile_handler(
     vfile_op_t8 op,
     uint32_t pos,
@@ -160,6 +438,11 @@ static uint16_t sendlist_vfile_handler(
     switch( op ){
 
         case FS_VFILE_OP_READ:
+            if( pos == 0 ){
+
+                _catbus_v_update_ttls();
+            }
+
             list_u16_flatten( &send_list, pos, ptr, len );
             break;
 
@@ -189,6 +472,11 @@ static uint16_t receive_cache_vfile_handler(
     switch( op ){
 
         case FS_VFILE_OP_READ:
+            if( pos == 0 ){
+
+                _catbus_v_update_ttls();
+            }
+
             list_u16_flatten( &receive_cache, pos, ptr, len );
             break;
 
@@ -348,9 +636,30 @@ void catbus_v_init( void ){
         list_v_init( &send_list );
         list_v_init( &receive_cache );
 
+        for( uint8_t i = 0; i < CATBUS_LINK_WHEEL_SLOTS; i++ ){
+
+            send_wheel[i] = -1;
+            receive_wheel[i] = -1;
+        }
+
+        for( uint8_t i = 0; i < CATBUS_SEND_INDEX_SLOTS; i++ ){
+
+            send_index[i] = -1;
+        }
+
+        for( uint8_t i = 0; i < CATBUS_RX_CACHE_INDEX_SLOTS; i++ ){
+
+            receive_index[i] = -1;
+        }
+
         fs_f_create_virtual( PSTR("kvlinks"), links_vfile_handler );
         fs_f_create_virtual( PSTR("kvrxcache"), receive_cache_vfile_handler );
         fs_f_create_virtual( PSTR("kvsend"), sendlist_vfile_handler );
+
+        thread_t_create( catbus_publish_thread,
+                         PSTR("catbus_publish"),
+                         0,
+                         0 );
     }
     #endif
 
@@ -489,6 +798,9 @@ static void _catbus_v_send_announce( sock_addr_t *raddr, uint32_t discovery_id )
     _catbus_v_msg_init( &msg->header, CATBUS_MSG_TYPE_ANNOUNCE, discovery_id );
 
     msg->flags = 0;
+    #ifdef ENABLE_CATBUS_LINK
+    msg->flags |= CATBUS_ANNOUNCE_FLAG_LINK_BATCH;
+    #endif
     msg->data_port = sock_u16_get_lport( sock );
 
     _catbus_v_get_query( &msg->query );
@@ -497,23 +809,90 @@ static void _catbus_v_send_announce( sock_addr_t *raddr, uint32_t discovery_id )
 }
 
 #ifdef ENABLE_CATBUS_LINK
+static bool _catbus_b_send_entry_match( 
+    list_node_t ln, 
+    catbus_hash_t32 source_hash, 
+    catbus_hash_t32 dest_hash, 
+    sock_addr_t *raddr ){
+
+    catbus_send_data_entry_t *entry = (catbus_send_data_entry_t *)list_vp_get_data( ln );
+
+    return ( entry->source_hash == source_hash ) && 
+           ( entry->dest_hash == dest_hash ) && 
+           ( memcmp( raddr, &entry->raddr, sizeof(sock_addr_t) ) == 0 );
+}
+
+static list_node_t _catbus_ln_find_send_entry( catbus_hash_t32 source_hash, catbus_hash_t32 dest_hash, sock_addr_t *raddr ){
+
+    uint8_t slot = _catbus_u8_send_key_home( source_hash );
+
+    for( uint8_t i = 0; i < CATBUS_SEND_INDEX_SLOTS; i++ ){
+
+        list_node_t ln = send_index[slot];
+
+        if( ln < 0 ){
+
+            break;
+        }
+
+        if( _catbus_b_send_entry_match( ln, source_hash, dest_hash, raddr ) ){
+
+            return ln;
+        }
+
+        slot = ( slot + 1 ) & ( CATBUS_SEND_INDEX_SLOTS - 1 );
+    }
+
+    if( send_index_overflow == 0 ){
+
+        return -1;
+    }
+
+    list_node_t ln = send_list.head;
+
+    while( ln > 0 ){
+
+        if( _catbus_b_send_entry_match( ln, source_hash, dest_hash, raddr ) ){
+
+            return ln;
+        }
+
+        ln = list_ln_next( ln );
+    }
+
+    return -1;
+}
+
 static void _catbus_v_add_to_send_list( catbus_hash_t32 source_hash, catbus_hash_t32 dest_hash, sock_addr_t *raddr ){
 
     // check if entry already exists
-    list_node_t ln = send_list.head;
+    list_node_t ln = _catbus_ln_find_send_entry( source_hash, dest_hash, raddr );
 
-    while( ln >= 0 ){
+    if( ln > 0 ){
 
         catbus_send_data_entry_t *entry = (catbus_send_data_entry_t *)list_vp_get_data( ln );
 
-        if( ( entry->source_hash == source_hash ) && 
-            ( entry->dest_hash == dest_hash ) && 
-            ( memcmp( raddr, &entry->raddr, sizeof(sock_addr_t) ) == 0 ) ){
+        // reset TTL
+        entry->expire_tick = link_tick + CATBUS_LINK_TTL_TICKS;
 
-            // reset TTL
-            entry->ttl = 32;
+        return;
+    }
 
-            return;
+    // new entry: inherit the capabilities of any existing entry
+    // for this destination
+    uint8_t flags = 0;
+
+    ln = send_list.head;
+
+    while( ln > 0 ){
+
+        catbus_send_data_entry_t *entry = (catbus_send_data_entry_t *)list_vp_get_data( ln );
+
+        if( memcmp( raddr, &entry->raddr, sizeof(sock_addr_t) ) == 0 ){
+
+            flags = entry->flags;
+
+            break;
         }
 
         ln = list_ln_next( ln );
@@ -524,7 +903,9 @@ static void _catbus_v_add_to_send_list( catbus_hash_t32 source_hash, catbus_hash
     entry.source_hash   = source_hash;
     entry.dest_hash     = dest_hash;
     entry.raddr         = *raddr;
-    entry.ttl           = 32;
+    entry.ttl           = CATBUS_LINK_TTL;
+    entry.flags         = flags;
+    entry.expire_tick   = link_tick + CATBUS_LINK_TTL_TICKS;
 
     ln = list_ln_create_node2( &entry, sizeof(entry), MEM_TYPE_CATBUS_SEND );
 
@@ -534,6 +915,11 @@ static void _catbus_v_add_to_send_list( catbus_hash_t32 source_hash, catbus_hash
     }
 
     list_v_insert_tail( &send_list, ln );
+
+    catbus_send_data_entry_t *new_entry = (catbus_send_data_entry_t *)list_vp_get_data( ln );
+    _catbus_v_wheel_insert( send_wheel, ln, new_entry->expire_tick, &new_entry->wheel_next );
+
+    _catbus_v_index_insert( send_index, CATBUS_SEND_INDEX_SLOTS, _catbus_u8_send_key_home( source_hash ), ln, &send_index_overflow );
 }
 
 static bool _catbus_b_compare_links( catbus_link_state_t *state, catbus_link_t link ){
@@ -777,169 +1163,661 @@ int8_t catbus_i8_get(
 
     int8_t status = kv_i8_lookup_hash( hash, &meta, 0 );
 
-    if( status < 0 ){
+    if( status < 0 ){
+
+        return status;
+    }
+
+    union type_converter converter;
+    memset( &converter, 0, sizeof(converter) );
+
+    status = kv_i8_get_by_hash( hash, &converter, sizeof(converter) );
+
+    if( status < 0 ){
+
+        return status;
+    }
+
+    // coerce value to i32
+    switch( meta.type ){
+        case CATBUS_TYPE_BOOL:
+            *data = converter.b;
+            break;
+
+        case CATBUS_TYPE_UINT8:
+            *data = converter.u8;
+            break;
+
+        case CATBUS_TYPE_UINT16:
+            *data = converter.u16;
+            break;
+
+        case CATBUS_TYPE_INT8:
+            *data = converter.i8;
+            break;
+
+        case CATBUS_TYPE_INT16:
+            *data = converter.i16;
+            break;
+
+        case CATBUS_TYPE_INT32:
+            *data = converter.i32;
+            break;
+            
+        case CATBUS_TYPE_UINT32:
+            if( converter.u32 > INT32_MAX ){
+
+                converter.u32 = INT32_MAX;
+            }
+
+            *data = converter.u32;
+
+            break;
+
+        case CATBUS_TYPE_UINT64:
+            if( converter.u64 > INT32_MAX ){
+
+                converter.u64 = INT32_MAX;
+            }
+
+            *data = converter.u64;
+
+            break;
+
+        case CATBUS_TYPE_INT64:
+            if( converter.i64 > INT32_MAX ){
+
+                converter.i64 = INT32_MAX;
+            }
+            else if( converter.i64 < INT32_MIN ){
+
+                converter.i64 = INT32_MIN;
+            }
+
+            *data = converter.i64;
+
+            break;
+
+        default:
+            return -1;
+            break;
+    }
+
+    return 0;
+}
+
+#ifdef ENABLE_CATBUS_LINK
+catbus_link_t catbus_l_send( catbus_hash_t32 source_hash, catbus_hash_t32 dest_hash, catbus_query_t *dest_query ){
+
+    if( !link_enable ){
+
+        return -1;
+    }
+
+    return _catbus_l_create_link( TRUE, source_hash, dest_hash, dest_query );
+}
+
+catbus_link_t catbus_l_recv( catbus_hash_t32 dest_hash, catbus_hash_t32 source_hash, catbus_query_t *source_query ){
+
+    if( !link_enable ){
+
+        return -1;
+    }
+
+    return _catbus_l_create_link( FALSE, source_hash, dest_hash, source_query );
+}
+
+// destroy all links created on this node
+void catbus_v_purge_links( void ){
+
+    if( !link_enable ){
+
+        return;
+    }
+
+    list_node_t link = links.head;
+
+    while( link > 0 ){
+
+        catbus_link_state_t *state = list_vp_get_data( link );
+
+        state->flags |= CATBUS_LINK_FLAGS_DELETE;
+
+        link = list_ln_next( link );
+    }
+}
+
+
+static bool _catbus_b_receive_entry_match( list_node_t ln, sock_addr_t *raddr, catbus_hash_t32 dest_hash ){
+
+    catbus_receive_data_entry_t *entry = (catbus_receive_data_entry_t *)list_vp_get_data( ln );
+
+    return ip_b_addr_compare( entry->raddr.ipaddr, raddr->ipaddr ) &&
+           ( entry->raddr.port == raddr->port ) &&
+           ( entry->dest_hash == dest_hash );
+}
+
+static list_node_t _catbus_ln_find_receive_entry( sock_addr_t *raddr, catbus_hash_t32 dest_hash ){
+
+    uint8_t slot = _catbus_u8_receive_key_home( raddr, dest_hash );
+
+    for( uint8_t i = 0; i < CATBUS_RX_CACHE_INDEX_SLOTS; i++ ){
+
+        list_node_t ln = receive_index[slot];
+
+        if( ln < 0 ){
+
+            break;
+        }
+
+        if( _catbus_b_receive_entry_match( ln, raddr, dest_hash ) ){
+
+            return ln;
+        }
+
+        slot = ( slot + 1 ) & ( CATBUS_RX_CACHE_INDEX_SLOTS - 1 );
+    }
+
+    if( receive_index_overflow == 0 ){
+
+        return -1;
+    }
+
+    list_node_t ln = receive_cache.head;
+
+    while( ln > 0 ){
+
+        if( _catbus_b_receive_entry_match( ln, raddr, dest_hash ) ){
+
+            return ln;
+        }
+
+        ln = list_ln_next( ln );
+    }
+
+    return -1;
+}
+
+// apply one received link data record
+static void _catbus_v_receive_link_data( 
+    sock_addr_t *raddr, 
+    catbus_hash_t32 dest_hash, 
+    uint16_t sequence, 
+    int32_t data ){
+
+    int32_t cached_sequence = -1;
+
+    // look for cache entry
+    list_node_t ln = _catbus_ln_find_receive_entry( raddr, dest_hash );
+
+    if( ln > 0 ){
+
+        catbus_receive_data_entry_t *entry = (catbus_receive_data_entry_t *)list_vp_get_data( ln );
+
+        cached_sequence = entry->sequence;
+
+        // update recorded data
+        entry->data = data;
+
+        // update recorded sequence
+        entry->sequence = sequence;
+
+        // reset ttl
+        entry->expire_tick = link_tick + CATBUS_LINK_TTL_TICKS;
+    }
+    // no entry exists
+    else{
+
+        // create entry
+        catbus_receive_data_entry_t entry;
+        entry.raddr         = *raddr;
+        entry.dest_hash     = dest_hash;
+        entry.data          = data;
+        entry.sequence      = sequence;
+        entry.ttl           = CATBUS_LINK_TTL;
+        entry.expire_tick   = link_tick + CATBUS_LINK_TTL_TICKS;
+
+        ln = list_ln_create_node2( &entry, sizeof(entry), MEM_TYPE_CATBUS_RX_CACHE );     
+        
+        if( ln > 0 ){           
+
+            list_v_insert_tail( &receive_cache, ln );
+
+            catbus_receive_data_entry_t *new_entry = (catbus_receive_data_entry_t *)list_vp_get_data( ln );
+            _catbus_v_wheel_insert( receive_wheel, ln, new_entry->expire_tick, &new_entry->wheel_next );
+
+            _catbus_v_index_insert( receive_index, CATBUS_RX_CACHE_INDEX_SLOTS, _catbus_u8_receive_key_home( raddr, dest_hash ), ln, &receive_index_overflow );
+        }
+    }
+
+    if( sequence != cached_sequence ){
+
+        catbus_i8_set( dest_hash, data );
+
+        if( kv_v_notify_hash_set != 0 ){
+
+            kv_v_notify_hash_set( dest_hash );                    
+        }
+    }
+}
+
+static bool _catbus_b_in_send_list( catbus_hash_t32 source_hash ){
+
+    uint8_t slot = _catbus_u8_send_key_home( source_hash );
+
+    for( uint8_t i = 0; i < CATBUS_SEND_INDEX_SLOTS; i++ ){
+
+        list_node_t ln = send_index[slot];
+
+        if( ln < 0 ){
+
+            break;
+        }
+
+        catbus_send_data_entry_t *entry = (catbus_send_data_entry_t *)list_vp_get_data( ln );
+
+        if( entry->source_hash == source_hash ){
+
+            return TRUE;
+        }
+
+        slot = ( slot + 1 ) & ( CATBUS_SEND_INDEX_SLOTS - 1 );
+    }
+
+    if( send_index_overflow == 0 ){
+
+        return FALSE;
+    }
+
+    list_node_t ln = send_list.head;
+
+    while( ln > 0 ){
+
+        catbus_send_data_entry_t *entry = (catbus_send_data_entry_t *)list_vp_get_data( ln );
+
+        if( entry->source_hash == source_hash ){
+
+            return TRUE;
+        }
+
+        ln = list_ln_next( ln );
+    }
+
+    return FALSE;
+}
+
+static bool _catbus_b_publish_sending( catbus_hash_t32 source_hash ){
+
+    if( publish_all_sending ){
+
+        return TRUE;
+    }
+
+    for( uint8_t i = 0; i < CATBUS_PUBLISH_SLOTS; i++ ){
+
+        if( ( publish_sending & ( (uint32_t)1 << i ) ) &&
+            ( publish_hashes[i] == source_hash ) ){
+
+            return TRUE;
+        }
+    }
+
+    return FALSE;
+}
+
+// returns TRUE if ln is the first entry in the send list for its
+// destination that has data in the current publish pass.
+static bool _catbus_b_first_for_dest( list_node_t ln ){
+
+    catbus_send_data_entry_t *entry = (catbus_send_data_entry_t *)list_vp_get_data( ln );
+    sock_addr_t raddr = entry->raddr;
+
+    list_node_t prev = send_list.head;
+
+    while( ( prev > 0 ) && ( prev != ln ) ){
+
+        catbus_send_data_entry_t *prev_entry = (catbus_send_data_entry_t *)list_vp_get_data( prev );
+
+        if( ip_b_addr_compare( prev_entry->raddr.ipaddr, raddr.ipaddr ) &&
+            ( prev_entry->raddr.port == raddr.port ) &&
+            ( _catbus_b_publish_sending( prev_entry->source_hash ) ) ){
+
+            return FALSE;
+        }
+
+        prev = list_ln_next( prev );
+    }
+
+    return TRUE;
+}
+
+// token bucket for publish pacing
+static bool _catbus_b_publish_token( void ){
+
+    uint32_t now = tmr_u32_get_system_time_ms();
+    uint32_t elapsed = tmr_u32_elapsed_times( publish_token_time, now );
+
+    // a second is enough to refill any sensible bucket
+    if( elapsed > 1000 ){
+
+        elapsed = 1000;
+    }
+
+    uint32_t new_tokens = ( elapsed * CATBUS_PUBLISH_RATE ) / 1000;
+
+    if( new_tokens > 0 ){
+
+        if( ( publish_tokens + new_tokens ) >= CATBUS_PUBLISH_BURST ){
+
+            publish_tokens = CATBUS_PUBLISH_BURST;
+            publish_token_time = now;
+        }
+        else{
+
+            publish_tokens += new_tokens;
+            // keep the fractional remainder
+            publish_token_time += ( new_tokens * 1000 ) / CATBUS_PUBLISH_RATE;
+        }
+    }
+
+    if( publish_tokens == 0 ){
+
+        return FALSE;
+    }
+
+    publish_tokens--;
+
+    return TRUE;
+}
+
+// returns TRUE if ln goes to the same destination as leader_ln and
+// has data in the current publish pass.
+static bool _catbus_b_in_group( list_node_t leader_ln, list_node_t ln ){
+
+    catbus_send_data_entry_t *leader = (catbus_send_data_entry_t *)list_vp_get_data( leader_ln );
+    catbus_send_data_entry_t *entry = (catbus_send_data_entry_t *)list_vp_get_data( ln );
+
+    return ip_b_addr_compare( entry->raddr.ipaddr, leader->raddr.ipaddr ) &&
+           ( entry->raddr.port == leader->raddr.port ) &&
+           _catbus_b_publish_sending( entry->source_hash );
+}
+
+// first entry at or after ln in leader_ln's group, -1 if none
+static list_node_t _catbus_ln_next_in_group( list_node_t leader_ln, list_node_t ln ){
+
+    while( ln > 0 ){
+
+        if( _catbus_b_in_group( leader_ln, ln ) ){
+
+            break;
+        }
+
+        ln = list_ln_next( ln );
+    }
+
+    return ln;
+}
+
+static uint8_t _catbus_u8_link_data_flags( ntp_ts_t *ntp_timestamp ){
+
+    uint8_t flags = 0;
+
+    #ifdef LIB_SNTP
+    *ntp_timestamp = sntp_t_now();
+
+    if( sntp_u8_get_status() == SNTP_STATUS_SYNCHRONIZED ){
+        
+        flags |= CATBUS_MSG_DATA_FLAG_TIME_SYNC;
+    }
+    #else
+    memset( ntp_timestamp, 0, sizeof(ntp_ts_t) );
+    #endif
+
+    return flags;
+}
+
+// send one record as a LINK_DATA message, returns the next node
+static list_node_t _catbus_ln_send_single( list_node_t ln ){
+
+    catbus_send_data_entry_t *send_state = (catbus_send_data_entry_t *)list_vp_get_data( ln );
+
+    catbus_msg_link_data_t msg;
+
+    _catbus_v_msg_init( &msg.header, CATBUS_MSG_TYPE_LINK_DATA, 0 );
+    msg.flags = _catbus_u8_link_data_flags( &msg.ntp_timestamp );
+
+    _catbus_v_get_query( &msg.source_query );
+
+    msg.source_hash = send_state->source_hash;
+    msg.dest_hash = send_state->dest_hash;
+    msg.sequence = sequence;
+
+    sock_addr_t raddr = send_state->raddr;
+    
+    if( catbus_i8_get( msg.source_hash, &msg.data ) < 0 ){
+
+        return list_ln_next( ln );
+    }
+
+    // we're not checking for success, since there is nothing we
+    // can do about it.
+    sock_i16_sendto( sock, (uint8_t *)&msg, sizeof(msg), &raddr );
+
+    publish_sent++;
+
+    return list_ln_next( ln );
+}
+
+// pack up to CATBUS_MAX_LINK_DATA_RECORDS records from leader_ln's group,
+// starting at ln, into one LINK_DATA_BATCH message.
+// returns the node after the last record packed.
+static list_node_t _catbus_ln_send_batch( list_node_t leader_ln, list_node_t ln ){
+
+    // count records
+    uint8_t count = 0;
+    list_node_t end_ln = ln;
+
+    while( ( end_ln > 0 ) && ( count < CATBUS_MAX_LINK_DATA_RECORDS ) ){
+
+        if( _catbus_b_in_group( leader_ln, end_ln ) ){
+
+            count++;
+        }
 
-        return status;
+        end_ln = list_ln_next( end_ln );
     }
 
-    union type_converter converter;
-    memset( &converter, 0, sizeof(converter) );
-
-    status = kv_i8_get_by_hash( hash, &converter, sizeof(converter) );
+    mem_handle_t h = mem2_h_alloc( sizeof(catbus_msg_link_data_batch_t) + 
+                                   ( ( count - 1 ) * sizeof(catbus_link_data_record_t) ) );
 
-    if( status < 0 ){
+    if( h < 0 ){
 
-        return status;
+        // fall back to a single record, which does not need the heap
+        return _catbus_ln_send_single( ln );
     }
 
-    // coerce value to i32
-    switch( meta.type ){
-        case CATBUS_TYPE_BOOL:
-            *data = converter.b;
-            break;
+    catbus_msg_link_data_batch_t *msg = mem2_vp_get_ptr( h );
 
-        case CATBUS_TYPE_UINT8:
-            *data = converter.u8;
-            break;
+    _catbus_v_msg_init( &msg->header, CATBUS_MSG_TYPE_LINK_DATA_BATCH, 0 );
+    msg->flags = _catbus_u8_link_data_flags( &msg->ntp_timestamp );
 
-        case CATBUS_TYPE_UINT16:
-            *data = converter.u16;
-            break;
+    _catbus_v_get_query( &msg->source_query );
 
-        case CATBUS_TYPE_INT8:
-            *data = converter.i8;
-            break;
+    uint8_t filled = 0;
+    sock_addr_t raddr;
 
-        case CATBUS_TYPE_INT16:
-            *data = converter.i16;
-            break;
+    for( ; ln != end_ln; ln = list_ln_next( ln ) ){
 
-        case CATBUS_TYPE_INT32:
-            *data = converter.i32;
-            break;
-            
-        case CATBUS_TYPE_UINT32:
-            if( converter.u32 > INT32_MAX ){
+        if( !_catbus_b_in_group( leader_ln, ln ) ){
 
-                converter.u32 = INT32_MAX;
-            }
+            continue;
+        }
 
-            *data = converter.u32;
+        catbus_send_data_entry_t *send_state = (catbus_send_data_entry_t *)list_vp_get_data( ln );
+        raddr = send_state->raddr;
+        catbus_hash_t32 source_hash = send_state->source_hash;
+        catbus_hash_t32 dest_hash = send_state->dest_hash;
 
-            break;
+        int32_t data;
 
-        case CATBUS_TYPE_UINT64:
-            if( converter.u64 > INT32_MAX ){
+        if( catbus_i8_get( source_hash, &data ) < 0 ){
 
-                converter.u64 = INT32_MAX;
-            }
+            continue;
+        }
 
-            *data = converter.u64;
+        // re-fetch, the get may have moved memory
+        msg = mem2_vp_get_ptr( h );
+        catbus_link_data_record_t *record = &msg->first_record + filled;
 
-            break;
+        record->source_hash = source_hash;
+        record->dest_hash   = dest_hash;
+        record->sequence    = sequence;
+        record->data        = data;
 
-        case CATBUS_TYPE_INT64:
-            if( converter.i64 > INT32_MAX ){
+        filled++;
+    }
 
-                converter.i64 = INT32_MAX;
-            }
-            else if( converter.i64 < INT32_MIN ){
+    if( filled == 0 ){
 
-                converter.i64 = INT32_MIN;
-            }
+        mem2_v_free( h );
 
-            *data = converter.i64;
+        return end_ln;
+    }
 
-            break;
+    msg = mem2_vp_get_ptr( h );
+    msg->count = filled;
 
-        default:
-            return -1;
-            break;
+    if( filled < count ){
+
+        mem2_i8_realloc( h, sizeof(catbus_msg_link_data_batch_t) + 
+                            ( ( filled - 1 ) * sizeof(catbus_link_data_record_t) ) );
     }
 
-    return 0;
+    sock_i16_sendto_m( sock, h, &raddr );
+
+    publish_sent += filled;
+
+    return end_ln;
 }
 
-#ifdef ENABLE_CATBUS_LINK
-catbus_link_t catbus_l_send( catbus_hash_t32 source_hash, catbus_hash_t32 dest_hash, catbus_query_t *dest_query ){
+// publish engine.
+// each pass snapshots the pending hashes and walks the send list grouped
+// by destination, reading the current value of each source at send time.
+// hashes published again while a pass is running are picked up by the
+// next pass.
+PT_THREAD( catbus_publish_thread( pt_t *pt, void *state ) )
+{
+PT_BEGIN( pt );
 
-    if( !link_enable ){
+    static list_node_t ln;
+    static list_node_t group_ln;
+    static uint32_t pass_start;
 
-        return -1;
-    }
+    publish_tokens = CATBUS_PUBLISH_BURST;
+    publish_token_time = tmr_u32_get_system_time_ms();
 
-    return _catbus_l_create_link( TRUE, source_hash, dest_hash, dest_query );
-}
+    while(1){
 
-catbus_link_t catbus_l_recv( catbus_hash_t32 dest_hash, catbus_hash_t32 source_hash, catbus_query_t *source_query ){
+        THREAD_WAIT_WHILE( pt, ( publish_pending == 0 ) && !publish_all_pending );
 
-    if( !link_enable ){
+        // see the announce thread for why we wait for received data
+        THREAD_WAIT_WHILE( pt, sock_i16_get_bytes_read( sock ) > 0 );
 
-        return -1;
-    }
+        publish_sending = publish_pending;
+        publish_pending = 0;
+        publish_all_sending = publish_all_pending;
+        publish_all_pending = FALSE;
+        pass_start = publish_pending_since;
 
-    return _catbus_l_create_link( FALSE, source_hash, dest_hash, source_query );
-}
+        // one sequence per pass: receivers only need it to change
+        // between updates to the same destination key.
+        sequence++;
 
-// destroy all links created on this node
-void catbus_v_purge_links( void ){
+        send_list_locked++;
 
-    if( !link_enable ){
+        ln = send_list.head;
 
-        return;
-    }
+        while( ln > 0 ){
 
-    list_node_t link = links.head;
+            catbus_send_data_entry_t *entry = (catbus_send_data_entry_t *)list_vp_get_data( ln );
 
-    while( link > 0 ){
+            if( !_catbus_b_publish_sending( entry->source_hash ) ||
+                !_catbus_b_first_for_dest( ln ) ){
 
-        catbus_link_state_t *state = list_vp_get_data( link );
+                goto next;
+            }
 
-        state->flags |= CATBUS_LINK_FLAGS_DELETE;
+            // send everything for this destination
+            group_ln = ln;
 
-        link = list_ln_next( link );
-    }
-}
+            while( ( group_ln = _catbus_ln_next_in_group( ln, group_ln ) ) > 0 ){
 
+                while( !_catbus_b_publish_token() ){
 
-typedef struct{
-    catbus_msg_link_data_t msg;
-    list_node_t ln;
-} publish_thread_state_t;
+                    TMR_WAIT( pt, ( 1000 / CATBUS_PUBLISH_RATE ) + 1 );
+                }
 
-PT_THREAD( publish_thread( pt_t *pt, publish_thread_state_t *state ) )
-{
-PT_BEGIN( pt );
+                THREAD_WAIT_WHILE( pt, sock_i16_get_bytes_read( sock ) > 0 );
 
-    send_list_locked++;
-        
-    state->ln = send_list.head;
+                if( !link_enable ){
 
-    while( state->ln > 0 ){
+                    goto pass_done;
+                }
 
-        catbus_send_data_entry_t *send_state = (catbus_send_data_entry_t *)list_vp_get_data( state->ln );
+                catbus_send_data_entry_t *leader = (catbus_send_data_entry_t *)list_vp_get_data( ln );
 
-        if( send_state->source_hash != state->msg.source_hash ){
+                if( leader->flags & CATBUS_SEND_FLAGS_BATCH ){
 
-            goto end;
+                    group_ln = _catbus_ln_send_batch( ln, group_ln );
+                }
+                else{
+
+                    group_ln = _catbus_ln_send_single( group_ln );
+                }
+            }
+
+next:
+            ln = list_ln_next( ln );
         }
 
-        state->msg.dest_hash = send_state->dest_hash;
+pass_done:
+        send_list_locked--;
+        publish_sending = 0;
+        publish_all_sending = FALSE;
 
-        sock_i16_sendto( sock, (uint8_t *)&state->msg, sizeof(state->msg), &send_state->raddr );
+        uint32_t latency = tmr_u32_elapsed_time_ms( pass_start );
 
-        TMR_WAIT( pt, 2 );
+        if( latency > UINT16_MAX ){
 
-end:
-        state->ln = list_ln_next( state->ln );
-    }
+            latency = UINT16_MAX;
+        }
+
+        publish_latency = latency;
 
-    send_list_locked--;
+        if( publish_latency > publish_max_latency ){
+
+            publish_max_latency = publish_latency;
+        }
+    }
     
 PT_END( pt );
 }
+
+// queue a full pass over the send list
+static void _catbus_v_publish_all( void ){
+
+    if( ( publish_pending == 0 ) && !publish_all_pending ){
+
+        publish_pending_since = tmr_u32_get_system_time_ms();
+    }
+
+    publish_all_pending = TRUE;
+}
 #endif
 
+// queue a hash for publishing to its links.
+// the send itself happens in the publish thread, so repeated publishes
+// of the same hash before it goes out are coalesced into one.
 int8_t catbus_i8_publish( catbus_hash_t32 hash ){
 
     #ifdef ENABLE_CATBUS_LINK
@@ -959,38 +1837,68 @@ int8_t catbus_i8_publish( catbus_hash_t32 hash ){
         kv_v_notify_hash_set( hash );
     }
 
-    publish_thread_state_t state;
+    if( !_catbus_b_in_send_list( hash ) ){
 
-    _catbus_v_msg_init( &state.msg.header, CATBUS_MSG_TYPE_LINK_DATA, 0 );
-    state.msg.flags = 0;
+        return 0;
+    }
 
-    #ifdef LIB_SNTP
-    state.msg.ntp_timestamp = sntp_t_now();
+    int8_t free_slot = -1;
 
-    if( sntp_u8_get_status() == SNTP_STATUS_SYNCHRONIZED ){
-        
-        state.msg.flags |= CATBUS_MSG_DATA_FLAG_TIME_SYNC;
+    for( uint8_t i = 0; i < CATBUS_PUBLISH_SLOTS; i++ ){
+
+        uint32_t bit = (uint32_t)1 << i;
+
+        if( ( ( publish_pending | publish_sending ) & bit ) == 0 ){
+
+            if( free_slot < 0 ){
+
+                free_slot = i;
+            }
+
+            continue;
+        }
+
+        if( publish_hashes[i] != hash ){
+
+            continue;
+        }
+
+        if( publish_pending & bit ){
+
+            publish_coalesced++;
+        }
+        else{
+
+            // in flight, send again on the next pass
+            if( publish_pending == 0 ){
+
+                publish_pending_since = tmr_u32_get_system_time_ms();
+            }
+
+            publish_pending |= bit;
+        }
+
+        return 0;
     }
-    #endif
 
-    _catbus_v_get_query( &state.msg.source_query );
+    if( free_slot < 0 ){
 
-    state.msg.source_hash = hash;
-    
-    if( catbus_i8_get( hash, &state.msg.data ) < 0 ){
+        // out of slots, fall back to sending everything on the next pass
+        // so this hash is not lost.
+        publish_overflows++;
 
-        return -1;
+        _catbus_v_publish_all();
+
+        return 0;
     }
 
-    sequence++;
-    state.msg.sequence = sequence;
+    if( publish_pending == 0 ){
 
-    // we're not checking for success, since there is nothing we
-    // can do about it.
-    thread_t_create( THREAD_CAST(publish_thread),
-                     PSTR("catbus_publish"),
-                     &state,
-                     sizeof(state) );
+        publish_pending_since = tmr_u32_get_system_time_ms();
+    }
+
+    publish_hashes[free_slot] = hash;
+    publish_pending |= (uint32_t)1 << free_slot;
     
     #endif
 
@@ -1143,6 +2051,9 @@ PT_BEGIN( pt );
 
     sock_v_set_timeout( sock, 1 );
 
+    // not fatal if this fails, we just drop more under load
+    sock_i8_set_rx_depth( sock, CATBUS_RX_QUEUE_DEPTH );
+
     // set up tag hashes
     _catbus_v_setup_tag_hashes();
 
@@ -1174,7 +2085,35 @@ PT_BEGIN( pt );
         // DISCOVERY MESSAGES
         if( header->msg_type == CATBUS_MSG_TYPE_ANNOUNCE ){
 
-            // no op
+            #ifdef ENABLE_CATBUS_LINK
+            catbus_msg_announce_t *msg = (catbus_msg_announce_t *)header;
+
+            sock_addr_t raddr;
+            sock_v_get_raddr( sock, &raddr );
+
+            // record whether this node accepts batched link data
+            list_node_t ln = send_list.head;
+
+            while( ln > 0 ){
+
+                catbus_send_data_entry_t *entry = (catbus_send_data_entry_t *)list_vp_get_data( ln );
+
+                if( ip_b_addr_compare( entry->raddr.ipaddr, raddr.ipaddr ) &&
+                    ( entry->raddr.port == msg->data_port ) ){
+
+                    if( msg->flags & CATBUS_ANNOUNCE_FLAG_LINK_BATCH ){
+
+                        entry->flags |= CATBUS_SEND_FLAGS_BATCH;
+                    }
+                    else{
+
+                        entry->flags &= ~CATBUS_SEND_FLAGS_BATCH;
+                    }
+                }
+
+                ln = list_ln_next( ln );
+            }
+            #endif
         }
         else if( header->msg_type == CATBUS_MSG_TYPE_DISCOVER ){
 
@@ -1551,63 +2490,38 @@ PT_BEGIN( pt );
             sock_addr_t raddr;
             sock_v_get_raddr( sock, &raddr );
 
-            int32_t cached_sequence = -1;
-
-            // look for cache entry
-            list_node_t ln = receive_cache.head;
-
-            while( ln > 0 ){
-
-                catbus_receive_data_entry_t *entry = (catbus_receive_data_entry_t *)list_vp_get_data( ln );
-
-                if( ip_b_addr_compare( entry->raddr.ipaddr, raddr.ipaddr ) &&
-                    ( entry->raddr.port == raddr.port ) &&
-                    ( entry->dest_hash == msg->dest_hash ) ){
-
-                    cached_sequence = entry->sequence;
-
-                    // update recorded data
-                    entry->data = msg->data;
-
-                    // update recorded sequence
-                    entry->sequence = msg->sequence;
-
-                    // reset ttl
-                    entry->ttl = 32;
+            _catbus_v_receive_link_data( &raddr, msg->dest_hash, msg->sequence, msg->data );
+        }
+        else if( header->msg_type == CATBUS_MSG_TYPE_LINK_DATA_BATCH ){
 
-                    break;
-                }
+            if( !link_enable ){
 
-                ln = list_ln_next( ln );
+                goto end;
             }
 
-            // no entry exists
-            if( ln < 0 ){
+            catbus_msg_link_data_batch_t *msg = (catbus_msg_link_data_batch_t *)header;
 
-                // create entry
-                catbus_receive_data_entry_t entry;
-                entry.raddr         = raddr;
-                entry.dest_hash     = msg->dest_hash;
-                entry.data          = msg->data;
-                entry.sequence      = msg->sequence;
-                entry.ttl           = 32;
+            if( ( msg->count == 0 ) || 
+                ( msg->count > CATBUS_MAX_LINK_DATA_RECORDS ) ||
+                ( sock_i16_get_bytes_read( sock ) < 
+                  (int16_t)( sizeof(catbus_msg_link_data_batch_t) + ( ( msg->count - 1 ) * sizeof(catbus_link_data_record_t) ) ) ) ){
 
-                ln = list_ln_create_node2( &entry, sizeof(entry), MEM_TYPE_CATBUS_RX_CACHE );     
-                
-                if( ln > 0 ){           
-
-                    list_v_insert_tail( &receive_cache, ln );
-                }
+                error = CATBUS_ERROR_PROTOCOL_ERROR;
+                goto end;
             }
 
-            if( msg->sequence != cached_sequence ){
+            sock_addr_t raddr;
+            sock_v_get_raddr( sock, &raddr );
 
-                catbus_i8_set( msg->dest_hash, msg->data );
+            catbus_link_data_record_t *record = &msg->first_record;
 
-                if( kv_v_notify_hash_set != 0 ){
+            for( uint8_t i = 0; i < msg->count; i++ ){
 
-                    kv_v_notify_hash_set( msg->dest_hash );                    
-                }
+                _catbus_v_receive_link_data( &raddr, record->dest_hash, record->sequence, record->data );
+
+                // re-fetch, the set may have moved memory
+                msg = (catbus_msg_link_data_batch_t *)sock_vp_get_data( sock );
+                record = &msg->first_record + i + 1;
             }
         }
         #endif
@@ -2012,41 +2926,10 @@ PT_BEGIN( pt );
 
         // process link system periodic tasks        
 
-        catbus_hash_t32 hashes_published[16];
-        uint8_t hashes_published_index = 0;
-        memset( hashes_published, 0, sizeof(hashes_published) );
-        
-        ln = send_list.head;
-        next_ln = -1;
-
-        while( ln > 0 ){
-
-            next_ln = list_ln_next( ln );
-
-            catbus_send_data_entry_t *state = (catbus_send_data_entry_t *)list_vp_get_data( ln );
-            
-            // check if we've already published this one
-            for( uint8_t i = 0; i < hashes_published_index; i++ ){
-
-                if( hashes_published[i] == state->source_hash ){
-
-                    goto next_send;
-                }
-            }
-
-            if( hashes_published_index < cnt_of_array(hashes_published) ){
-
-                hashes_published[hashes_published_index] = state->source_hash;
-                hashes_published_index++;
-            }
-
-            catbus_i8_publish( state->source_hash );
-
-            TMR_WAIT( pt, 2 );
-             
-next_send:
-            ln = next_ln;
-        }  
+        // refresh all send entries.
+        // this is a single full pass in the publish engine, so it
+        // does not depend on the number of publish slots.
+        _catbus_v_publish_all();
 
         // check for deleted links
         ln = links.head;
@@ -2082,47 +2965,11 @@ next_send:
 
         THREAD_WAIT_WHILE( pt, send_list_locked );
 
-        // expire any send entries
-        ln = send_list.head;
-        next_ln = -1;
-
-        while( ln > 0 ){
-
-            next_ln = list_ln_next( ln );
-
-            catbus_send_data_entry_t *entry = (catbus_send_data_entry_t *)list_vp_get_data( ln );
-
-            entry->ttl -= 4;
-
-            if( entry->ttl < 0 ){
+        // advance the expiry wheel
+        link_tick++;
 
-                list_v_remove( &send_list, ln );
-                list_v_release_node( ln );
-            } 
-
-            ln = next_ln;
-        }  
-
-        // expire any cache entries
-        ln = receive_cache.head;
-        next_ln = -1;
-
-        while( ln > 0 ){
-
-            next_ln = list_ln_next( ln );
-
-            catbus_receive_data_entry_t *entry = (catbus_receive_data_entry_t *)list_vp_get_data( ln );
-
-            entry->ttl -= 4;
-
-            if( entry->ttl < 0 ){
-
-                list_v_remove( &receive_cache, ln );
-                list_v_release_node( ln );
-            } 
-
-            ln = next_ln;
-        }  
+        _catbus_v_expire_send_list();
+        _catbus_v_expire_receive_cache();
         #endif
     }
 
@@ -34,6 +34,39 @@
 #define CATBUS_VERSION                      1
 #define CATBUS_MEOW                         0x574f454d // 'MEOW'
 
+// datagrams the catbus server socket can hold while it is busy
+#ifndef CATBUS_RX_QUEUE_DEPTH
+    #define CATBUS_RX_QUEUE_DEPTH           3
+#endif
+
+// number of distinct source hashes that can be waiting to publish.
+// repeated publishes of a pending hash coalesce into one send.
+// if the slots run out, the next pass sends every link instead.
+#ifndef CATBUS_PUBLISH_SLOTS
+    #define CATBUS_PUBLISH_SLOTS            16
+#endif
+
+// hash index sizes for the link send list and receive cache.
+// must be powers of 2.  entries that do not fit are still found
+// by walking the list.
+#ifndef CATBUS_SEND_INDEX_SLOTS
+    #define CATBUS_SEND_INDEX_SLOTS         32
+#endif
+
+#ifndef CATBUS_RX_CACHE_INDEX_SLOTS
+    #define CATBUS_RX_CACHE_INDEX_SLOTS     32
+#endif
+
+// publish pacing: sustained link data messages per second and the
+// number that may go out back to back.
+#ifndef CATBUS_PUBLISH_RATE
+    #define CATBUS_PUBLISH_RATE             200
+#endif
+
+#ifndef CATBUS_PUBLISH_BURST
+    #define CATBUS_PUBLISH_BURST            8
+#endif
+
 
 typedef struct __attribute__((packed)){
     catbus_meta_t meta;
@@ -87,6 +120,9 @@ typedef struct __attribute__((packed)){
 // DISCOVERY
 #define CATBUS_DISC_FLAG_QUERY_ALL              0x01
 
+// announce flags: capabilities of the announcing node
+#define CATBUS_ANNOUNCE_FLAG_LINK_BATCH         0x01
+
 typedef struct __attribute__((packed)){
     catbus_header_t header;
     uint8_t flags;
@@ -184,6 +220,28 @@ typedef struct __attribute__((packed)){
 } catbus_msg_link_data_t;
 #define CATBUS_MSG_TYPE_LINK_DATA               ( 2 + CATBUS_MSG_LINK_GROUP_OFFSET )
 
+// maximum records in one batched link data message.
+// 16 records is 290 bytes on the wire.
+#define CATBUS_MAX_LINK_DATA_RECORDS            16
+
+typedef struct __attribute__((packed)){
+    catbus_hash_t32 source_hash;
+    catbus_hash_t32 dest_hash;
+    uint16_t sequence;
+    int32_t data;
+} catbus_link_data_record_t;
+
+// only sent to nodes announcing CATBUS_ANNOUNCE_FLAG_LINK_BATCH
+typedef struct __attribute__((packed)){
+    catbus_header_t header;
+    uint8_t flags;
+    ntp_ts_t ntp_timestamp;
+    catbus_query_t source_query;
+    uint8_t count;
+    catbus_link_data_record_t first_record; // additional records may follow
+} catbus_msg_link_data_batch_t;
+#define CATBUS_MSG_TYPE_LINK_DATA_BATCH         ( 3 + CATBUS_MSG_LINK_GROUP_OFFSET )
+
 
 // FILE
 typedef struct __attribute__((packed)){
@@ -40,12 +40,17 @@ typedef struct{
 	block_t next_block;
 } block_info_t;
 
+// cached block index, along with a decoded map of
+// logical page -> current physical page for the block
 typedef struct{
     block_t block;
+    uint16_t last_used;
     ffs_block_index_t index;
+    uint8_t page_map[FFS_DATA_PAGES_PER_BLOCK];
 } index_cache_t;
 
-static index_cache_t index_cache;
+static index_cache_t index_cache[FFS_BLOCK_MAP_CACHE_SIZE];
+static uint16_t index_cache_clock;
 
 static mem_handle_t blocks_h;
 uint8_t _total_blocks;
@@ -58,11 +63,15 @@ static block_t dirty_list;
 static uint8_t flash_fs_soft_io_errors;
 static uint8_t flash_fs_hard_io_errors;
 static uint32_t flash_fs_block_allocs;
+static uint32_t flash_fs_block_map_hits;
+static uint32_t flash_fs_block_map_misses;
 
 KV_SECTION_META kv_meta_t ffs_block_info_kv[] = {
     { SAPPHIRE_TYPE_UINT8,   0, KV_FLAGS_READ_ONLY,  &flash_fs_soft_io_errors,        0,  "flash_fs_soft_io_errors" },
     { SAPPHIRE_TYPE_UINT32,  0, KV_FLAGS_READ_ONLY,  &flash_fs_block_allocs,          0,  "flash_fs_block_allocs" },
     { SAPPHIRE_TYPE_UINT8,   0, KV_FLAGS_READ_ONLY,  &flash_fs_hard_io_errors,        0,  "flash_fs_hard_io_errors" },
+    { SAPPHIRE_TYPE_UINT32,  0, KV_FLAGS_READ_ONLY,  &flash_fs_block_map_hits,        0,  "flash_fs_block_map_hits" },
+    { SAPPHIRE_TYPE_UINT32,  0, KV_FLAGS_READ_ONLY,  &flash_fs_block_map_misses,      0,  "flash_fs_block_map_misses" },
 };
 
 static inline block_info_t *get_block_ptr( void ) __attribute__((always_inline));
@@ -72,10 +81,71 @@ static inline block_info_t *get_block_ptr( void ){
     return (block_info_t *)mem2_vp_get_ptr( blocks_h );
 }
 
+static void invalidate_index_cache( void ){
+
+    for( uint8_t i = 0; i < FFS_BLOCK_MAP_CACHE_SIZE; i++ ){
+
+        index_cache[i].block = FFS_BLOCK_INVALID;
+    }
+}
+
+static index_cache_t *get_index_cache( block_t block ){
+
+    for( uint8_t i = 0; i < FFS_BLOCK_MAP_CACHE_SIZE; i++ ){
+
+        if( index_cache[i].block == block ){
+
+            return &index_cache[i];
+        }
+    }
+
+    return 0;
+}
+
+static index_cache_t *get_index_cache_victim( void ){
+
+    index_cache_t *victim = &index_cache[0];
+
+    for( uint8_t i = 0; i < FFS_BLOCK_MAP_CACHE_SIZE; i++ ){
+
+        // prefer an empty entry
+        if( index_cache[i].block == FFS_BLOCK_INVALID ){
+
+            return &index_cache[i];
+        }
+
+        // otherwise, least recently used
+        if( (uint16_t)( index_cache_clock - index_cache[i].last_used ) >
+            (uint16_t)( index_cache_clock - victim->last_used ) ){
+
+            victim = &index_cache[i];
+        }
+    }
+
+    return victim;
+}
+
+static void build_page_map( index_cache_t *entry ){
+
+    memset( entry->page_map, 0xff, sizeof(entry->page_map) );
+
+    // scan forwards, so the newest (highest) physical
+    // page for each logical page wins.
+    for( uint8_t i = 0; i < FFS_PAGES_PER_BLOCK; i++ ){
+
+        uint8_t logical_index = entry->index.page_index[i];
+
+        if( logical_index < FFS_DATA_PAGES_PER_BLOCK ){
+
+            entry->page_map[logical_index] = i;
+        }
+    }
+}
+
 
 void ffs_block_v_init( void ){
 
-    index_cache.block = FFS_BLOCK_INVALID;
+    invalidate_index_cache();
     blocks_h = FFS_BLOCK_INVALID;
     _total_blocks = 0;
 
@@ -508,9 +578,11 @@ bool ffs_block_b_is_dirty( const ffs_block_meta_t *meta ){
 int8_t ffs_block_i8_erase( block_t block ){
 
     // check if we have the index for this block loaded
-    if( index_cache.block == block ){
+    index_cache_t *entry = get_index_cache( block );
 
-        index_cache.block = FFS_BLOCK_INVALID;
+    if( entry != 0 ){
+
+        entry->block = FFS_BLOCK_INVALID;
     }
 
     // enable writes
@@ -596,20 +668,32 @@ int8_t ffs_block_i8_write_meta( block_t block, const ffs_block_meta_t *meta ){
 }
 
 
-int8_t ffs_block_i8_read_index( block_t block, ffs_block_index_t **index ){
+static index_cache_t *load_index( block_t block ){
 
     uint16_t crc0, crc1;
 
     ASSERT( block < (block_t)_total_blocks );
 
     // check cache
-    if( block == index_cache.block ){
+    index_cache_t *entry = get_index_cache( block );
 
-        *index = &index_cache.index;
+    if( entry != 0 ){
 
-        return FFS_STATUS_OK;
+        flash_fs_block_map_hits++;
+
+        entry->last_used = ++index_cache_clock;
+
+        return entry;
     }
 
+    flash_fs_block_map_misses++;
+
+    entry = get_index_cache_victim();
+
+    // entry is overwritten by the reads below, so it
+    // must not match any block until the read succeeds.
+    entry->block = FFS_BLOCK_INVALID;
+
     uint8_t tries = FFS_IO_ATTEMPTS;
 
     while( tries > 0 ){
@@ -617,11 +701,11 @@ int8_t ffs_block_i8_read_index( block_t block, ffs_block_index_t **index ){
         tries--;
 
         // read both indexes
-        flash25_v_read( FFS_INDEX_0(block), &index_cache.index, sizeof(index_cache.index) );
-        crc0 = crc_u16_block( (uint8_t *)&index_cache.index, sizeof(index_cache.index) );
+        flash25_v_read( FFS_INDEX_0(block), &entry->index, sizeof(entry->index) );
+        crc0 = crc_u16_block( (uint8_t *)&entry->index, sizeof(entry->index) );
 
-        flash25_v_read( FFS_INDEX_1(block), &index_cache.index, sizeof(index_cache.index) );
-        crc1 = crc_u16_block( (uint8_t *)&index_cache.index, sizeof(index_cache.index) );
+        flash25_v_read( FFS_INDEX_1(block), &entry->index, sizeof(entry->index) );
+        crc1 = crc_u16_block( (uint8_t *)&entry->index, sizeof(entry->index) );
 
         // compare
         if( crc0 != crc1 ){
@@ -632,17 +716,55 @@ int8_t ffs_block_i8_read_index( block_t block, ffs_block_index_t **index ){
             continue;
         }
 
-        index_cache.block = block;
+        build_page_map( entry );
 
-        *index = &index_cache.index;
+        entry->block = block;
+        entry->last_used = ++index_cache_clock;
 
-        return FFS_STATUS_OK;
+        return entry;
     }
 
     // hard error, could not reliably read index
     ffs_block_v_hard_error();
 
-    return FFS_STATUS_ERROR;
+    return 0;
+}
+
+int8_t ffs_block_i8_read_index( block_t block, ffs_block_index_t **index ){
+
+    index_cache_t *entry = load_index( block );
+
+    if( entry == 0 ){
+
+        return FFS_STATUS_ERROR;
+    }
+
+    *index = &entry->index;
+
+    return FFS_STATUS_OK;
+}
+
+// returns physical page index holding the given logical page,
+// or FFS_STATUS_EOF if the logical page has not been written.
+int8_t ffs_block_i8_get_phy_page( block_t block, uint8_t logical_index ){
+
+    ASSERT( logical_index < FFS_DATA_PAGES_PER_BLOCK );
+
+    index_cache_t *entry = load_index( block );
+
+    if( entry == 0 ){
+
+        return FFS_STATUS_ERROR;
+    }
+
+    uint8_t phy_index = entry->page_map[logical_index];
+
+    if( phy_index == 0xff ){
+
+        return FFS_STATUS_EOF;
+    }
+
+    return phy_index;
 }
 
 int8_t ffs_block_i8_set_index_entry( block_t block, uint8_t logical_index, uint8_t phy_index ){
@@ -651,9 +773,18 @@ int8_t ffs_block_i8_set_index_entry( block_t block, uint8_t logical_index, uint8
     ASSERT( phy_index < FFS_PAGES_PER_BLOCK );
 
     // check if this index is cached
-    if( block == index_cache.block ){
+    index_cache_t *entry = get_index_cache( block );
+
+    if( entry != 0 ){
+
+        entry->index.page_index[phy_index] = logical_index;
+
+        // the highest physical page for a logical page is the current one
+        if( ( entry->page_map[logical_index] == 0xff ) ||
+            ( entry->page_map[logical_index] < phy_index ) ){
 
-        index_cache.index.page_index[phy_index] = logical_index;
+            entry->page_map[logical_index] = phy_index;
+        }
     }
 
     // write index entry
@@ -664,6 +795,12 @@ int8_t ffs_block_i8_set_index_entry( block_t block, uint8_t logical_index, uint8
     if( ( flash25_u8_read_byte( FFS_INDEX_0(block) + phy_index ) != logical_index ) ||
         ( flash25_u8_read_byte( FFS_INDEX_1(block) + phy_index ) != logical_index ) ){
 
+        // cached copy no longer matches flash
+        if( entry != 0 ){
+
+            entry->block = FFS_BLOCK_INVALID;
+        }
+
         return FFS_STATUS_ERROR;
     }
 
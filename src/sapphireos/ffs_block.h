@@ -101,6 +101,7 @@ int8_t ffs_block_i8_erase( block_t block );
 int8_t ffs_block_i8_read_meta( block_t block, ffs_block_meta_t *meta );
 int8_t ffs_block_i8_write_meta( block_t block, const ffs_block_meta_t *meta );
 int8_t ffs_block_i8_read_index( block_t block, ffs_block_index_t **index );
+int8_t ffs_block_i8_get_phy_page( block_t block, uint8_t logical_index );
 int8_t ffs_block_i8_set_index_entry( block_t block, uint8_t logical_index, uint8_t phy_index );
 int8_t ffs_block_i8_get_index_info( block_t block, ffs_index_info_t *info );
 
@@ -32,6 +32,16 @@
 
 #define FFS_IO_ATTEMPTS             3
 
+// number of pages held in the page cache (defined in target.h)
+#ifndef FFS_PAGE_CACHE_SIZE
+    #define FFS_PAGE_CACHE_SIZE     4
+#endif
+
+// number of block indexes/page maps held in RAM (defined in target.h)
+#ifndef FFS_BLOCK_MAP_CACHE_SIZE
+    #define FFS_BLOCK_MAP_CACHE_SIZE    4
+#endif
+
 #define FLASH_FS_MAX_FILES			( FLASH_FS_MAX_USER_FILES + 2 )
 #define FFS_MAX_FILES			    ( FLASH_FS_MAX_FILES - 3 )
 // the -3 accounts for the firmware partitions
@@ -44,6 +44,7 @@ typedef struct{
     uint16_t page_number;
     ffs_file_t file_id;
     int32_t page_addr;
+    uint16_t last_used;
 } page_cache_t;
 
 typedef struct{
@@ -53,18 +54,27 @@ typedef struct{
 
 static file_info_t files[FFS_MAX_FILES];
 
-static page_cache_t page_cache;
+// LRU page cache.
+// current_page is the page most recently read, which is the page returned
+// by ffs_page_p_get_cached_page().
+static page_cache_t page_cache[FFS_PAGE_CACHE_SIZE];
+static page_cache_t *current_page = &page_cache[0];
+static uint16_t cache_clock;
 
 static uint32_t flash_fs_block_copies;
 static uint32_t flash_fs_page_allocs;
 static uint32_t flash_fs_page_cache_hits;
 static uint32_t flash_fs_page_cache_misses;
+static uint32_t flash_fs_page_cache_evictions;
+static uint32_t flash_fs_page_cache_readaheads;
 
 KV_SECTION_META kv_meta_t ffs_page_info_kv[] = {
     { SAPPHIRE_TYPE_UINT32,  0, KV_FLAGS_READ_ONLY,  &flash_fs_block_copies,        0,  "flash_fs_block_copies" },
     { SAPPHIRE_TYPE_UINT32,  0, KV_FLAGS_READ_ONLY,  &flash_fs_page_allocs,         0,  "flash_fs_page_allocs" },
     { SAPPHIRE_TYPE_UINT32,  0, KV_FLAGS_READ_ONLY,  &flash_fs_page_cache_hits,     0,  "flash_fs_page_cache_hits" },
     { SAPPHIRE_TYPE_UINT32,  0, KV_FLAGS_READ_ONLY,  &flash_fs_page_cache_misses,   0,  "flash_fs_page_cache_misses" },
+    { SAPPHIRE_TYPE_UINT32,  0, KV_FLAGS_READ_ONLY,  &flash_fs_page_cache_evictions,    0,  "flash_fs_page_cache_evictions" },
+    { SAPPHIRE_TYPE_UINT32,  0, KV_FLAGS_READ_ONLY,  &flash_fs_page_cache_readaheads,   0,  "flash_fs_page_cache_readaheads" },
 };
 
 
@@ -92,10 +102,88 @@ static int32_t page_address( block_t block, uint8_t page_index ){
     return addr;
 }
 
+static void invalidate_entry( page_cache_t *entry ){
+
+    entry->file_id = -1;
+    entry->page.len = 0;
+}
+
 static void invalidate_cache( void ){
 
-    page_cache.file_id = -1;
-    page_cache.page.len = 0;
+    for( uint8_t i = 0; i < FFS_PAGE_CACHE_SIZE; i++ ){
+
+        invalidate_entry( &page_cache[i] );
+    }
+}
+
+static void invalidate_page( ffs_file_t file_id, uint16_t page ){
+
+    for( uint8_t i = 0; i < FFS_PAGE_CACHE_SIZE; i++ ){
+
+        if( ( page_cache[i].file_id == file_id ) && ( page_cache[i].page_number == page ) ){
+
+            invalidate_entry( &page_cache[i] );
+        }
+    }
+}
+
+static void invalidate_file( ffs_file_t file_id ){
+
+    for( uint8_t i = 0; i < FFS_PAGE_CACHE_SIZE; i++ ){
+
+        if( page_cache[i].file_id == file_id ){
+
+            invalidate_entry( &page_cache[i] );
+        }
+    }
+}
+
+static page_cache_t *cache_lookup( ffs_file_t file_id, uint16_t page ){
+
+    for( uint8_t i = 0; i < FFS_PAGE_CACHE_SIZE; i++ ){
+
+        if( ( page_cache[i].file_id == file_id ) && ( page_cache[i].page_number == page ) ){
+
+            return &page_cache[i];
+        }
+    }
+
+    return 0;
+}
+
+// get an entry to load a page in to, preferring empty entries, otherwise
+// the least recently used entry.  the keep entry will not be selected.
+static page_cache_t *cache_victim( page_cache_t *keep ){
+
+    page_cache_t *victim = 0;
+
+    for( uint8_t i = 0; i < FFS_PAGE_CACHE_SIZE; i++ ){
+
+        page_cache_t *entry = &page_cache[i];
+
+        if( entry == keep ){
+
+            continue;
+        }
+
+        if( entry->file_id < 0 ){
+
+            return entry;
+        }
+
+        if( ( victim == 0 ) ||
+            ( (uint16_t)( cache_clock - entry->last_used ) > (uint16_t)( cache_clock - victim->last_used ) ) ){
+
+            victim = entry;
+        }
+    }
+
+    if( victim != 0 ){
+
+        flash_fs_page_cache_evictions++;
+    }
+
+    return victim;
 }
 
 void ffs_page_v_reset( void ){
@@ -306,7 +394,7 @@ int8_t ffs_page_i8_file_scan( ffs_file_t file_id ){
         // check length (except on last page)
         if( i < ( pages - 1 ) ){
 
-            if( page_cache.page.len != FFS_PAGE_DATA_SIZE ){
+            if( current_page->page.len != FFS_PAGE_DATA_SIZE ){
 
                 return FFS_STATUS_ERROR;
             }
@@ -379,7 +467,7 @@ int32_t ffs_page_i32_scan_file_size( ffs_file_t file_id ){
     }
 
     // return calculated file size
-    return ( (uint32_t)last_page * (uint32_t)FFS_PAGE_DATA_SIZE ) + (uint32_t)page_cache.page.len;
+    return ( (uint32_t)last_page * (uint32_t)FFS_PAGE_DATA_SIZE ) + (uint32_t)current_page->page.len;
 }
 
 
@@ -444,6 +532,9 @@ int8_t ffs_page_i8_delete_file( ffs_file_t file_id ){
     files[file_id].start_block  = FFS_BLOCK_INVALID;
     files[file_id].size         = -1;
 
+    // the file ID may be reused, so cached pages must go
+    invalidate_file( file_id );
+
     return FFS_STATUS_OK;
 }
 
@@ -457,25 +548,15 @@ int32_t ffs_page_i32_file_size( ffs_file_t file_id ){
 ffs_page_t* ffs_page_p_get_cached_page( void ){
 
     // ensure page is valid
-    ASSERT( page_cache.file_id >= 0 );
+    ASSERT( current_page->file_id >= 0 );
 
-    return &page_cache.page;
+    return &current_page->page;
 }
 
-int8_t ffs_page_i8_read( ffs_file_t file_id, uint16_t page ){
-
-    // check cache
-    if( ( page_cache.file_id == file_id ) && ( page_cache.page_number == page ) ){
-
-        flash_fs_page_cache_hits++;
+static int8_t load_page( page_cache_t *entry, ffs_file_t file_id, uint16_t page ){
 
-        return FFS_STATUS_OK;
-    }
-
-    flash_fs_page_cache_misses++;
-
-    // trash the cache
-    invalidate_cache();
+    // trash the entry
+    invalidate_entry( entry );
 
     // seek to page
     int32_t page_addr = ffs_page_i32_seek_page( file_id, page );
@@ -500,15 +581,16 @@ int8_t ffs_page_i8_read( ffs_file_t file_id, uint16_t page ){
         tries--;
 
         // read page
-        flash25_v_read( page_addr, &page_cache.page, sizeof(ffs_page_t) );
+        flash25_v_read( page_addr, &entry->page, sizeof(ffs_page_t) );
 
         // check crc
-        if( crc_u16_block( page_cache.page.data, page_cache.page.len ) == page_cache.page.crc ){
+        if( crc_u16_block( entry->page.data, entry->page.len ) == entry->page.crc ){
 
             // set up cache
-            page_cache.page_number = page;
-            page_cache.page_addr = page_addr;
-            page_cache.file_id = file_id;
+            entry->page_number = page;
+            entry->page_addr = page_addr;
+            entry->file_id = file_id;
+            entry->last_used = ++cache_clock;
 
             return FFS_STATUS_OK;
         }
@@ -518,9 +600,59 @@ int8_t ffs_page_i8_read( ffs_file_t file_id, uint16_t page ){
 
     ffs_block_v_hard_error();
 
+    invalidate_entry( entry );
+
     return FFS_STATUS_ERROR;
 }
 
+int8_t ffs_page_i8_read( ffs_file_t file_id, uint16_t page ){
+
+    // check cache
+    page_cache_t *entry = cache_lookup( file_id, page );
+
+    if( entry != 0 ){
+
+        flash_fs_page_cache_hits++;
+
+        entry->last_used = ++cache_clock;
+        current_page = entry;
+
+        return FFS_STATUS_OK;
+    }
+
+    flash_fs_page_cache_misses++;
+
+    // check for a sequential read
+    bool sequential = ( current_page->file_id == file_id ) &&
+                      ( current_page->page_number == (uint16_t)( page - 1 ) );
+
+    current_page = cache_victim( 0 );
+
+    int8_t status = load_page( current_page, file_id, page );
+
+    if( status < 0 ){
+
+        return status;
+    }
+
+    // read ahead the next page if it is in the same block and there is
+    // data in it
+    uint16_t next_page = page + 1;
+
+    if( sequential &&
+        ( FFS_PAGE_CACHE_SIZE > 1 ) &&
+        ( ( next_page % FFS_DATA_PAGES_PER_BLOCK ) != 0 ) &&
+        ( ( (int32_t)next_page * FFS_PAGE_DATA_SIZE ) < files[file_id].size ) &&
+        ( cache_lookup( file_id, next_page ) == 0 ) ){
+
+        flash_fs_page_cache_readaheads++;
+
+        load_page( cache_victim( current_page ), file_id, next_page );
+    }
+
+    return FFS_STATUS_OK;
+}
+
 int8_t ffs_page_i8_write( ffs_file_t file_id, uint16_t page, uint8_t offset, const void *data, uint8_t len ){
 
     ASSERT( file_id < FFS_MAX_FILES );
@@ -635,27 +767,34 @@ int8_t ffs_page_i8_write( ffs_file_t file_id, uint16_t page, uint8_t offset, con
         }
 
 
+        ffs_page_t *cached_page = &current_page->page;
+
         // check if EOF, in this case, we're writing to a new
         // page.  we want to prefill with 1s.
         if( page_read_status == FFS_STATUS_EOF ){
 
-            memset( &page_cache.page.data, 0xff, sizeof(page_cache.page.data) );
+            memset( cached_page->data, 0xff, sizeof(cached_page->data) );
         }
 
         // copy data into page
-        memcpy( &page_cache.page.data[offset], data, write_len );
+        memcpy( &cached_page->data[offset], data, write_len );
 
         // check if page is increasing in size
-        if( page_cache.page.len < ( offset + write_len ) ){
+        if( cached_page->len < ( offset + write_len ) ){
 
-            page_cache.page.len = offset + write_len;
+            cached_page->len = offset + write_len;
         }
 
         // calculate CRC
-        page_cache.page.crc = crc_u16_block( page_cache.page.data, page_cache.page.len );
+        cached_page->crc = crc_u16_block( cached_page->data, cached_page->len );
 
         // write to flash
-        flash25_v_write( page_addr, &page_cache.page, sizeof(ffs_page_t) );
+        flash25_v_write( page_addr, cached_page, sizeof(ffs_page_t) );
+
+        // write through: trash the cached copy so we force a reread and
+        // CRC check, and so a failed index update can't leave modified
+        // data in the cache
+        invalidate_page( file_id, page );
 
         // update index
         if( ffs_block_i8_set_index_entry( phy_block, page_index, index_info.phy_next_free ) < 0 ){
@@ -663,13 +802,10 @@ int8_t ffs_page_i8_write( ffs_file_t file_id, uint16_t page, uint8_t offset, con
             continue;
         }
 
-        // trash the cache so we force a reread and CRC check
-        invalidate_cache();
-
         if( ffs_page_i8_read( file_id, page ) == FFS_STATUS_OK ){
 
             // calculate file length up to this page plus the data in it
-            uint32_t file_length_to_here = ( (uint32_t)page * (uint32_t)FFS_PAGE_DATA_SIZE ) + page_cache.page.len;
+            uint32_t file_length_to_here = ( (uint32_t)page * (uint32_t)FFS_PAGE_DATA_SIZE ) + current_page->page.len;
 
             // check file size
             if( file_length_to_here > (uint32_t)files[file_id].size ){
@@ -810,7 +946,7 @@ static int8_t ffs_page_i8_block_copy( block_t source_block, block_t dest_block )
         }
 
         // write page data
-        flash25_v_write( page_address( dest_block, i ), &page_cache.page, sizeof(page_cache.page) );
+        flash25_v_write( page_address( dest_block, i ), &current_page->page, sizeof(current_page->page) );
 
         // read back to verify
         if( ffs_page_i8_read( meta.file_id, base_page + i ) != FFS_STATUS_OK ){
@@ -852,29 +988,15 @@ static int32_t ffs_page_i32_seek_page( ffs_file_t file_id, uint16_t page ){
         return FFS_STATUS_EOF;
     }
 
-    ffs_block_index_t *index;
-
-    // read index from block
-    if( ffs_block_i8_read_index( phy_block, &index ) < 0 ){
-
-        // read error
-        return FFS_STATUS_ERROR;
-    }
-
-    int8_t i = FFS_PAGES_PER_BLOCK - 1;
-
-    // scan index backwards to get current physical page
-    while( i >= 0 ){
+    // look up current physical page from the block's page map
+    int8_t phy_index = ffs_block_i8_get_phy_page( phy_block, page_index );
 
-        if( index->page_index[i] == page_index ){
+    if( phy_index < 0 ){
 
-            // calculate page address
-            return page_address( phy_block, i );
-        }
-
-        i--;
+        // read error, or page not found (end of file)
+        return phy_index;
     }
 
-    // page not found, assume end of file
-    return FFS_STATUS_EOF;
+    // calculate page address
+    return page_address( phy_block, phy_index );
 }
@@ -26,6 +26,7 @@
 #include "cpu.h"
 #include "system.h"
 
+#include "hash.h"
 #include "flash25.h"
 #include "ffs_fw.h"
 #include "ffs_page.h"
@@ -41,6 +42,51 @@
 
 static bool ffs_fail;
 
+#ifdef ENABLE_FFS
+// directory index: folded FNV hash of each file's name, by file ID.
+// 0 means no file at that ID.
+static uint16_t dir_index[FLASH_FS_MAX_FILES];
+
+static uint16_t hash_filename( char *filename ){
+
+    // names longer than this cannot be read back from meta0
+    uint8_t len = strnlen( filename, FFS_FILENAME_LEN - 1 );
+
+    uint32_t hash = hash_u32_data( (uint8_t *)filename, len );
+
+    uint16_t folded = (uint16_t)( hash ^ ( hash >> 16 ) );
+
+    if( folded == 0 ){
+
+        folded = 1;
+    }
+
+    return folded;
+}
+
+static void build_dir_index( void ){
+
+    memset( dir_index, 0, sizeof(dir_index) );
+
+    for( uint8_t i = 0; i < FLASH_FS_MAX_FILES; i++ ){
+
+        if( ffs_i32_get_file_size( i ) < 0 ){
+
+            continue;
+        }
+
+        char fname[FFS_FILENAME_LEN];
+
+        if( ffs_i8_read_filename( i, fname, sizeof(fname) ) < 0 ){
+
+            continue;
+        }
+
+        dir_index[i] = hash_filename( fname );
+    }
+}
+#endif
+
 void ffs_v_init( void ){
 
     #ifdef ENABLE_FFS
@@ -84,6 +130,11 @@ void ffs_v_mount( void ){
     #ifdef ENABLE_FFS
     ffs_block_v_init();
     ffs_page_v_init();
+
+    if( !ffs_fail ){
+
+        build_dir_index();
+    }
     #endif
 }
 
@@ -338,6 +389,8 @@ ffs_file_t ffs_i8_create_file( char filename[] ){
         goto clean_up;
     }
 
+    dir_index[file] = hash_filename( filename );
+
     // success
     return file;
 
@@ -387,9 +440,46 @@ int8_t ffs_i8_delete_file( ffs_file_t file_id ){
 
     ASSERT( file_id < FFS_MAX_FILES );
 
+    dir_index[file_id] = 0;
+
     return ffs_page_i8_delete_file( file_id );
 }
 
+// look up a file ID by name.
+// the hash index narrows the search to matching IDs, each of which
+// is confirmed with a name read from flash.
+ffs_file_t ffs_i8_find_file( char filename[] ){
+
+    if( ffs_fail ){
+
+        return FFS_STATUS_ERROR;
+    }
+
+    uint16_t hash = hash_filename( filename );
+
+    for( uint8_t i = 0; i < FLASH_FS_MAX_FILES; i++ ){
+
+        if( dir_index[i] != hash ){
+
+            continue;
+        }
+
+        char fname[FFS_FILENAME_LEN];
+
+        if( ffs_i8_read_filename( i, fname, sizeof(fname) ) < 0 ){
+
+            continue;
+        }
+
+        if( strncmp( fname, filename, FFS_FILENAME_LEN ) == 0 ){
+
+            return i;
+        }
+    }
+
+    return FFS_STATUS_INVALID_FILE;
+}
+
 int32_t ffs_i32_read( ffs_file_t file_id, uint32_t position, void *data, uint32_t len ){
 
     if( ffs_fail ){
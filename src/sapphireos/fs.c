@@ -105,6 +105,10 @@ typedef struct{
 	file_id_t8 file_id;
 	mode_t8 mode;
 	uint32_t current_pos;
+    // write buffer, only present with FS_MODE_WRITE_BUFFERED
+    uint32_t buf_pos;
+    uint8_t buf_len;
+    uint8_t buf[];
 } file_state_t;
 
 typedef struct{
@@ -114,8 +118,16 @@ typedef struct{
 
 static vfile_t vfiles[FS_MAX_VIRTUAL_FILES];
 
+#ifdef ENABLE_FFS
+// incremented whenever a file on the media is written or deleted,
+// so users can tell if a file changed without re-reading it.
+static uint16_t file_versions[FLASH_FS_MAX_FILES];
+#endif
+
 void fs_v_mount( void );
 
+static int8_t flush_write_buffer( file_state_t *state );
+
 #ifdef ENABLE_FFS
 static int8_t create_file_on_media( char *fname );
 static uint16_t write_to_media( file_id_t8 file_id, uint32_t pos, const void *ptr, uint16_t len );
@@ -185,6 +197,25 @@ static bool media_busy( void );
 // }
 
 
+static mem_handle_t alloc_file_state( mode_t8 *mode ){
+
+    if( *mode & FS_MODE_WRITE_BUFFERED ){
+
+        mem_handle_t handle = mem2_h_alloc2( sizeof(file_state_t) + FS_WRITE_BUFFER_SIZE, MEM_TYPE_FILE_HANDLE );
+
+        if( handle >= 0 ){
+
+            return handle;
+        }
+
+        // not enough memory for a buffer, fall back to unbuffered
+        *mode &= ~FS_MODE_WRITE_BUFFERED;
+    }
+
+    return mem2_h_alloc2( sizeof(file_state_t), MEM_TYPE_FILE_HANDLE );
+}
+
+
 // User API:
 
 // open (and/or create a file)
@@ -195,11 +226,17 @@ file_t fs_f_open( char filename[], mode_t8 mode ){
     // get file ID
     file_id_t8 file_id = fs_i8_get_file_id( filename );
 
+    // virtual files are never buffered
+    if( ( file_id >= 0 ) && FS_FILE_IS_VIRTUAL( file_id ) ){
+
+        mode &= ~FS_MODE_WRITE_BUFFERED;
+    }
+
     // check if exists
     if( file_id >= 0 ){
 
         // create file handle
-        mem_handle_t handle = mem2_h_alloc2( sizeof(file_state_t), MEM_TYPE_FILE_HANDLE );
+        mem_handle_t handle = alloc_file_state( &mode );
 
         // check allocation
         if( handle < 0 ){
@@ -212,6 +249,7 @@ file_t fs_f_open( char filename[], mode_t8 mode ){
         // set up file state
         file_state->file_id = file_id;
         file_state->mode = mode;
+        file_state->buf_len = 0;
 
         //
         // Note that the provider of the file can ignore the mode settings
@@ -235,7 +273,7 @@ file_t fs_f_open( char filename[], mode_t8 mode ){
 	if( ( mode & FS_MODE_CREATE_IF_NOT_FOUND ) != 0 ){
 
 		// create file handle
-		mem_handle_t handle = mem2_h_alloc2( sizeof(file_state_t), MEM_TYPE_FILE_HANDLE );
+		mem_handle_t handle = alloc_file_state( &mode );
 
 		// check allocation
 		if( handle < 0 ){
@@ -261,6 +299,7 @@ file_t fs_f_open( char filename[], mode_t8 mode ){
 		state->file_id = file_id;
 		state->mode = mode | FS_MODE_CREATED;
 		state->current_pos = 0;
+        state->buf_len = 0;
 
 		return handle;
 	}
@@ -357,6 +396,9 @@ int16_t fs_i16_read( file_t file, void *dst, uint16_t len ){
         return FFS_STATUS_INVALID_FILE;
     }
 
+    // make sure reads see buffered writes
+    flush_write_buffer( state );
+
     int16_t bytes_read = fs_i16_read_id( state->file_id, state->current_pos, dst, len );
 
     if( bytes_read > 0 ){
@@ -443,6 +485,71 @@ int16_t fs_i16_write( file_t file, const void *src, uint16_t len ){
         return -1;
     }
 
+    if( state->mode & FS_MODE_WRITE_BUFFERED ){
+
+        // a write that doesn't continue the buffered data
+        // needs the buffer flushed first.
+        if( ( state->buf_len > 0 ) &&
+            ( state->current_pos != ( state->buf_pos + state->buf_len ) ) ){
+
+            if( flush_write_buffer( state ) < 0 ){
+
+                return 0;
+            }
+        }
+
+        const uint8_t *src_ptr = (const uint8_t *)src;
+        uint16_t bytes_written = 0;
+
+        while( len > 0 ){
+
+            // buffer ends on a page boundary (a previous flush failed)
+            if( ( state->buf_len > 0 ) &&
+                ( ( ( state->buf_pos + state->buf_len ) % FS_WRITE_BUFFER_SIZE ) == 0 ) ){
+
+                if( flush_write_buffer( state ) < 0 ){
+
+                    break;
+                }
+            }
+
+            if( state->buf_len == 0 ){
+
+                state->buf_pos = state->current_pos;
+            }
+
+            // fill up to the end of the current flash page
+            uint16_t page_remaining = FS_WRITE_BUFFER_SIZE -
+                ( ( state->buf_pos + state->buf_len ) % FS_WRITE_BUFFER_SIZE );
+
+            uint16_t copy_len = len;
+
+            if( copy_len > page_remaining ){
+
+                copy_len = page_remaining;
+            }
+
+            memcpy( &state->buf[state->buf_len], src_ptr, copy_len );
+
+            state->buf_len += copy_len;
+            state->current_pos += copy_len;
+            src_ptr += copy_len;
+            len -= copy_len;
+            bytes_written += copy_len;
+
+            // write out a full page
+            if( copy_len == page_remaining ){
+
+                if( flush_write_buffer( state ) < 0 ){
+
+                    break;
+                }
+            }
+        }
+
+        return bytes_written;
+    }
+
     uint16_t bytes_written = fs_i16_write_id( state->file_id, state->current_pos, src, len );
 
     if( bytes_written > 0 ){
@@ -477,7 +584,17 @@ int32_t fs_i32_get_size( file_t file ){
     #ifdef ENABLE_FFS
     else{
 
-        return ffs_i32_get_file_size( state->file_id );
+        int32_t size = ffs_i32_get_file_size( state->file_id );
+
+        // include data still held in the write buffer
+        if( ( size >= 0 ) &&
+            ( state->buf_len > 0 ) &&
+            ( (int32_t)( state->buf_pos + state->buf_len ) > size ) ){
+
+            size = state->buf_pos + state->buf_len;
+        }
+
+        return size;
     }
     #endif
 
@@ -513,6 +630,8 @@ void fs_v_seek( file_t file, uint32_t pos ){
         return;
     }
 
+    flush_write_buffer( state );
+
 	if( (int32_t)pos > fs_i32_get_size( file ) ){
 
 		pos = fs_i32_get_size( file );
@@ -546,9 +665,48 @@ void fs_v_delete( file_t file ){
 
     // set file id to invalid
     state->file_id = -1;
+
+    // discard buffered data
+    state->buf_len = 0;
+}
+
+// returns the version count of a file.  this changes every time the
+// file's contents on the media are written or the file is deleted.
+uint16_t fs_u16_get_version( file_t file ){
+
+    // get file state
+	file_state_t *state = mem2_vp_get_ptr( file );
+
+    // check for invalid file
+    if( state->file_id < 0 ){
+
+        return 0;
+    }
+
+    #ifdef ENABLE_FFS
+    if( !FS_FILE_IS_VIRTUAL( state->file_id ) ){
+
+        return file_versions[state->file_id];
+    }
+    #endif
+
+    return 0;
+}
+
+// write any buffered data to the media.
+// returns 0 on success, -1 if buffered data could not be written.
+int8_t fs_i8_sync( file_t file ){
+
+    // get file state
+	file_state_t *state = mem2_vp_get_ptr( file );
+
+    return flush_write_buffer( state );
 }
 
-// close a file
+// close a file.
+// close always frees the handle and returns -1, so a buffered write that
+// could not be flushed is lost.  callers that need to know whether their
+// data made it to the media must check fs_i8_sync() before closing.
 file_t fs_f_close( file_t file ){
 
     // get file state
@@ -557,8 +715,8 @@ file_t fs_f_close( file_t file ){
     // check if not virtual
     if( !FS_FILE_IS_VIRTUAL( state->file_id ) ){
 
-        // flush the file cache
-        // .... if we had one
+        // flush the write buffer
+        flush_write_buffer( state );
     }
 
 	mem2_v_free( file );
@@ -568,6 +726,49 @@ file_t fs_f_close( file_t file ){
 
 
 
+static int8_t flush_write_buffer( file_state_t *state ){
+
+    if( ( state->mode & FS_MODE_WRITE_BUFFERED ) == 0 ){
+
+        return 0;
+    }
+
+    if( state->buf_len == 0 ){
+
+        return 0;
+    }
+
+    // file was deleted out from under us, nothing to write to
+    if( state->file_id < 0 ){
+
+        state->buf_len = 0;
+
+        return -1;
+    }
+
+    int16_t bytes_written = fs_i16_write_id( state->file_id, state->buf_pos, state->buf, state->buf_len );
+
+    if( bytes_written < 0 ){
+
+        bytes_written = 0;
+    }
+
+    // keep anything that didn't make it, so a later flush can retry
+    if( bytes_written < state->buf_len ){
+
+        state->buf_len -= bytes_written;
+        state->buf_pos += bytes_written;
+        memmove( state->buf, &state->buf[bytes_written], state->buf_len );
+
+        return -1;
+    }
+
+    state->buf_len = 0;
+
+    return 0;
+}
+
+
 // initialize file system
 void fs_v_init( void ){
 
@@ -618,24 +819,11 @@ file_id_t8 fs_i8_get_file_id( char *filename ){
     }
     #ifdef ENABLE_FFS
     // search for file on flash file system
-    for( uint8_t i = 0; i < FLASH_FS_MAX_FILES; i++ ){
-
-        // does file at this id exist
-        if( ffs_i32_get_file_size( i ) < 0 ){
-
-            continue;
-        }
-
-        char fname[FS_MAX_FILE_NAME_LEN];
-
-        // read file name from media
-        read_fname_from_media( i, fname, sizeof(fname) );
+    file_id_t8 file_id = ffs_i8_find_file( filename );
 
-        // compare file name
-        if( strncmp( fname, filename, FS_MAX_FILE_NAME_LEN ) == 0 ){
+    if( file_id >= 0 ){
 
-            return i;
-        }
+        return file_id;
     }
     #endif
 
@@ -773,6 +961,8 @@ int8_t fs_i8_delete_id( file_id_t8 id ){
             }
         }
 
+        file_versions[id]++;
+
         return ffs_i8_delete_file( id );
     }
     #endif
@@ -910,6 +1100,11 @@ static uint16_t write_to_media( file_id_t8 file_id, uint32_t pos, const void *pt
         return 0;
     }
 
+    if( write_len > 0 ){
+
+        file_versions[file_id]++;
+    }
+
     return write_len;
 }
 
@@ -47,6 +47,9 @@ typedef uint8_t mode_t8;
 #define FS_MODE_CREATE_IF_NOT_FOUND	0b00010000
 #define FS_MODE_CREATED				0b00100000
 #define FS_MODE_VIRTUAL				0b01000000
+#define FS_MODE_WRITE_BUFFERED      0b10000000 // coalesce writes into whole flash pages
+
+#define FS_WRITE_BUFFER_SIZE        FFS_PAGE_DATA_SIZE
 
 typedef uint8_t vfile_op_t8;
 #define FS_VFILE_OP_OPEN            1
@@ -86,6 +89,8 @@ int16_t fs_i16_write( file_t file, const void *src, uint16_t len );
 int32_t fs_i32_get_size( file_t file );
 int32_t fs_i32_tell( file_t file );
 void fs_v_seek( file_t file, uint32_t pos );
+int8_t fs_i8_sync( file_t file );
+uint16_t fs_u16_get_version( file_t file );
 void fs_v_delete( file_t file );
 file_t fs_f_close( file_t file );
 
@@ -40,11 +40,19 @@
 
 
 static uint32_t kv_persist_writes;
+static uint16_t kv_persist_appends;
 static int32_t kv_test_key;
 
 static int16_t cached_index = -1;
 static catbus_hash_t32 cached_hash;
 
+// RAM copy of the firmware hash index:
+// kv_index_h holds the sorted hashes followed by their meta indexes,
+// kv_reverse_h holds the hash for each meta index.
+static mem_handle_t kv_index_h = -1;
+static mem_handle_t kv_reverse_h = -1;
+static uint16_t kv_index_count;
+
 static const PROGMEM char kv_data_fname[] = "kv_data";
 
 #if defined(__SIM__) || defined(BOOTLOADER)
@@ -93,6 +101,7 @@ static int8_t _kv_i8_dynamic_count_handler(
 
 KV_SECTION_META kv_meta_t kv_cfg[] = {
     { SAPPHIRE_TYPE_UINT32,  0, 0,                   &kv_persist_writes,  0,           "kv_persist_writes" },
+    { SAPPHIRE_TYPE_UINT16,  0, KV_FLAGS_READ_ONLY,  &kv_persist_appends, 0,           "kv_persist_appends" },
     { SAPPHIRE_TYPE_INT32,   0, 0,                   &kv_test_key,        0,           "kv_test_key" },
     { SAPPHIRE_TYPE_UINT16,  0, KV_FLAGS_READ_ONLY,  0, _kv_i8_dynamic_count_handler,  "kv_dynamic_count" },
     { SAPPHIRE_TYPE_UINT16,  0, KV_FLAGS_READ_ONLY,  0, _kv_i8_dynamic_count_handler,  "kv_dynamic_db_size" },
@@ -140,9 +149,135 @@ typedef struct{
 #define KV_PERSIST_MAX_DATA_LEN     SAPPHIRE_TYPE_MAX_LEN
 #define KV_PERSIST_BLOCK_LEN        ( sizeof(kv_persist_block_header_t) + KV_PERSIST_MAX_DATA_LEN )
 
+#define KV_PERSIST_SLOT_POS(slot)   ( sizeof(kv_persist_file_header_t) + ( (uint32_t)(slot) * KV_PERSIST_BLOCK_LEN ) )
+
+// RAM index of the persisted keys that have a RAM pointer,
+// in kv_meta order, mapping each one to its record slot in kv_data.
+// a dirty bitmap (one bit per entry) follows the entries.
+typedef struct{
+    uint16_t index; // kv meta index
+    uint16_t slot;  // record number in kv_data
+} kv_persist_slot_t;
+#define KV_PERSIST_SLOT_NONE        0xffff
+
+static mem_handle_t persist_slots_h = -1;
+static uint16_t persist_count;
+
 
 PT_THREAD( persist_thread( pt_t *pt, void *state ) );
 
+static uint16_t _kv_u16_fixed_count( void );
+
+static kv_persist_slot_t *_kv_p_persist_slots( void ){
+
+    return (kv_persist_slot_t *)mem2_vp_get_ptr( persist_slots_h );
+}
+
+static uint8_t *_kv_p_persist_dirty( void ){
+
+    return (uint8_t *)( _kv_p_persist_slots() + persist_count );
+}
+
+// look up the persist slot entry for a kv meta index.
+// entries are in meta order, so this is a binary search.
+static int16_t _kv_i16_persist_entry( int16_t index ){
+
+    if( persist_slots_h < 0 ){
+
+        return -1;
+    }
+
+    kv_persist_slot_t *slots = _kv_p_persist_slots();
+
+    int16_t first = 0;
+    int16_t last = persist_count - 1;
+
+    while( first <= last ){
+
+        int16_t middle = ( first + last ) / 2;
+
+        if( slots[middle].index < index ){
+
+            first = middle + 1;
+        }
+        else if( slots[middle].index == index ){
+
+            return middle;
+        }
+        else{
+
+            last = middle - 1;
+        }
+    }
+
+    return -1;
+}
+
+static void _kv_v_persist_mark_dirty( catbus_hash_t32 hash ){
+
+    int16_t entry = _kv_i16_persist_entry( kv_i16_search_hash( hash ) );
+
+    if( entry < 0 ){
+
+        return;
+    }
+
+    _kv_p_persist_dirty()[entry / 8] |= ( 1 << ( entry % 8 ) );
+
+    run_persist = TRUE;
+}
+
+static int8_t _kv_i8_alloc_persist_slots( void ){
+
+    kv_meta_t meta;
+    uint16_t count = 0;
+
+    for( uint16_t i = 0; i < _kv_u16_fixed_count(); i++ ){
+
+        kv_i8_lookup_index( i, &meta, 0 );
+
+        if( ( meta.flags & KV_FLAGS_PERSIST ) && ( meta.ptr != 0 ) ){
+
+            count++;
+        }
+    }
+
+    uint16_t size = ( count * sizeof(kv_persist_slot_t) ) + ( ( count + 7 ) / 8 );
+
+    if( size == 0 ){
+
+        size = 1;
+    }
+
+    persist_slots_h = mem2_h_alloc( size );
+
+    if( persist_slots_h < 0 ){
+
+        return -1;
+    }
+
+    persist_count = count;
+
+    kv_persist_slot_t *slots = _kv_p_persist_slots();
+    count = 0;
+
+    for( uint16_t i = 0; i < _kv_u16_fixed_count(); i++ ){
+
+        kv_i8_lookup_index( i, &meta, 0 );
+
+        if( ( meta.flags & KV_FLAGS_PERSIST ) && ( meta.ptr != 0 ) ){
+
+            slots[count].index  = i;
+            slots[count].slot   = KV_PERSIST_SLOT_NONE;
+            count++;
+        }
+    }
+
+    memset( _kv_p_persist_dirty(), 0, ( persist_count + 7 ) / 8 );
+
+    return 0;
+}
+
 static int8_t _kv_i8_persist_set_internal(
     file_t f,
     kv_meta_t *meta,
@@ -211,6 +346,98 @@ uint16_t kv_u16_count( void ){
     return count;
 }
 
+static uint32_t _kv_u32_index_start( void ){
+
+    return ( ffs_fw_u32_read_internal_length() - sizeof(uint16_t) ) -
+           ( (uint32_t)_kv_u16_fixed_count() * sizeof(kv_hash_index_t) );
+}
+
+static void _kv_v_init_ram_index( void ){
+
+    uint16_t count = _kv_u16_fixed_count();
+
+    uint16_t forward_size = count * ( sizeof(catbus_hash_t32) + sizeof(uint8_t) );
+    uint16_t reverse_size = count * sizeof(catbus_hash_t32);
+
+    if( ( count == 0 ) || ( forward_size > KV_RAM_INDEX_BUDGET ) ){
+
+        return;
+    }
+
+    kv_index_h = mem2_h_alloc( forward_size );
+
+    if( kv_index_h < 0 ){
+
+        return;
+    }
+
+    if( ( forward_size + reverse_size ) <= KV_RAM_INDEX_BUDGET ){
+
+        kv_reverse_h = mem2_h_alloc( reverse_size );
+
+        if( kv_reverse_h >= 0 ){
+
+            memset( mem2_vp_get_ptr( kv_reverse_h ), 0, reverse_size );
+        }
+    }
+
+    kv_index_count = count;
+
+    uint32_t kv_index_start = _kv_u32_index_start();
+
+    for( uint16_t i = 0; i < count; i++ ){
+
+        kv_hash_index_t index_entry;
+        memcpy_PF( &index_entry, kv_index_start + ( (uint32_t)i * sizeof(kv_hash_index_t) ), sizeof(index_entry) );
+
+        catbus_hash_t32 *hashes = mem2_vp_get_ptr( kv_index_h );
+        uint8_t *indexes = (uint8_t *)( hashes + count );
+
+        hashes[i] = index_entry.hash;
+        indexes[i] = index_entry.index;
+
+        if( kv_reverse_h >= 0 ){
+
+            catbus_hash_t32 *reverse = mem2_vp_get_ptr( kv_reverse_h );
+
+            if( index_entry.index < count ){
+
+                reverse[index_entry.index] = index_entry.hash;
+            }
+        }
+    }
+}
+
+static int16_t _kv_i16_search_ram_index( catbus_hash_t32 hash ){
+
+    catbus_hash_t32 *hashes = mem2_vp_get_ptr( kv_index_h );
+
+    int16_t first = 0;
+    int16_t last = kv_index_count - 1;
+
+    while( first <= last ){
+
+        int16_t middle = ( first + last ) / 2;
+
+        if( hashes[middle] < hash ){
+
+            first = middle + 1;
+        }
+        else if( hashes[middle] == hash ){
+
+            uint8_t *indexes = (uint8_t *)( hashes + kv_index_count );
+
+            return indexes[middle];
+        }
+        else{
+
+            last = middle - 1;
+        }
+    }
+
+    return -1;
+}
+
 int16_t kv_i16_search_hash( catbus_hash_t32 hash ){
 
     // check if hash exists
@@ -225,9 +452,24 @@ int16_t kv_i16_search_hash( catbus_hash_t32 hash ){
         return cached_index;
     }
 
+    // check RAM index
+    if( kv_index_h >= 0 ){
+
+        int16_t index = _kv_i16_search_ram_index( hash );
+
+        if( index >= 0 ){
+
+            cached_hash = hash;
+            cached_index = index;
+
+            return index;
+        }
+
+        goto dynamic;
+    }
+
     // get address of hash index
-    uint32_t kv_index_start = ( ffs_fw_u32_read_internal_length() - sizeof(uint16_t) ) -
-                              ( (uint32_t)_kv_u16_fixed_count() * sizeof(kv_hash_index_t) );
+    uint32_t kv_index_start = _kv_u32_index_start();
 
     int16_t first = 0;
     int16_t last = _kv_u16_fixed_count() - 1;
@@ -259,6 +501,7 @@ int16_t kv_i16_search_hash( catbus_hash_t32 hash ){
         middle = ( first + last ) / 2;
     }
 
+dynamic:;
     // try lookup by hash    
     int16_t index = kvdb_i16_get_index_for_hash( hash );
 
@@ -273,8 +516,19 @@ int16_t kv_i16_search_hash( catbus_hash_t32 hash ){
 
 uint32_t kv_u32_get_hash_from_index( uint16_t index ){
 
-    uint32_t kv_index_start = ( ffs_fw_u32_read_internal_length() - sizeof(uint16_t) ) -
-                              ( (uint32_t)_kv_u16_fixed_count() * sizeof(kv_hash_index_t) );
+    if( kv_reverse_h >= 0 ){
+
+        if( index >= kv_index_count ){
+
+            return 0;
+        }
+
+        catbus_hash_t32 *reverse = mem2_vp_get_ptr( kv_reverse_h );
+
+        return reverse[index];
+    }
+
+    uint32_t kv_index_start = _kv_u32_index_start();
 
     kv_hash_index_t index_entry;
 
@@ -437,9 +691,17 @@ retry:;
         }
     }
 
+    if( ( persist_slots_h < 0 ) && ( _kv_i8_alloc_persist_slots() < 0 ) ){
+
+        fs_f_close( f );
+
+        return -1;
+    }
+
     uint8_t buf[KV_PERSIST_BLOCK_LEN];
     kv_persist_block_header_t *hdr = (kv_persist_block_header_t *)buf;
     kv_meta_t meta;
+    uint16_t slot = 0;
 
     while( fs_i16_read( f, buf, sizeof(buf) ) == sizeof(buf) ){
 
@@ -459,7 +721,18 @@ retry:;
             }
 
             memcpy( meta.ptr, buf + sizeof(kv_persist_block_header_t), type_size );
+
+            // record slot.  if a key appears more than once, the
+            // later record is the newer one (see _kv_i8_persist_slot).
+            int16_t entry = _kv_i16_persist_entry( kv_i16_search_hash( hdr->hash ) );
+
+            if( entry >= 0 ){
+
+                _kv_p_persist_slots()[entry].slot = slot;
+            }
         }
+
+        slot++;
     }
 
     fs_f_close( f );
@@ -472,6 +745,8 @@ void kv_v_init( void ){
 
     // fs_f_create_virtual( PSTR("kvmeta"), kv_meta_vfile_handler );
 
+    _kv_v_init_ram_index();
+
     // check if safe mode
     if( sys_u8_get_mode() != SYS_MODE_SAFE ){
 
@@ -584,6 +859,106 @@ end:
 }
 
 
+// write the current value of a RAM backed persist key to its record.
+//
+// if the value bytes of an existing record fit in a single flash page,
+// only those bytes are rewritten, which the FFS commits atomically.
+// otherwise, a complete new record is appended and the old record's hash
+// is cleared afterwards.  if we lose power in between, both records
+// exist and the later one wins when the file is loaded.
+static int8_t _kv_i8_persist_slot( file_t f, uint16_t entry ){
+
+    kv_meta_t meta;
+
+    kv_persist_slot_t slot_info = _kv_p_persist_slots()[entry];
+
+    if( kv_i8_lookup_index( slot_info.index, &meta, KV_META_FLAGS_GET_NAME ) < 0 ){
+
+        return -1;
+    }
+
+    uint16_t len = kv_u16_get_size_meta( &meta );
+
+    if( len > KV_PERSIST_MAX_DATA_LEN ){
+
+        len = KV_PERSIST_MAX_DATA_LEN;
+    }
+
+    uint8_t buf[KV_PERSIST_MAX_DATA_LEN];
+    memset( buf, 0, sizeof(buf) );
+
+    ATOMIC;
+    memcpy( buf, meta.ptr, len );
+    END_ATOMIC;
+
+    if( slot_info.slot != KV_PERSIST_SLOT_NONE ){
+
+        uint32_t pos = KV_PERSIST_SLOT_POS( slot_info.slot ) + sizeof(kv_persist_block_header_t);
+
+        if( ( pos / FS_WRITE_BUFFER_SIZE ) == ( ( pos + len - 1 ) / FS_WRITE_BUFFER_SIZE ) ){
+
+            fs_v_seek( f, pos );
+
+            if( fs_i16_write( f, buf, len ) != len ){
+
+                return -1;
+            }
+
+            kv_persist_writes++;
+
+            return 0;
+        }
+    }
+
+    // append a new record.
+    // a partial record left at the end of the file by an interrupted append
+    // is overwritten.
+    int32_t size = fs_i32_get_size( f );
+
+    if( size < (int32_t)sizeof(kv_persist_file_header_t) ){
+
+        return -1;
+    }
+
+    uint16_t new_slot = ( size - sizeof(kv_persist_file_header_t) ) / KV_PERSIST_BLOCK_LEN;
+
+    kv_persist_block_header_t hdr;
+    hdr.hash        = hash_u32_string( meta.name );
+    hdr.type        = meta.type;
+    hdr.array_len   = meta.array_len;
+    memset( hdr.reserved, 0, sizeof(hdr.reserved) );
+
+    fs_v_seek( f, KV_PERSIST_SLOT_POS( new_slot ) );
+
+    if( ( fs_i16_write( f, &hdr, sizeof(hdr) ) != sizeof(hdr) ) ||
+        ( fs_i16_write( f, buf, sizeof(buf) ) != sizeof(buf) ) ){
+
+        return -1;
+    }
+
+    // make sure the new record is on the media before the old one is retired
+    if( fs_i8_sync( f ) < 0 ){
+
+        return -1;
+    }
+
+    // retire the old record
+    if( slot_info.slot != KV_PERSIST_SLOT_NONE ){
+
+        catbus_hash_t32 dead_hash = 0;
+
+        fs_v_seek( f, KV_PERSIST_SLOT_POS( slot_info.slot ) );
+        fs_i16_write( f, &dead_hash, sizeof(dead_hash) );
+    }
+
+    _kv_p_persist_slots()[entry].slot = new_slot;
+
+    kv_persist_writes++;
+    kv_persist_appends++;
+
+    return 0;
+}
+
 static int8_t _kv_i8_persist_set(
     kv_meta_t *meta,
     catbus_hash_t32 hash,
@@ -598,7 +973,7 @@ static int8_t _kv_i8_persist_set(
 
     ASSERT( len <= KV_PERSIST_MAX_DATA_LEN );
 
-    file_t f = fs_f_open_P( kv_data_fname, FS_MODE_WRITE_OVERWRITE | FS_MODE_CREATE_IF_NOT_FOUND );
+    file_t f = fs_f_open_P( kv_data_fname, FS_MODE_WRITE_OVERWRITE | FS_MODE_CREATE_IF_NOT_FOUND | FS_MODE_WRITE_BUFFERED );
 
     if( f < 0 ){
 
@@ -607,6 +982,11 @@ static int8_t _kv_i8_persist_set(
 
     int8_t status = _kv_i8_persist_set_internal( f, meta, hash, data, len );
 
+    if( fs_i8_sync( f ) < 0 ){
+
+        status = -1;
+    }
+
     fs_f_close( f );
 
     return status;
@@ -644,7 +1024,7 @@ static int8_t _kv_i8_internal_set(
         else{
 
             // signal thread to persist in background
-            run_persist = TRUE;
+            _kv_v_persist_mark_dirty( hash );
         }
     }
 
@@ -873,6 +1253,14 @@ int8_t kv_i8_persist( catbus_hash_t32 hash )
         return -1;
     }
 
+    // RAM backed keys are written by the persist thread
+    if( meta.ptr != 0 ){
+
+        _kv_v_persist_mark_dirty( hash );
+
+        return 0;
+    }
+
     // get parameter data
     uint8_t data[KV_PERSIST_MAX_DATA_LEN];
     _kv_i8_internal_get( &meta, hash, data, sizeof(data) );
@@ -889,7 +1277,7 @@ PT_THREAD( persist_thread( pt_t *pt, void *state ) )
 {
 PT_BEGIN( pt );
 
-    static kv_meta_t *ptr;
+    static uint16_t entry;
     static file_t f;
 
     while(1){
@@ -898,40 +1286,52 @@ PT_BEGIN( pt );
 
         run_persist = FALSE;
 
-        f = fs_f_open_P( kv_data_fname, FS_MODE_WRITE_OVERWRITE );
+        // write only the records that have changed
+        for( entry = 0; entry < persist_count; entry++ ){
 
-        if( f < 0 ){
+            uint8_t *dirty = _kv_p_persist_dirty();
 
-            goto end;
-        }
+            if( ( dirty[entry / 8] & ( 1 << ( entry % 8 ) ) ) == 0 ){
+
+                continue;
+            }
+
+            f = fs_f_open_P( kv_data_fname, FS_MODE_WRITE_OVERWRITE | FS_MODE_WRITE_BUFFERED );
 
-        kv_meta_t meta;
-        ptr = (kv_meta_t *)kv_start;
+            if( f < 0 ){
 
-        // iterate through handlers
-        while( ptr < kv_end ){
+                // leave the entry dirty and try again on the next pass
+                run_persist = TRUE;
 
-            // load meta data
-            memcpy_P( &meta, ptr, sizeof(kv_meta_t) );
+                break;
+            }
 
-            // check flags - and that there is a RAM pointer
-            if( ( ( meta.flags & KV_FLAGS_PERSIST ) != 0 ) &&
-                  ( meta.ptr != 0 ) ){
+            // clear before writing, so a change during the write is
+            // picked up on the next pass.
+            // the open may have moved the dirty bits, so get them again.
+            _kv_p_persist_dirty()[entry / 8] &= ~( 1 << ( entry % 8 ) );
 
-                uint16_t param_len = kv_u16_get_size_meta( &meta );
+            int8_t status = _kv_i8_persist_slot( f, entry );
 
-                uint32_t hash = hash_u32_string( meta.name );
-                _kv_i8_persist_set_internal( f, &meta, hash, meta.ptr, param_len );
-            }   
+            if( fs_i8_sync( f ) < 0 ){
 
-            ptr++;
+                status = -1;
+            }
+
+            f = fs_f_close( f );
+
+            if( status < 0 ){
+
+                // try again on the next pass
+                _kv_p_persist_dirty()[entry / 8] |= ( 1 << ( entry % 8 ) );
+                run_persist = TRUE;
+
+                break;
+            }
 
             TMR_WAIT( pt, 20 );
         }
 
-        f = fs_f_close( f );
-
-end:
         // prevent back to back updates from swamping the system
         TMR_WAIT( pt, 2000 );
     }
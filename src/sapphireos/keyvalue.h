@@ -35,6 +35,13 @@
 
 #define KV_PERSIST_VERSION          4
 
+// memory budget (in bytes) for the RAM copy of the firmware KV hash index.
+// the forward (hash -> index) table is built first, then the reverse
+// (index -> hash) table, each only if it fits.  0 disables the RAM index.
+#ifndef KV_RAM_INDEX_BUDGET
+    #define KV_RAM_INDEX_BUDGET     2048
+#endif
+
 #define KV_NAME_LEN                 CATBUS_STRING_LEN
 
 
@@ -80,7 +80,7 @@ static int16_t _kvdb_i16_search_hash( catbus_hash_t32 hash ){
 
     db_entry32_t *entry = (db_entry32_t *)mem2_vp_get_ptr( handle );
     int16_t first = 0;
-    int16_t last = db_size - 1;
+    int16_t last = kv_count - 1;
     int16_t middle = ( first + last ) / 2;
     
     // binary search through hash index
@@ -110,29 +110,116 @@ static int16_t _kvdb_i16_search_hash( catbus_hash_t32 hash ){
 
 static void _kvdb_v_sort( void ){
 
-    // bubble sort
+    // insertion sort of the live entries, descending by hash.
+    // this is only used to merge a batch, where the front of the
+    // database is already sorted.
 
     db_entry32_t *entry = (db_entry32_t *)mem2_vp_get_ptr( handle );
 
-    bool swapped;
-    do{
+    for( uint16_t i = 1; i < kv_count; i++ ){
 
-        swapped = FALSE;
-    
-        for( uint16_t i = 1; i < db_size; i++ ){            
+        db_entry32_t temp = entry[i];
+        uint16_t j = i;
 
-            if( entry[i - 1].hash < entry[i].hash ){
+        while( ( j > 0 ) && ( entry[j - 1].hash < temp.hash ) ){
 
-                // swap values
-                db_entry32_t temp = entry[i];
-                entry[i] = entry[i - 1];
-                entry[i - 1] = temp;
+            entry[j] = entry[j - 1];
+            j--;
+        }
 
-                swapped = TRUE;
-            }
-        }                
+        entry[j] = temp;
+    }
+}
+
+// returns the index where hash should be inserted to keep the
+// live entries in order
+static uint16_t _kvdb_u16_insert_index( catbus_hash_t32 hash ){
+
+    db_entry32_t *entry = (db_entry32_t *)mem2_vp_get_ptr( handle );
+    uint16_t first = 0;
+    uint16_t last = kv_count;
+
+    while( first < last ){
+
+        uint16_t middle = ( first + last ) / 2;
+
+        if( entry[middle].hash > hash ){
+
+            first = middle + 1;
+        }
+        else{
+
+            last = middle;
+        }
+    }
+
+    return first;
+}
+
+// make sure there is room for at least count entries
+static int8_t _kvdb_i8_reserve( uint16_t count ){
+
+    if( count > KVDB_MAX_ENTRIES ){
+
+        return KVDB_STATUS_NOT_ENOUGH_SPACE;
+    }
+
+    if( count <= db_size ){
+
+        return KVDB_STATUS_OK;
+    }
 
-    } while( swapped );
+    // grow geometrically, to cut down on reallocs as the database fills
+    uint16_t new_size = db_size + ( db_size / 2 );
+
+    if( new_size < ( db_size + KVDB_SIZE_INCREMENT ) ){
+
+        new_size = db_size + KVDB_SIZE_INCREMENT;
+    }
+
+    if( new_size < count ){
+
+        new_size = count;
+    }
+
+    if( new_size > KVDB_MAX_ENTRIES ){
+
+        new_size = KVDB_MAX_ENTRIES;
+    }
+
+    // try to increase database size
+    if( mem2_i8_realloc( handle, new_size * sizeof(db_entry32_t) ) < 0 ){
+
+        // try again with just what we need
+        new_size = count;
+
+        if( mem2_i8_realloc( handle, new_size * sizeof(db_entry32_t) ) < 0 ){
+
+            return KVDB_STATUS_NOT_ENOUGH_SPACE;
+        }
+    }
+
+    // lets 0 out the new entries
+    db_entry32_t *entry = (db_entry32_t *)mem2_vp_get_ptr( handle );
+
+    for( uint16_t i = db_size; i < new_size; i++ ){
+
+        entry[i].hash = 0;
+    }
+
+    // adjust db size
+    db_size = new_size;
+
+    return KVDB_STATUS_OK;
+}
+
+static void _kvdb_v_init_entry( db_entry32_t *entry, catbus_hash_t32 hash, int32_t data, uint8_t tag ){
+
+    entry->hash   = hash;
+    entry->data   = data;
+    entry->flags  = CATBUS_FLAGS_DYNAMIC;
+    entry->tag    = tag;
+    entry->type   = CATBUS_TYPE_INT32;
 }
 
 #ifdef KVDB_ENABLE_NAME_LOOKUP
@@ -236,71 +323,122 @@ int8_t kvdb_i8_add( catbus_hash_t32 hash, int32_t data, uint8_t tag, char name[C
     // not found, we need to add this entry
 
     // check if we have enough space
-    if( kv_count >= KVDB_MAX_ENTRIES ){
+    if( _kvdb_i8_reserve( kv_count + 1 ) < 0 ){
 
         return KVDB_STATUS_NOT_ENOUGH_SPACE;
     }
 
-    if( kv_count >= db_size ){
+    // find insertion point and shift the rest of the entries down
+    uint16_t index = _kvdb_u16_insert_index( hash );
 
-        uint16_t new_size = ( db_size + KVDB_SIZE_INCREMENT ) * sizeof(db_entry32_t);
+    db_entry32_t *entry = (db_entry32_t *)mem2_vp_get_ptr( handle );
 
-        // try to increase database size
-        if( mem2_i8_realloc( handle, new_size ) < 0 ){
+    memmove( &entry[index + 1], &entry[index], ( kv_count - index ) * sizeof(db_entry32_t) );
 
-            return KVDB_STATUS_NOT_ENOUGH_SPACE;    
-        }
+    _kvdb_v_init_entry( &entry[index], hash, data, tag );
 
-        // success!
+    kv_count++;
 
-        // lets 0 out the new entries
-        db_entry32_t *entry = (db_entry32_t *)mem2_vp_get_ptr( handle );
+    // indexes have shifted
+    cached_index = -1;
 
-        for( uint16_t i = db_size; i < ( db_size + KVDB_SIZE_INCREMENT ); i++ ){
+    #ifdef KVDB_ENABLE_NAME_LOOKUP
+    // add name
+    if( name != 0 ){
 
-            entry[i].hash = 0;
-        }
+        _kvdb_v_add_name( name );
+    }
+    #endif
+
+    return KVDB_STATUS_OK;
+}
 
-        // adjust db size
-        db_size += KVDB_SIZE_INCREMENT;
+// add a list of hashes with a data value of 0.
+// new entries are appended and the database is sorted once at the end.
+int8_t kvdb_i8_add_batch( const catbus_hash_t32 *hashes, uint16_t count, uint8_t tag ){
+
+    if( handle < 0 ){
+
+        return KVDB_STATUS_NOT_ENOUGH_SPACE;
     }
 
-    db_entry32_t *entry = (db_entry32_t *)mem2_vp_get_ptr( handle );
+    int8_t status = KVDB_STATUS_OK;
+
+    // reserve space up front.
+    // if that fails, add as many as we can.
+    uint16_t needed = kv_count + count;
+
+    if( needed > KVDB_MAX_ENTRIES ){
 
-    // find a free index
-    for( uint16_t i = 0; i < db_size; i++ ){
+        needed = KVDB_MAX_ENTRIES;
+    }
+
+    _kvdb_i8_reserve( needed );
+
+    // new entries go after the sorted part of the database.
+    // kv_count is not updated until they are sorted in, so lookups
+    // during the batch only see sorted entries.
+    uint16_t added = 0;
+
+    for( uint16_t i = 0; i < count; i++ ){
 
-        // check if free
-        if( entry[i].hash == 0 ){
+        catbus_hash_t32 hash = hashes[i];
+
+        if( hash == 0 ){
+
+            status = KVDB_STATUS_INVALID_HASH;
+
+            continue;
+        }
+
+        // already in the database
+        if( kvdb_i8_set( hash, 0 ) == KVDB_STATUS_OK ){
+
+            continue;
+        }
+
+        db_entry32_t *entry = (db_entry32_t *)mem2_vp_get_ptr( handle );
 
-            // add
-            entry[i].hash   = hash;
-            entry[i].data   = data;
-            entry[i].flags  = CATBUS_FLAGS_DYNAMIC;
-            entry[i].tag    = tag;
-            entry[i].type   = CATBUS_TYPE_INT32;
+        // check for duplicates within the batch
+        bool found = FALSE;
 
-            #ifdef KVDB_ENABLE_NAME_LOOKUP
-            // add name
-            if( name != 0 ){
+        for( uint16_t j = kv_count; j < ( kv_count + added ); j++ ){
 
-                _kvdb_v_add_name( name );
+            if( entry[j].hash == hash ){
+
+                found = TRUE;
+                break;
             }
-            #endif
+        }
 
-            break;
+        if( found ){
+
+            continue;
         }
+
+        if( ( kv_count + added ) >= db_size ){
+
+            // out of room, but keep going so existing keys are still set
+            status = KVDB_STATUS_NOT_ENOUGH_SPACE;
+
+            continue;
+        }
+
+        _kvdb_v_init_entry( &entry[kv_count + added], hash, 0, tag );
+
+        added++;
     }
 
-    kv_count++;
+    if( added > 0 ){
 
-    // now we need to sort
+        kv_count += added;
 
-    // bubble sort
-    _kvdb_v_sort();
+        _kvdb_v_sort();
 
+        cached_index = -1;
+    }
 
-    return KVDB_STATUS_OK;
+    return status;
 }
 
 int8_t kvdb_i8_set( catbus_hash_t32 hash, int32_t data ){
@@ -413,13 +551,12 @@ int8_t kvdb_i8_delete( catbus_hash_t32 hash ){
     if( index >= 0 ){
 
         db_entry32_t *entry = (db_entry32_t *)mem2_vp_get_ptr( handle );
-        entry[index].hash = 0;
 
         kv_count--;
 
-        // need to resort
-
-        _kvdb_v_sort();
+        // close the gap, keeping the order
+        memmove( &entry[index], &entry[index + 1], ( kv_count - index ) * sizeof(db_entry32_t) );
+        entry[kv_count].hash = 0;
 
         // reset cache
         cached_index = -1;
@@ -439,24 +576,33 @@ void kvdb_v_delete_tag( uint8_t tag ){
 
     db_entry32_t *entry = (db_entry32_t *)mem2_vp_get_ptr( handle );
 
-    for( uint16_t i = 0; i < db_size; i++ ){
+    // compact the remaining entries, keeping the order
+    uint16_t count = 0;
+
+    for( uint16_t i = 0; i < kv_count; i++ ){
 
-        if( entry[i].hash == 0 ){
+        if( entry[i].tag == tag ){
 
             continue;
         }
 
-        if( entry[i].tag == tag ){
+        if( count != i ){
 
-            entry[i].hash = 0;       
-            kv_count--;
+            entry[count] = entry[i];
         }
+
+        count++;
     }
 
+    for( uint16_t i = count; i < kv_count; i++ ){
+
+        entry[i].hash = 0;
+    }
+
+    kv_count = count;
+
     // reset cache
     cached_index = -1;
-
-    _kvdb_v_sort();
 }
 
 int8_t kvdb_i8_publish( catbus_hash_t32 hash ){
@@ -34,6 +34,7 @@ void kvdb_v_init( void );
 uint16_t kvdb_u16_count( void );
 uint16_t kvdb_u16_db_size( void );
 int8_t kvdb_i8_add( catbus_hash_t32 hash, int32_t data, uint8_t tag, char name[CATBUS_STRING_LEN] );
+int8_t kvdb_i8_add_batch( const catbus_hash_t32 *hashes, uint16_t count, uint8_t tag );
 int8_t kvdb_i8_set( catbus_hash_t32 hash, int32_t data );
 int8_t kvdb_i8_get( catbus_hash_t32 hash, int32_t *data );
 int8_t kvdb_i8_get_meta( catbus_hash_t32 hash, catbus_meta_t *meta );
@@ -47,6 +47,7 @@ Memory overhead is 6 bytes per handle used
 #include "threading.h"
 #include "system.h"
 #include "keyvalue.h"
+#include "timers.h"
 
 #include "fs.h"
 #include "memory.h"
@@ -76,6 +77,30 @@ static void *handles[MAX_MEM_HANDLES];
 
 static void *free_space_ptr;
 
+// incremental defragmenter state.
+// all blocks below defrag_ptr are clean, so each step can resume its search
+// for the first hole from there instead of walking the entire heap.
+static void *defrag_ptr;
+static bool defrag_active;
+
+#ifdef ENABLE_MEM_POOLS
+typedef struct{
+    uint16_t size;  // data size of each slot
+    uint8_t slots;
+    uint8_t used;
+    void *start;
+    void *end;
+    void *free;     // free list, next pointer is stored in the slot data
+} mem_pool_t;
+
+static mem_pool_t pools[] = {
+    { MEM_POOL_0_SIZE, MEM_POOL_0_SLOTS },
+    { MEM_POOL_1_SIZE, MEM_POOL_1_SLOTS },
+};
+
+static uint32_t mem_pool_fallbacks;
+#endif
+
 static mem_rt_data_t mem_rt_data;
 static uint16_t stack_usage;
 
@@ -86,6 +111,22 @@ static uint32_t mem_alloc_fails;
     extern uint8_t __stack, __heap_start, _end;
 #endif
 
+#ifdef ENABLE_MEM_POOLS
+// returns the pool index a block belongs to, or -1 if it is on the heap
+static int8_t get_pool( void *header ){
+
+    for( uint8_t i = 0; i < cnt_of_array(pools); i++ ){
+
+        if( ( header >= pools[i].start ) && ( header < pools[i].end ) ){
+
+            return i;
+        }
+    }
+
+    return -1;
+}
+#endif
+
 
 static uint16_t mem_info_vfile_handler( vfile_op_t8 op, uint32_t pos, void *ptr, uint16_t len ){
 
@@ -111,6 +152,10 @@ static uint16_t mem_info_vfile_handler( vfile_op_t8 op, uint32_t pos, void *ptr,
 
                     info.size = header.size;
                     info.type = header.type;
+
+                    #ifdef ENABLE_MEM_POOLS
+                    info.pool = get_pool( handles[page] ) + 1;
+                    #endif
                 }
 
                 // get offset info page
@@ -194,8 +239,12 @@ KV_SECTION_META kv_meta_t mem_info_kv[] = {
     { SAPPHIRE_TYPE_UINT16,  0, KV_FLAGS_READ_ONLY,  &mem_rt_data.peak_usage,    0,  "mem_peak_usage" },
     { SAPPHIRE_TYPE_UINT16,  0, KV_FLAGS_READ_ONLY,  &mem_rt_data.used_space,    0,  "mem_used" },
     { SAPPHIRE_TYPE_UINT16,  0, KV_FLAGS_READ_ONLY,  &mem_rt_data.dirty_space,   0,  "mem_dirty" },
+    { SAPPHIRE_TYPE_UINT16,  0, KV_FLAGS_READ_ONLY,  &mem_rt_data.defrag_max_pause, 0, "mem_defrag_max_pause" },
     { SAPPHIRE_TYPE_UINT32,  0, KV_FLAGS_READ_ONLY,  &mem_allocs,                0,  "mem_allocs" },
     { SAPPHIRE_TYPE_UINT32,  0, KV_FLAGS_READ_ONLY,  &mem_alloc_fails,           0,  "mem_alloc_fails" },
+    #ifdef ENABLE_MEM_POOLS
+    { SAPPHIRE_TYPE_UINT32,  0, KV_FLAGS_READ_ONLY,  &mem_pool_fallbacks,        0,  "mem_pool_fallbacks" },
+    #endif
 };
 
 
@@ -295,13 +344,43 @@ void mem2_v_init( void ){
     heap = (uint8_t *)heap_start;
     #endif
 
+    #ifdef ENABLE_MEM_POOLS
+    // carve the pools from the bottom of the heap region and thread each
+    // pool's slots onto its free list
+    for( uint8_t i = 0; i < cnt_of_array(pools); i++ ){
+
+        mem_pool_t *pool = &pools[i];
+        uint16_t slot_size = sizeof(mem_block_header_t) + pool->size + 1;
+
+        pool->start = heap;
+        pool->used = 0;
+        pool->free = 0;
+
+        for( uint8_t j = 0; j < pool->slots; j++ ){
+
+            uint8_t *slot = heap + ( (uint16_t)( pool->slots - 1 - j ) * slot_size );
+
+            memcpy( slot + sizeof(mem_block_header_t), &pool->free, sizeof(pool->free) );
+            pool->free = slot;
+        }
+
+        heap += (uint16_t)pool->slots * slot_size;
+        heap_size -= (uint16_t)pool->slots * slot_size;
+
+        pool->end = heap;
+    }
+    #endif
+
     mem_rt_data.heap_size = heap_size;
     mem_rt_data.free_space = heap_size;
 	free_space_ptr = heap;
+    defrag_ptr = heap;
+    defrag_active = FALSE;
 
 	mem_rt_data.used_space = 0;
 	mem_rt_data.data_space = 0;
 	mem_rt_data.dirty_space = 0;
+    mem_rt_data.defrag_max_pause = 0;
 
 	for( uint16_t i = 0; i < MAX_MEM_HANDLES; i++ ){
 
@@ -391,6 +470,87 @@ end:
     return status;
 }
 
+// find an unused handle.
+// returns -1 if all handles are in use.
+static mem_handle_t get_free_handle( void ){
+
+    for( mem_handle_t handle = 0; handle < MAX_MEM_HANDLES; handle++ ){
+
+        if( handles[handle] == 0 ){
+
+            mem_rt_data.handles_used++;
+
+            return handle;
+        }
+    }
+
+    return -1;
+}
+
+#ifdef ENABLE_MEM_POOLS
+// attempt to allocate from the smallest pool with a free slot that fits.
+// returns -1 if no pool can take the allocation.
+static mem_handle_t pool_alloc( uint16_t size, mem_type_t8 type ){
+
+    MEM_ATOMIC;
+
+    mem_handle_t handle = -1;
+    mem_pool_t *pool = 0;
+
+    for( uint8_t i = 0; i < cnt_of_array(pools); i++ ){
+
+        if( ( size <= pools[i].size ) && ( pools[i].free != 0 ) ){
+
+            pool = &pools[i];
+
+            break;
+        }
+    }
+
+    if( pool == 0 ){
+
+        goto finish;
+    }
+
+    handle = get_free_handle();
+
+    if( handle < 0 ){
+
+        goto finish;
+    }
+
+    // pop slot from free list
+    mem_block_header_t *header = pool->free;
+    memcpy( &pool->free, (void *)header + sizeof(mem_block_header_t), sizeof(pool->free) );
+    pool->used++;
+
+    handles[handle] = header;
+
+    header->size = size;
+    header->handle = handle;
+    header->type = type;
+
+    #ifdef ENABLE_RECORD_CREATOR
+    header->creator_address = (uint16_t)thread_p_get_function( thread_t_get_current_thread() ) << 1;
+    #endif
+
+    mem_rt_data.data_space += size;
+
+    uint8_t *canary = CANARY_PTR( header );
+
+    *canary = generate_canary( header );
+
+    handle = swizzle(handle);
+
+    mem_allocs++;
+
+finish:
+    MEM_END_ATOMIC;
+
+    return handle;
+}
+#endif
+
 static mem_handle_t alloc( uint16_t size, mem_type_t8 type ){
 
     MEM_ATOMIC;
@@ -405,21 +565,10 @@ static mem_handle_t alloc( uint16_t size, mem_type_t8 type ){
     }
 
     // get a handle
-    for( handle = 0; handle < MAX_MEM_HANDLES; handle++ ){
-
-        if( handles[handle] == 0 ){
-
-            mem_rt_data.handles_used++;
-
-            break;
-        }
-    }
+    handle = get_free_handle();
 
     // if a handle was not found
-    if( handle >= MAX_MEM_HANDLES ){
-
-        // reset handle to unallocated
-        handle = -1;
+    if( handle < 0 ){
 
         // handle allocation failed
         goto finish;
@@ -495,8 +644,27 @@ mem_handle_t mem2_h_alloc( uint16_t size ){
 
 // attempt to allocate a memory block of a specified size
 // returns -1 if the allocation failed.
+// typed allocations are served from the slab pools when a size class fits,
+// and fall back to the heap otherwise.
 mem_handle_t mem2_h_alloc2( uint16_t size, mem_type_t8 type ){
 
+    #ifdef ENABLE_MEM_POOLS
+    if( type != MEM_TYPE_UNKNOWN ){
+
+        mem_handle_t handle = pool_alloc( size, type );
+
+        if( handle >= 0 ){
+
+            return handle;
+        }
+
+        if( size <= pools[cnt_of_array(pools) - 1].size ){
+
+            mem_pool_fallbacks++;
+        }
+    }
+    #endif
+
     return alloc( size, type );
 }
 
@@ -548,10 +716,17 @@ int8_t mem2_i8_realloc( mem_handle_t handle, uint16_t size ){
     new_handle = unswizzle( new_handle );
     mem_block_header_t *new_header = handles[new_handle];
 
-    // move data to new handle
+    // move data to new handle, truncating if the block shrank
+    uint16_t copy_len = header->size;
+
+    if( copy_len > size ){
+
+        copy_len = size;
+    }
+
     void *old_ptr = handles[handle] + sizeof( mem_block_header_t );;
     void *new_ptr = handles[new_handle] + sizeof( mem_block_header_t );;
-    memcpy( new_ptr, old_ptr, header->size );
+    memcpy( new_ptr, old_ptr, copy_len );
 
     // release old handle
     release_block( handle );
@@ -639,12 +814,34 @@ static void release_block( mem_handle_t handle ){
 	// decrement data space used
 	mem_rt_data.data_space -= header->size;
 
+    #ifdef ENABLE_MEM_POOLS
+    int8_t pool_index = get_pool( header );
+
+    if( pool_index >= 0 ){
+
+        // push slot back on to the pool's free list
+        mem_pool_t *pool = &pools[pool_index];
+
+        memcpy( (void *)header + sizeof(mem_block_header_t), &pool->free, sizeof(pool->free) );
+        pool->free = header;
+        pool->used--;
+
+        return;
+    }
+    #endif
+
 	// set the flags to dirty so the defragmenter can pick it up
 	set_dirty( header );
 
 	// increment dirty space counter and decrement used space counter
 	mem_rt_data.dirty_space += MEM_BLOCK_SIZE( header );
 	mem_rt_data.used_space -= MEM_BLOCK_SIZE( header );
+
+    // move the defragmenter search start back if this block is below it
+    if( (void *)header < defrag_ptr ){
+
+        defrag_ptr = header;
+    }
 }
 
 #ifdef ENABLE_EXTENDED_VERIFY
@@ -833,110 +1030,117 @@ YOU HAVE BEEN WARNED!
 */
 void mem2_v_collect_garbage( void ){
 
-    if( mem2_u16_get_dirty() < MEM_DEFRAG_THRESHOLD ){
+    // compaction starts once the dirty threshold is reached, and then
+    // continues on each scheduler pass until all dirty space is reclaimed.
+    if( !defrag_active ){
 
-        return;
+        if( mem2_u16_get_dirty() < MEM_DEFRAG_THRESHOLD ){
+
+            return;
+        }
+
+        defrag_active = TRUE;
     }
 
     MEM_ATOMIC;
 
+    uint32_t start_time = tmr_u32_get_system_time_us();
+
     EVENT( EVENT_ID_MEM_DEFRAG, 0 );
 
+    mem_block_header_t *dirty = defrag_ptr;
     mem_block_header_t *clean;
-    mem_block_header_t *next_block;
-    mem_block_header_t *dirty;
-
-    clean = ( mem_block_header_t * )heap;
-    next_block = ( mem_block_header_t * )heap;
-    dirty = ( mem_block_header_t * )heap;
+    uint16_t moved = 0;
 
     // search for a dirty block (loop while clean blocks)
-    while( ( is_dirty( dirty ) == FALSE ) &&
-            ( dirty < ( mem_block_header_t * )free_space_ptr ) ){
+    while( ( dirty < ( mem_block_header_t * )free_space_ptr ) &&
+           ( is_dirty( dirty ) == FALSE ) ){
 
         dirty = ( void * )dirty + MEM_BLOCK_SIZE( dirty );
     }
 
-    // clean pointer needs to lead dirty pointer
-    if( clean < dirty ){
-
-        clean = dirty;
-    }
+    clean = dirty;
 
+    // slide clean blocks down into the hole, absorbing any dirty blocks
+    // along the way, until the step budget is used up.
     while( clean < ( mem_block_header_t * )free_space_ptr ){
 
-        // search for a clean block (loop while dirty)
-        // (couldn't find anymore clean blocks to move, so there should be
-        // no clean blocks between the dirty pointer and the free pointer)
-        while( is_dirty( clean ) == TRUE ){
+        uint16_t block_size = MEM_BLOCK_SIZE( clean );
 
-            clean = ( void * )clean + MEM_BLOCK_SIZE( clean );
+        if( is_dirty( clean ) ){
 
-            // if the free space is reached, the routine is finished
-            if( clean >= ( mem_block_header_t * )free_space_ptr ){
+            clean = ( void * )clean + block_size;
 
-                goto done_defrag;
-            }
+            continue;
         }
 
-        // get next block
-        next_block = ( void * )clean + MEM_BLOCK_SIZE( clean );
+        if( moved >= MEM_DEFRAG_STEP_SIZE ){
+
+            break;
+        }
 
         // switch the handle from the old block to the new block
         handles[clean->handle] = dirty;
-        // NOTE:
-        // Could do this instead, and save the need to store the handle index
-        // in the block, saving 2 bytes per object.
-        /*
-        for( uint16_t i = 0; i < MAX_MEM_HANDLES; i++ ){
 
-            if( handles[i] == clean ){
+        // blocks may overlap when the hole is smaller than the block
+        memmove( dirty, clean, block_size );
 
-                handles[i] = dirty;
-                break;
-            }
-        }
-        */
+        dirty = ( void * )dirty + block_size;
+        clean = ( void * )clean + block_size;
+        moved += block_size;
+    }
 
-        // copy the clean block to the dirty block pointer
-        memcpy( dirty, clean, MEM_BLOCK_SIZE( clean ) );
+    if( clean >= ( mem_block_header_t * )free_space_ptr ){
 
-        // increment dirty pointer
-        dirty = ( void * )dirty + MEM_BLOCK_SIZE( dirty );
+        // there are no clean blocks between the dirty and free pointers,
+        // set the free pointer to the dirty pointer
+        free_space_ptr = dirty;
 
-        // assign clean pointer to next block
-        clean = next_block;
-    }
+        // the dirty space is now free
+        mem_rt_data.free_space += mem_rt_data.dirty_space;
+
+        // no more dirty space
+        mem_rt_data.dirty_space = 0;
 
-done_defrag:
-    // EVENT( EVENT_ID_MEM_DEFRAG, 1 );
+        defrag_active = FALSE;
 
-    // there should be no clean blocks between the dirty and free pointers,
-    // set the free pointer to the dirty pointer
-    free_space_ptr = dirty;
+        // run canary check
+        mem2_v_check_canaries();
 
-    // the dirty space is now free
-    mem_rt_data.free_space += mem_rt_data.dirty_space;
+        // check stack guard
+        #ifndef __SIM__
+        uint8_t *stack = &__stack - ( MEM_MAX_STACK - MEM_STACK_GUARD_SIZE );
+        ASSERT( *stack++ == CANARY_VALUE );
+        ASSERT( *stack++ == CANARY_VALUE );
+        ASSERT( *stack++ == CANARY_VALUE );
+        ASSERT( *stack++ == CANARY_VALUE );
 
-    // no more dirty space
-    mem_rt_data.dirty_space = 0;
+        // assert if the stack is blown up
+        // ASSERT( stack_usage < MEM_MAX_STACK );
+        #endif
+    }
+    else{
 
-    // run canary check
-    mem2_v_check_canaries();
+        // mark the remaining hole as a single dirty block so the heap stays
+        // walkable.  a hole is always at least one full block, so there is
+        // room for the header and canary.
+        dirty->size = ( ( ( void * )clean - ( void * )dirty ) -
+                        ( sizeof(mem_block_header_t) + 1 ) ) | MEM_SIZE_DIRTY_MASK;
+    }
 
-    // EVENT( EVENT_ID_MEM_DEFRAG, 2 );
+    defrag_ptr = dirty;
 
-    // check stack guard
-    #ifndef __SIM__
-    uint8_t *stack = &__stack - ( MEM_MAX_STACK - MEM_STACK_GUARD_SIZE );
-    ASSERT( *stack++ == CANARY_VALUE );
-    ASSERT( *stack++ == CANARY_VALUE );
-    ASSERT( *stack++ == CANARY_VALUE );
-    ASSERT( *stack++ == CANARY_VALUE );
+    uint32_t elapsed = tmr_u32_elapsed_time_us( start_time );
 
-    // assert if the stack is blown up
-    // ASSERT( stack_usage < MEM_MAX_STACK );
-    #endif
+    if( elapsed > 65535 ){
+
+        elapsed = 65535;
+    }
+
+    if( elapsed > mem_rt_data.defrag_max_pause ){
+
+        mem_rt_data.defrag_max_pause = elapsed;
+    }
 
     EVENT( EVENT_ID_MEM_DEFRAG, 3 );
 
@@ -38,6 +38,29 @@
 // defragmenter will only run after the amount of dirty space exceeds this threshold
 #define MEM_DEFRAG_THRESHOLD    128
 
+// maximum number of bytes the defragmenter will move in a single scheduler pass.
+// once started, compaction continues on each pass until all dirty space is
+// reclaimed.  this bounds the time the scheduler spends with interrupts off.
+#define MEM_DEFRAG_STEP_SIZE    256
+
+// slab pools for small typed allocations.
+// mem2_h_alloc2 places blocks that fit a size class into that class's pool
+// instead of the compacting heap.  pool slots are carved from the bottom of
+// the heap region at init, are never moved by the defragmenter, and are
+// allocated and freed in constant time.
+// size classes must be in ascending order.
+#define ENABLE_MEM_POOLS
+
+#ifndef MEM_POOL_0_SIZE
+    #define MEM_POOL_0_SIZE     24
+    #define MEM_POOL_0_SLOTS    12
+#endif
+
+#ifndef MEM_POOL_1_SIZE
+    #define MEM_POOL_1_SIZE     48
+    #define MEM_POOL_1_SLOTS    6
+#endif
+
 // uncomment to make memory functions atomic
 #define ENABLE_ATOMIC_MEMORY
 
@@ -72,11 +95,13 @@ typedef struct{
 	uint16_t dirty_space;
 	uint16_t data_space;
 	uint16_t peak_usage;
+    uint16_t defrag_max_pause; // microseconds
 } mem_rt_data_t;
 
 typedef struct{
     uint16_t size;
     mem_type_t8 type;
+    uint8_t pool; // 0 if on the heap, otherwise pool index + 1
 } mem_info_t;
 
 void mem2_v_init( void );
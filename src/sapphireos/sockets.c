@@ -57,6 +57,13 @@ typedef struct{
 	sock_options_t8 options;    // socket options
 } sock_state_raw_t;
 
+// queued datagram
+typedef struct{
+    mem_handle_t handle;        // received data handle
+    uint8_t header_len;         // length of non-data headers in data handle
+    sock_addr_t raddr;          // sender address
+} sock_rx_entry_t;
+
 // datagram structure
 typedef struct{
     sock_state_raw_t raw;
@@ -69,6 +76,14 @@ typedef struct{
         uint8_t setting;
         uint8_t current;
     } timer;                    // receive timeout state
+    struct{
+        mem_handle_t handle;    // ring of sock_rx_entry_t, -1 if depth is 1
+        uint8_t depth;          // datagrams held, including the current one
+        uint8_t head;           // oldest queued entry
+        uint8_t count;          // entries in the ring
+        uint8_t high_water;
+        uint16_t drops;
+    } rx;                       // receive queue state
 } sock_state_dgram_t;
 
 #ifdef ENABLE_UDPX
@@ -90,14 +105,220 @@ typedef struct{
 
 static list_t sockets;
 
+// open addressed port to socket table, for receive demux.
+// a port of 0 marks an empty slot.
+typedef struct{
+    uint16_t port;
+    socket_t sock;
+} sock_port_entry_t;
+
+static sock_port_entry_t port_table[SOCK_PORT_TABLE_SIZE];
+
+// sockets that did not fit in the port table.
+// while this is non-zero, a table miss falls back to the socket list.
+static uint8_t port_table_overflow;
+
+// ephemeral ports are allocated from a bitmap covering a window of
+// the ephemeral range.  the window starts at a random port.
+static uint8_t ephemeral_map[SOCK_EPHEMERAL_MAP_PORTS / 8];
+static uint16_t ephemeral_base;
 static uint16_t current_ephemeral_port;
 
+static uint32_t sock_rx_dropped;
+
+KV_SECTION_META kv_meta_t sock_info_kv[] = {
+    { SAPPHIRE_TYPE_UINT32,        0, KV_FLAGS_READ_ONLY,  &sock_rx_dropped,    0,   "sock_rx_dropped" },
+};
+
 
 PT_THREAD( timeout_thread( pt_t *pt, void *state ) );
 
 
-bool sock_b_port_in_use( uint16_t port ){
+// the receive queue holds datagrams that arrive while the application
+// still has the current one.  only data handles are queued, the data
+// itself is not copied.
+
+static bool rx_queue_full( sock_state_dgram_t *dgram ){
+
+    return ( dgram->rx.count + 1 ) >= dgram->rx.depth;
+}
+
+static bool rx_enqueue( sock_state_dgram_t *dgram, netmsg_state_t *state, uint8_t header_len ){
+
+    if( ( dgram->rx.handle < 0 ) || rx_queue_full( dgram ) ){
+
+        return FALSE;
+    }
+
+    sock_rx_entry_t *ring = mem2_vp_get_ptr( dgram->rx.handle );
+    uint8_t index = ( dgram->rx.head + dgram->rx.count ) % ( dgram->rx.depth - 1 );
+
+    ring[index].handle      = state->data_handle;
+    ring[index].header_len  = header_len;
+    ring[index].raddr       = state->raddr;
+
+    // remove handle from netmsg
+    state->data_handle = -1;
+
+    dgram->rx.count++;
+
+    return TRUE;
+}
+
+// release the current datagram and replace it with the oldest queued one.
+// returns TRUE if there is a new current datagram.
+static bool rx_advance( sock_state_dgram_t *dgram ){
+
+    if( dgram->handle >= 0 ){
+
+        // free the receive buffer
+        mem2_v_free( dgram->handle );
+
+        // mark handle as empty
+        dgram->handle = -1;
+    }
 
+    if( dgram->rx.count == 0 ){
+
+        return FALSE;
+    }
+
+    sock_rx_entry_t *ring = mem2_vp_get_ptr( dgram->rx.handle );
+    sock_rx_entry_t *entry = &ring[dgram->rx.head];
+
+    dgram->handle       = entry->handle;
+    dgram->header_len   = entry->header_len;
+    dgram->raddr        = entry->raddr;
+
+    dgram->rx.head = ( dgram->rx.head + 1 ) % ( dgram->rx.depth - 1 );
+    dgram->rx.count--;
+
+    return TRUE;
+}
+
+static void rx_update_high_water( sock_state_dgram_t *dgram ){
+
+    uint8_t held = dgram->rx.count;
+
+    if( dgram->handle >= 0 ){
+
+        held++;
+    }
+
+    if( held > dgram->rx.high_water ){
+
+        dgram->rx.high_water = held;
+    }
+}
+
+
+static uint8_t port_hash( uint16_t port ){
+
+    return ( port ^ ( port >> 8 ) ) & ( SOCK_PORT_TABLE_SIZE - 1 );
+}
+
+static void port_table_v_insert( uint16_t port, socket_t sock ){
+
+    uint8_t index = port_hash( port );
+
+    for( uint8_t i = 0; i < SOCK_PORT_TABLE_SIZE; i++ ){
+
+        if( port_table[index].port == 0 ){
+
+            port_table[index].port = port;
+            port_table[index].sock = sock;
+
+            return;
+        }
+
+        index = ( index + 1 ) & ( SOCK_PORT_TABLE_SIZE - 1 );
+    }
+
+    // table is full
+    port_table_overflow++;
+}
+
+static void port_table_v_remove( uint16_t port ){
+
+    uint8_t index = port_hash( port );
+
+    for( uint8_t i = 0; i < SOCK_PORT_TABLE_SIZE; i++ ){
+
+        if( port_table[index].port == 0 ){
+
+            break;
+        }
+
+        if( port_table[index].port == port ){
+
+            // shift following entries back so probe chains stay intact
+            uint8_t next = index;
+
+            for( uint8_t j = 1; j < SOCK_PORT_TABLE_SIZE; j++ ){
+
+                next = ( next + 1 ) & ( SOCK_PORT_TABLE_SIZE - 1 );
+
+                if( port_table[next].port == 0 ){
+
+                    break;
+                }
+
+                uint8_t home = port_hash( port_table[next].port );
+
+                // leave the entry if its home slot is cyclically
+                // in ( index, next ]
+                if( ( ( next - home ) & ( SOCK_PORT_TABLE_SIZE - 1 ) ) <
+                    ( ( next - index ) & ( SOCK_PORT_TABLE_SIZE - 1 ) ) ){
+
+                    continue;
+                }
+
+                port_table[index] = port_table[next];
+                index = next;
+            }
+
+            port_table[index].port = 0;
+
+            return;
+        }
+
+        index = ( index + 1 ) & ( SOCK_PORT_TABLE_SIZE - 1 );
+    }
+
+    // socket was never in the table
+    if( port_table_overflow > 0 ){
+
+        port_table_overflow--;
+    }
+}
+
+// find the datagram socket bound to a port.
+// returns -1 if there isn't one.
+static socket_t port_table_s_lookup( uint16_t port ){
+
+    uint8_t index = port_hash( port );
+
+    for( uint8_t i = 0; i < SOCK_PORT_TABLE_SIZE; i++ ){
+
+        if( port_table[index].port == 0 ){
+
+            break;
+        }
+
+        if( port_table[index].port == port ){
+
+            return port_table[index].sock;
+        }
+
+        index = ( index + 1 ) & ( SOCK_PORT_TABLE_SIZE - 1 );
+    }
+
+    if( port_table_overflow == 0 ){
+
+        return -1;
+    }
+
+    // some sockets are not in the table, search the list
     socket_t sock = sockets.head;
 
     while( sock >= 0 ){
@@ -111,43 +332,50 @@ bool sock_b_port_in_use( uint16_t port ){
             // check port
             if( dgram_state->lport == port ){
 
-                return TRUE;
+                return sock;
             }
         }
 
         sock = list_ln_next( sock );
     }
 
-    return FALSE;
+    return -1;
 }
 
-bool sock_b_port_busy( uint16_t port ){
+// mark a port free in the ephemeral bitmap, if it is in the window
+static void ephemeral_v_release( uint16_t port ){
 
-    socket_t sock = sockets.head;
+    uint16_t bit = port - ephemeral_base;
 
-    while( sock >= 0 ){
+    if( ( port < ephemeral_base ) || ( bit >= SOCK_EPHEMERAL_MAP_PORTS ) ){
 
-        sock_state_raw_t *raw_state = list_vp_get_data( sock );
+        return;
+    }
 
-        if( SOCK_IS_DGRAM( raw_state->type ) ){
+    ephemeral_map[bit / 8] &= ~( 1 << ( bit % 8 ) );
+}
 
-            sock_state_dgram_t *dgram_state = (sock_state_dgram_t *)raw_state;
+bool sock_b_port_in_use( uint16_t port ){
 
-            // check port
-            if( dgram_state->lport != port ){
+    return port_table_s_lookup( port ) >= 0;
+}
 
-                goto next;
-            }
+bool sock_b_port_busy( uint16_t port ){
 
-            // check state
-            if( dgram_state->state == SOCK_UDP_STATE_RX_DATA_PENDING ){
+    socket_t sock = port_table_s_lookup( port );
 
-                return TRUE;
-            }
-        }
+    if( sock < 0 ){
 
-next:
-        sock = list_ln_next( sock );
+        return FALSE;
+    }
+
+    sock_state_dgram_t *dgram_state = list_vp_get_data( sock );
+
+    // check state
+    if( ( dgram_state->state == SOCK_UDP_STATE_RX_DATA_PENDING ) &&
+        ( rx_queue_full( dgram_state ) ) ){
+
+        return TRUE;
     }
 
     return FALSE;
@@ -157,23 +385,66 @@ next:
 // guaranteed to not be in use by any other port.
 static uint16_t get_lport( void ){
 
-	do{
+    // search the bitmap for a free port, starting after the last one
+    // handed out so recently released ports are not reused right away.
+    uint16_t bit = current_ephemeral_port - ephemeral_base;
+
+    for( uint16_t i = 0; i < SOCK_EPHEMERAL_MAP_PORTS; i++ ){
+
+        bit++;
+
+        if( bit >= SOCK_EPHEMERAL_MAP_PORTS ){
+
+            bit = 0;
+        }
+
+        // skip full bytes
+        if( ( ( bit % 8 ) == 0 ) && ( ephemeral_map[bit / 8] == 0xff ) ){
+
+            bit += 7;
+            i += 7;
 
-		current_ephemeral_port++;
+            continue;
+        }
+
+        if( ephemeral_map[bit / 8] & ( 1 << ( bit % 8 ) ) ){
 
-		if( current_ephemeral_port < SOCK_EPHEMERAL_PORT_LOW ){
+            continue;
+        }
 
-			current_ephemeral_port = SOCK_EPHEMERAL_PORT_LOW;
-		}
-		else if( current_ephemeral_port == SOCK_EPHEMERAL_PORT_HIGH ){
+        uint16_t port = ephemeral_base + bit;
+
+        // a socket may have been explicitly bound here
+        if( sock_b_port_in_use( port ) ){
+
+            continue;
+        }
+
+        ephemeral_map[bit / 8] |= ( 1 << ( bit % 8 ) );
+
+        current_ephemeral_port = port;
+
+        return port;
+    }
+
+    // bitmap is full, probe the rest of the ephemeral range
+    uint16_t port = ephemeral_base + SOCK_EPHEMERAL_MAP_PORTS - 1;
+
+    do{
+
+        port++;
+
+        if( ( port < SOCK_EPHEMERAL_PORT_LOW ) ||
+            ( port == SOCK_EPHEMERAL_PORT_HIGH ) ){
 
             // wraparound to low range
-			current_ephemeral_port = SOCK_EPHEMERAL_PORT_LOW;
-		}
+            port = SOCK_EPHEMERAL_PORT_LOW;
+        }
 
-	} while( sock_b_port_in_use( current_ephemeral_port ) );
+    } while( ( ( port >= ephemeral_base ) && ( port < ( ephemeral_base + SOCK_EPHEMERAL_MAP_PORTS ) ) ) ||
+             ( sock_b_port_in_use( port ) ) );
 
-	return current_ephemeral_port;
+    return port;
 }
 
 
@@ -235,6 +506,15 @@ socket_t sock_s_create( sock_type_t8 type ){
         dgram->timer.current    = 0;
         dgram->header_len       = 0;
 
+        dgram->rx.handle        = -1;
+        dgram->rx.depth         = 1;
+        dgram->rx.head          = 0;
+        dgram->rx.count         = 0;
+        dgram->rx.high_water    = 0;
+        dgram->rx.drops         = 0;
+
+        port_table_v_insert( dgram->lport, ln );
+
         netmsg_v_open_close_port( IP_PROTO_UDP, dgram->lport, TRUE );
     }
 
@@ -275,12 +555,17 @@ void sock_v_release( socket_t sock ){
 
         sock_state_dgram_t *dgram = (sock_state_dgram_t *)s;
 
-        // check if there is data in the socket's buffer
-        if( dgram->handle >= 0 ){
+        // release current and queued data
+        while( rx_advance( dgram ) );
+
+        if( dgram->rx.handle >= 0 ){
 
-            mem2_v_free( dgram->handle );
+            mem2_v_free( dgram->rx.handle );
         }
 
+        port_table_v_remove( dgram->lport );
+        ephemeral_v_release( dgram->lport );
+
         netmsg_v_open_close_port( IP_PROTO_UDP, dgram->lport, FALSE );
     }
 
@@ -312,9 +597,14 @@ void sock_v_bind( socket_t sock, uint16_t port ){
 
         netmsg_v_open_close_port( IP_PROTO_UDP, dgram->lport, FALSE );
 
+        port_table_v_remove( dgram->lport );
+        ephemeral_v_release( dgram->lport );
+
         // set port
         dgram->lport = port;
 
+        port_table_v_insert( dgram->lport, sock );
+
         netmsg_v_open_close_port( IP_PROTO_UDP, dgram->lport, TRUE );
 	}
     else{
@@ -331,6 +621,107 @@ void sock_v_set_options( socket_t sock, sock_options_t8 options ){
     s->options = options;
 }
 
+// set how many datagrams the socket can hold, including the one
+// currently being processed by the application.
+// the default is 1, which drops anything that arrives while the
+// application has not yet received the current datagram.
+// returns -1 if the queue could not be allocated.
+int8_t sock_i8_set_rx_depth( socket_t sock, uint8_t depth ){
+
+    sock_state_raw_t *s = list_vp_get_data( sock );
+
+    if( !SOCK_IS_DGRAM( s->type ) ){
+
+        // invalid socket type
+        ASSERT( FALSE );
+
+        return -1;
+    }
+
+    if( depth < 1 ){
+
+        depth = 1;
+    }
+    else if( depth > SOCK_RX_QUEUE_MAX_DEPTH ){
+
+        depth = SOCK_RX_QUEUE_MAX_DEPTH;
+    }
+
+    mem_handle_t h = -1;
+
+    if( depth > 1 ){
+
+        h = mem2_h_alloc2( ( depth - 1 ) * sizeof(sock_rx_entry_t), MEM_TYPE_SOCKET );
+
+        if( h < 0 ){
+
+            return -1;
+        }
+    }
+
+    // allocation may have moved the socket state
+    sock_state_dgram_t *dgram = list_vp_get_data( sock );
+
+    // move queued entries over, oldest first.
+    // anything that doesn't fit is dropped.
+    uint8_t count = 0;
+
+    while( dgram->rx.count > 0 ){
+
+        sock_rx_entry_t *ring = mem2_vp_get_ptr( dgram->rx.handle );
+        sock_rx_entry_t entry = ring[dgram->rx.head];
+
+        dgram->rx.head = ( dgram->rx.head + 1 ) % ( dgram->rx.depth - 1 );
+        dgram->rx.count--;
+
+        if( count < ( depth - 1 ) ){
+
+            sock_rx_entry_t *new_ring = mem2_vp_get_ptr( h );
+            new_ring[count] = entry;
+            count++;
+        }
+        else{
+
+            mem2_v_free( entry.handle );
+            dgram->rx.drops++;
+            sock_rx_dropped++;
+        }
+    }
+
+    if( dgram->rx.handle >= 0 ){
+
+        mem2_v_free( dgram->rx.handle );
+    }
+
+    dgram->rx.handle    = h;
+    dgram->rx.depth     = depth;
+    dgram->rx.head      = 0;
+    dgram->rx.count     = count;
+
+    return 0;
+}
+
+void sock_v_get_rx_stats( socket_t sock, sock_rx_stats_t *stats ){
+
+    sock_state_raw_t *s = list_vp_get_data( sock );
+
+    if( SOCK_IS_DGRAM( s->type ) ){
+
+        // get more specific pointer
+        sock_state_dgram_t *dgram = (sock_state_dgram_t *)s;
+
+        stats->drops        = dgram->rx.drops;
+        stats->high_water   = dgram->rx.high_water;
+        stats->queued       = dgram->rx.count;
+        stats->depth        = dgram->rx.depth;
+    }
+    else{
+
+        // invalid socket type
+        ASSERT( FALSE );
+    }
+}
+
 // timeout is in seconds
 void sock_v_set_timeout( socket_t sock, uint8_t timeout ){
 
@@ -467,6 +858,27 @@ void *sock_vp_get_data( socket_t sock ){
     return 0;
 }
 
+// number of datagrams queued behind the current one
+uint8_t sock_u8_rx_queued( socket_t sock ){
+
+    sock_state_raw_t *s = list_vp_get_data( sock );
+
+    if( SOCK_IS_DGRAM( s->type ) ){
+
+        // get more specific pointer
+        sock_state_dgram_t *dgram = (sock_state_dgram_t *)s;
+
+        return dgram->rx.count;
+    }
+    else{
+
+        // invalid socket type
+        ASSERT( FALSE );
+    }
+
+    return 0;
+}
+
 // Get data handle from socket.
 // This will REMOVE the handle from the socket!
 // Releasing it will be the caller's responsibility.
@@ -518,6 +930,9 @@ bool sock_b_busy( socket_t sock ){
 // receive data from a socket.
 // returns -1 if socket is busy waiting for data
 // returns 0 if data is available.
+// if more datagrams are queued, the next call after a datagram has been
+// received moves straight on to the next one and returns 0, so a thread
+// can drain the queue without waiting between datagrams.
 int8_t sock_i8_recvfrom( socket_t sock ){
 
 	sock_state_raw_t *s = list_vp_get_data( sock );
@@ -568,18 +983,15 @@ int8_t sock_i8_recvfrom( socket_t sock ){
         // check if data has been received by the application
         else if( dgram->state == SOCK_UDP_STATE_RX_DATA_RECEIVED ){
 
-            // reset state
-            dgram->state = SOCK_UDP_STATE_IDLE;
-
-            // check if socket has memory attached
-            if( dgram->handle > 0 ){
+            // free the receive buffer and check for queued data
+            if( rx_advance( dgram ) ){
 
-                // free the receive buffer
-                mem2_v_free( dgram->handle );
+                // next datagram is received immediately
+                return 0;
             }
 
-            // mark handle as empty
-            dgram->handle = -1;
+            // reset state
+            dgram->state = SOCK_UDP_STATE_IDLE;
 
             return -1;
         }
@@ -855,23 +1267,7 @@ void sock_v_recv( netmsg_t netmsg ){
     netmsg_state_t *state = netmsg_vp_get_state( netmsg );
 
     // search for a matching socket
-    socket_t sock = sockets.head;
-    sock_state_dgram_t *dgram;
-
-    while( sock >= 0 ){
-
-        // derefence to datagram
-        dgram = list_vp_get_data( sock );
-
-        // check socket type and port number (if datagram)
-        if( ( SOCK_IS_DGRAM( dgram->raw.type ) ) &&
-            ( dgram->lport == state->laddr.port ) ){
-
-            break;
-        }
-
-        sock = list_ln_next( sock );
-    }
+    socket_t sock = port_table_s_lookup( state->laddr.port );
 
     // check if we got a matching socket
     if( sock < 0 ){
@@ -879,6 +1275,8 @@ void sock_v_recv( netmsg_t netmsg ){
         return;
     }
 
+    sock_state_dgram_t *dgram = list_vp_get_data( sock );
+
     // if we got here, we have the appropriate socket
 
     // check if send only
@@ -900,7 +1298,7 @@ void sock_v_recv( netmsg_t netmsg ){
         }
     }
 
-    dgram->header_len = state->header_len;
+    uint8_t header_len = state->header_len;
 
     #ifdef ENABLE_UDPX
     void *data_ptr = mem2_vp_get_ptr( state->data_handle ) + state->header_len;
@@ -933,7 +1331,7 @@ void sock_v_recv( netmsg_t netmsg ){
 
             // set data pointer
             data_ptr += sizeof(udpx_header_t);
-            dgram->header_len += sizeof(udpx_header_t);
+            header_len += sizeof(udpx_header_t);
         }
         else{
 
@@ -972,7 +1370,7 @@ void sock_v_recv( netmsg_t netmsg ){
 
             // set data pointer
             data_ptr += sizeof(udpx_header_t);
-            dgram->header_len += sizeof(udpx_header_t);
+            header_len += sizeof(udpx_header_t);
         }
         else{
 
@@ -982,36 +1380,47 @@ void sock_v_recv( netmsg_t netmsg ){
     }
     #endif
 
-    // check if the socket is already holding data that has not been
-    // received by the owning application.  if so, we'll throw away the
-    // incoming data
-    if( dgram->handle >= 0 ){
-
-        // so there is buffered data, lets see if the app has
-        // retrieved it
-        if( dgram->state == SOCK_UDP_STATE_RX_DATA_RECEIVED ){
+    // check if the socket is already holding data.
+    // if so, queue the incoming data behind it.
+    if( ( dgram->handle >= 0 ) || ( dgram->rx.count > 0 ) ){
 
-            // app already saw this, so we'll release it here.
+        if( rx_enqueue( dgram, state, header_len ) ){
 
-            // free the receive buffer
-            mem2_v_free( dgram->handle );
+            rx_update_high_water( dgram );
 
-            // mark handle as empty
-            dgram->handle = -1;
+            return;
         }
-        else{
+
+        // queue is full, lets see if the app has
+        // retrieved the current datagram
+        if( dgram->state != SOCK_UDP_STATE_RX_DATA_RECEIVED ){
 
             // app hasn't received data, so we bail out and this new data
             // gets dropped.
+            dgram->rx.drops++;
+            sock_rx_dropped++;
 
             log_v_debug_P( PSTR("dropped to: %u from %u"), dgram->lport, state->raddr.port );
 
             return;
         }
+
+        // app already saw this, so we'll release it here.
+        if( rx_advance( dgram ) ){
+
+            // a queued datagram is now current, which made room
+            // for the new one.
+            dgram->state = SOCK_UDP_STATE_RX_DATA_PENDING;
+
+            rx_enqueue( dgram, state, header_len );
+
+            return;
+        }
     }
 
     // assign handle to socket
     dgram->handle = state->data_handle;
+    dgram->header_len = header_len;
 
     // remove handle from netmsg
     state->data_handle = -1;
@@ -1022,14 +1431,23 @@ void sock_v_recv( netmsg_t netmsg ){
 
     // set state
     dgram->state = SOCK_UDP_STATE_RX_DATA_PENDING;
+
+    rx_update_high_water( dgram );
 }
 
 void sock_v_init( void ){
 
     list_v_init( &sockets );
 
-    // set a random starting port number
-	current_ephemeral_port = SOCK_EPHEMERAL_PORT_LOW + ( rnd_u16_get_int() >> 3 );
+    memset( port_table, 0, sizeof(port_table) );
+    port_table_overflow = 0;
+
+    memset( ephemeral_map, 0, sizeof(ephemeral_map) );
+
+    // set a random window for ephemeral ports
+    ephemeral_base = SOCK_EPHEMERAL_PORT_LOW +
+                     ( rnd_u16_get_int() % ( SOCK_EPHEMERAL_PORT_HIGH - SOCK_EPHEMERAL_PORT_LOW - SOCK_EPHEMERAL_MAP_PORTS ) );
+    current_ephemeral_port = ephemeral_base + SOCK_EPHEMERAL_MAP_PORTS - 1;
 
     // start timeout thread
     thread_t_create( timeout_thread,
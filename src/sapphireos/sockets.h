@@ -38,9 +38,27 @@
 #define SOCK_EPHEMERAL_PORT_LOW         49152
 #define SOCK_EPHEMERAL_PORT_HIGH        65535
 
+// number of ephemeral ports tracked in the allocation bitmap.
+// must be a multiple of 8.
+#ifndef SOCK_EPHEMERAL_MAP_PORTS
+    #define SOCK_EPHEMERAL_MAP_PORTS    64
+#endif
+
+// slots in the port to socket lookup table.
+// must be a power of 2.
+#ifndef SOCK_PORT_TABLE_SIZE
+    #define SOCK_PORT_TABLE_SIZE        16
+#endif
+
 #define SOCK_TIMER_TICK_MS              1000
 #define SOCK_MAXIMUM_TIMEOUT            60   // in seconds
 
+// maximum number of datagrams a socket can hold, including the one
+// currently being processed by the application.
+#ifndef SOCK_RX_QUEUE_MAX_DEPTH
+    #define SOCK_RX_QUEUE_MAX_DEPTH     8
+#endif
+
 
 typedef list_node_t socket_t;
 
@@ -86,10 +104,19 @@ typedef uint8_t sock_options_t8;
 #define SOCK_OPTIONS_UDPX_NO_RETRY              0x20 // UDPX client will only send 1 try
 #endif
 
+typedef struct{
+    uint16_t drops;             // datagrams dropped because the queue was full
+    uint8_t high_water;         // most datagrams held at once
+    uint8_t queued;             // datagrams waiting behind the current one
+    uint8_t depth;              // receive queue depth
+} sock_rx_stats_t;
+
 socket_t sock_s_create( sock_type_t8 type );
 void sock_v_release( socket_t sock );
 void sock_v_bind( socket_t sock, uint16_t port );
 void sock_v_set_options( socket_t sock, sock_options_t8 options );
+int8_t sock_i8_set_rx_depth( socket_t sock, uint8_t depth );
+void sock_v_get_rx_stats( socket_t sock, sock_rx_stats_t *stats );
 
 void sock_v_set_timeout( socket_t sock, uint8_t timeout );
 
@@ -107,6 +134,7 @@ bool sock_b_port_busy( uint16_t port );
 bool sock_b_busy( socket_t sock );
 
 int8_t sock_i8_recvfrom( socket_t sock );
+uint8_t sock_u8_rx_queued( socket_t sock );
 int16_t sock_i16_sendto( socket_t sock, void *buf, uint16_t bufsize, sock_addr_t *raddr );
 int16_t sock_i16_sendto_m( socket_t sock, mem_handle_t handle, sock_addr_t *raddr );
 
@@ -67,6 +67,32 @@ before sleeping the processor.
 // thread state storage
 static list_t thread_list;
 
+// scheduler queues.
+// the ready queue holds threads that are waiting or yielded, these are
+// polled on every scheduler pass.  the signal queue holds threads waiting
+// on a signal.  sleeping threads are on neither, they are only woken
+// through the alarm heap (or a restart).
+typedef struct{
+    thread_t head;
+    thread_t tail;
+    thread_t cursor; // next thread the scheduler will visit
+} thread_queue_t;
+
+static thread_queue_t queues[THREAD_QUEUE_COUNT];
+
+// min-heap of threads with an alarm set, ordered by alarm time
+#define ALARM_INDEX_NONE        0xff
+static thread_t alarm_heap[THREAD_MAX_ALARMS];
+static uint8_t alarm_count;
+
+// number of threads with an alarm that did not fit in the heap
+static uint8_t alarm_overflow;
+
+// scheduler pass counter.  SCHED_PASS_NONE is never a valid pass,
+// all stamps are reset to it when the counter wraps.
+#define SCHED_PASS_NONE         0xff
+static uint8_t sched_pass;
+
 // currently running thread
 static thread_t current_thread;
 static uint8_t run_cause;
@@ -75,7 +101,7 @@ static uint8_t run_cause;
 static cpu_info_t cpu_info;
 static uint32_t task_us;
 static uint32_t sleep_us;
-static uint16_t loops;
+static uint32_t loops;
 
 static volatile uint8_t thread_flags;
 #define FLAGS_SLEEP         0x02
@@ -83,6 +109,24 @@ static volatile uint8_t thread_flags;
 
 static volatile uint16_t signals;
 
+// signals raised since the signal queue was last processed
+static volatile uint16_t signals_raised;
+
+#ifdef ENABLE_THREAD_STATS
+// time the first of the currently raised signals came in
+static volatile uint32_t signal_time;
+static uint32_t signal_wake_time;
+
+// ring buffer of recent thread runs
+static thread_trace_t trace[THREAD_TRACE_LEN];
+static uint8_t trace_index;
+static uint8_t trace_count;
+
+// only trace runs with a run time or wake latency of at least this many
+// microseconds.
+static uint16_t trace_min;
+#endif
+
 
 #ifdef ENABLE_STACK_LOGGING
 static uint16_t last_stack;
@@ -116,6 +160,10 @@ KV_SECTION_META kv_meta_t thread_info_kv[] = {
     { SAPPHIRE_TYPE_UINT16,  0, KV_FLAGS_READ_ONLY,  &cpu_info.task_time,       0,  "thread_task_time" },
     { SAPPHIRE_TYPE_UINT16,  0, KV_FLAGS_READ_ONLY,  &cpu_info.sleep_time,      0,  "thread_sleep_time" },
     { SAPPHIRE_TYPE_UINT16,  0, KV_FLAGS_READ_ONLY,  &cpu_info.scheduler_loops, 0,  "thread_loops" },
+    { SAPPHIRE_TYPE_UINT16,  0, KV_FLAGS_READ_ONLY,  &cpu_info.loop_rate,       0,  "thread_loop_rate" },
+    #ifdef ENABLE_THREAD_STATS
+    { SAPPHIRE_TYPE_UINT16,  0, 0,                   &trace_min,                0,  "thread_trace_min" },
+    #endif
 };
 
 
@@ -190,11 +238,407 @@ static uint16_t vfile( vfile_op_t8 op, uint32_t pos, void *ptr, uint16_t len ){
 }
 
 
+static thread_state_t *get_state( thread_t thread ){
+
+    list_node_state_t *ln_state = mem2_vp_get_ptr_fast( thread );
+
+    return (thread_state_t *)&ln_state->data;
+}
+
+static void queue_v_insert( uint8_t queue, thread_t thread ){
+
+    thread_state_t *state = get_state( thread );
+
+    if( ( state->queues & ( 1 << queue ) ) != 0 ){
+
+        // already queued
+        return;
+    }
+
+    state->queues |= ( 1 << queue );
+    state->links[queue].prev = queues[queue].tail;
+    state->links[queue].next = -1;
+
+    if( queues[queue].tail >= 0 ){
+
+        get_state( queues[queue].tail )->links[queue].next = thread;
+    }
+    else{
+
+        queues[queue].head = thread;
+    }
+
+    queues[queue].tail = thread;
+}
+
+static void queue_v_remove( uint8_t queue, thread_t thread ){
+
+    thread_state_t *state = get_state( thread );
+
+    if( ( state->queues & ( 1 << queue ) ) == 0 ){
+
+        return;
+    }
+
+    thread_t prev = state->links[queue].prev;
+    thread_t next = state->links[queue].next;
+
+    state->queues &= ~( 1 << queue );
+
+    if( prev >= 0 ){
+
+        get_state( prev )->links[queue].next = next;
+    }
+    else{
+
+        queues[queue].head = next;
+    }
+
+    if( next >= 0 ){
+
+        get_state( next )->links[queue].prev = prev;
+    }
+    else{
+
+        queues[queue].tail = prev;
+    }
+
+    // if the scheduler was about to visit this thread, skip over it
+    if( queues[queue].cursor == thread ){
+
+        queues[queue].cursor = next;
+    }
+}
+
+static bool alarm_b_before( uint8_t a, uint8_t b ){
+
+    return tmr_i8_compare_times( get_state( alarm_heap[a] )->alarm,
+                                 get_state( alarm_heap[b] )->alarm ) < 0;
+}
+
+static void alarm_v_swap( uint8_t a, uint8_t b ){
+
+    thread_t temp = alarm_heap[a];
+    alarm_heap[a] = alarm_heap[b];
+    alarm_heap[b] = temp;
+
+    get_state( alarm_heap[a] )->alarm_index = a;
+    get_state( alarm_heap[b] )->alarm_index = b;
+}
+
+static void alarm_v_sift_up( uint8_t index ){
+
+    while( index > 0 ){
+
+        uint8_t parent = ( index - 1 ) / 2;
+
+        if( !alarm_b_before( index, parent ) ){
+
+            break;
+        }
+
+        alarm_v_swap( index, parent );
+        index = parent;
+    }
+}
+
+static void alarm_v_sift_down( uint8_t index ){
+
+    while(1){
+
+        uint8_t smallest = index;
+        uint8_t left = index * 2 + 1;
+        uint8_t right = left + 1;
+
+        if( ( left < alarm_count ) && alarm_b_before( left, smallest ) ){
+
+            smallest = left;
+        }
+
+        if( ( right < alarm_count ) && alarm_b_before( right, smallest ) ){
+
+            smallest = right;
+        }
+
+        if( smallest == index ){
+
+            break;
+        }
+
+        alarm_v_swap( index, smallest );
+        index = smallest;
+    }
+}
+
+// add thread to the alarm heap, or reposition it if its alarm changed
+static void alarm_v_insert( thread_t thread ){
+
+    thread_state_t *state = get_state( thread );
+
+    if( state->alarm_index != ALARM_INDEX_NONE ){
+
+        uint8_t index = state->alarm_index;
+
+        alarm_v_sift_up( index );
+        alarm_v_sift_down( get_state( thread )->alarm_index );
+
+        return;
+    }
+
+    if( alarm_count >= THREAD_MAX_ALARMS ){
+
+        // heap is full, the scheduler will scan for this one
+        alarm_overflow++;
+
+        return;
+    }
+
+    state->alarm_index = alarm_count;
+    alarm_heap[alarm_count] = thread;
+    alarm_count++;
+
+    alarm_v_sift_up( alarm_count - 1 );
+}
+
+// remove thread from the alarm heap.
+// does not change the thread's alarm flag.
+static void alarm_v_remove( thread_t thread ){
+
+    thread_state_t *state = get_state( thread );
+
+    if( state->alarm_index == ALARM_INDEX_NONE ){
+
+        if( ( state->flags & THREAD_FLAGS_ALARM ) != 0 ){
+
+            ASSERT( alarm_overflow > 0 );
+
+            alarm_overflow--;
+        }
+
+        return;
+    }
+
+    uint8_t index = state->alarm_index;
+    state->alarm_index = ALARM_INDEX_NONE;
+
+    alarm_count--;
+
+    if( index == alarm_count ){
+
+        return;
+    }
+
+    // move last entry into the hole
+    thread_t moved = alarm_heap[alarm_count];
+    alarm_heap[index] = moved;
+    get_state( moved )->alarm_index = index;
+
+    alarm_v_sift_up( index );
+    alarm_v_sift_down( get_state( moved )->alarm_index );
+}
+
+#ifdef ENABLE_THREAD_STATS
+static uint16_t stats_vfile( vfile_op_t8 op, uint32_t pos, void *ptr, uint16_t len ){
+
+    uint16_t ret_val = 0;
+
+    uint8_t thread_count = thread_u16_get_thread_count();
+    uint16_t threads_start = sizeof(thread_stats_header_t);
+    uint16_t trace_start = threads_start + ( thread_count * sizeof(thread_stats_t) );
+
+    // the pos and len values are already bounds checked by the FS driver
+    switch( op ){
+
+        case FS_VFILE_OP_READ:
+
+            // iterate over data length and fill record buffers as needed
+            while( len > 0 ){
+
+                union{
+                    thread_stats_header_t header;
+                    thread_stats_t stats;
+                    thread_trace_t trace;
+                } record;
+
+                memset( &record, 0, sizeof(record) );
+
+                uint16_t record_start;
+                uint16_t record_len;
+
+                if( pos < threads_start ){
+
+                    record.header.version       = THREAD_STATS_VERSION;
+                    record.header.thread_count  = thread_count;
+                    record.header.trace_count   = trace_count;
+                    record.header.hist_buckets  = THREAD_HIST_BUCKETS;
+                    record.header.trace_min     = trace_min;
+
+                    record_start = 0;
+                    record_len = sizeof(record.header);
+                }
+                else if( pos < trace_start ){
+
+                    uint8_t page = ( pos - threads_start ) / sizeof(thread_stats_t);
+
+                    thread_t thread = list_ln_index( &thread_list, page );
+
+                    if( thread >= 0 ){
+
+                        thread_state_t *state = list_vp_get_data( thread );
+
+                        record.stats.thread_addr    = (uint32_t)((uintptr_t)state->thread) * 2; //multiply by 2 to get byte address
+                        record.stats.max_run_time   = state->max_run_time;
+                        record.stats.max_latency    = state->max_latency;
+                        memcpy( record.stats.run_hist, state->run_hist, sizeof(record.stats.run_hist) );
+                        memcpy( record.stats.latency_hist, state->latency_hist, sizeof(record.stats.latency_hist) );
+                    }
+
+                    record_start = threads_start + ( page * sizeof(thread_stats_t) );
+                    record_len = sizeof(record.stats);
+                }
+                else{
+
+                    uint8_t page = ( pos - trace_start ) / sizeof(thread_trace_t);
+
+                    if( page < trace_count ){
+
+                        // oldest entry first
+                        uint8_t index = ( trace_index + THREAD_TRACE_LEN - trace_count + page ) % THREAD_TRACE_LEN;
+
+                        record.trace = trace[index];
+                    }
+
+                    record_start = trace_start + ( page * sizeof(thread_trace_t) );
+                    record_len = sizeof(record.trace);
+                }
+
+                // get offset into record
+                uint16_t offset = pos - record_start;
+
+                // set copy length
+                uint16_t copy_len = record_len - offset;
+
+                if( copy_len > len ){
+
+                    copy_len = len;
+                }
+
+                // copy data
+                memcpy( ptr, (void *)&record + offset, copy_len );
+
+                // adjust pointers
+                ptr += copy_len;
+                len -= copy_len;
+                pos += copy_len;
+                ret_val += copy_len;
+            }
+
+            break;
+
+        case FS_VFILE_OP_SIZE:
+            ret_val = trace_start + ( trace_count * sizeof(thread_trace_t) );
+            break;
+
+        default:
+            ret_val = 0;
+            break;
+    }
+
+    return ret_val;
+}
+
+static uint8_t hist_bucket( uint32_t us ){
+
+    uint8_t bucket = 0;
+
+    us >>= 5;
+
+    while( ( us > 0 ) && ( bucket < ( THREAD_HIST_BUCKETS - 1 ) ) ){
+
+        us >>= 2;
+        bucket++;
+    }
+
+    return bucket;
+}
+
+static void update_stats( thread_state_t *state,
+                          uint32_t start_time,
+                          uint32_t elapsed_us,
+                          uint32_t latency,
+                          uint8_t cause,
+                          uint8_t status ){
+
+    if( elapsed_us > state->max_run_time ){
+
+        state->max_run_time = elapsed_us;
+    }
+
+    uint8_t bucket = hist_bucket( elapsed_us );
+
+    if( state->run_hist[bucket] < 0xffff ){
+
+        state->run_hist[bucket]++;
+    }
+
+    if( cause != 0 ){
+
+        if( latency > state->max_latency ){
+
+            state->max_latency = latency;
+        }
+
+        bucket = hist_bucket( latency );
+
+        if( state->latency_hist[bucket] < 0xffff ){
+
+            state->latency_hist[bucket]++;
+        }
+    }
+
+    if( ( elapsed_us < trace_min ) && ( latency < trace_min ) ){
+
+        return;
+    }
+
+    thread_trace_t *entry = &trace[trace_index];
+
+    entry->timestamp    = start_time;
+    entry->thread_addr  = (uint32_t)((uintptr_t)state->thread) * 2;
+    entry->run_time     = elapsed_us > 0xffff ? 0xffff : elapsed_us;
+    entry->latency      = latency > 0xffff ? 0xffff : latency;
+    entry->cause        = cause;
+    entry->status       = status;
+
+    trace_index++;
+
+    if( trace_index >= THREAD_TRACE_LEN ){
+
+        trace_index = 0;
+    }
+
+    if( trace_count < THREAD_TRACE_LEN ){
+
+        trace_count++;
+    }
+}
+#endif
+
 // initialize the thread scheduler
 void thread_v_init( void ){
 
     // init thread list
     list_v_init( &thread_list );
+
+    for( uint8_t i = 0; i < THREAD_QUEUE_COUNT; i++ ){
+
+        queues[i].head = -1;
+        queues[i].tail = -1;
+        queues[i].cursor = -1;
+    }
+
+    alarm_count = 0;
+    alarm_overflow = 0;
 }
 
 // return current number of threads
@@ -286,6 +730,17 @@ static thread_t make_thread( PT_THREAD( ( *thread )( pt_t *pt, void *state ) ),
     state->runs     = 0;
     state->alarm    = 0;
 
+    state->queues       = 0;
+    state->pass         = SCHED_PASS_NONE;
+    state->alarm_index  = ALARM_INDEX_NONE;
+
+    #ifdef ENABLE_THREAD_STATS
+    state->max_run_time = 0;
+    state->max_latency  = 0;
+    memset( state->run_hist, 0, sizeof(state->run_hist) );
+    memset( state->latency_hist, 0, sizeof(state->latency_hist) );
+    #endif
+
     // copy data (if present)
     if( initial_data != 0 ){
 
@@ -303,6 +758,8 @@ static thread_t make_thread( PT_THREAD( ( *thread )( pt_t *pt, void *state ) ),
     // add to list
     list_v_insert_tail( &thread_list, ln );
 
+    queue_v_insert( THREAD_QUEUE_READY, ln );
+
     return ln;
 }
 
@@ -351,16 +808,30 @@ void *thread_vp_get_data( thread_t thread_id ){
 // restart a thread
 void thread_v_restart( thread_t thread_id ){
 
+    // resetting the flags drops any alarm or signal wait
+    alarm_v_remove( thread_id );
+    queue_v_remove( THREAD_QUEUE_SIGNAL, thread_id );
+
     thread_state_t *state = list_vp_get_data( thread_id );
 
 	state->flags = THREAD_FLAGS_YIELDED;
 
 	PT_INIT( &state->pt );
+
+    queue_v_insert( THREAD_QUEUE_READY, thread_id );
 }
 
 // kill a thread
 void thread_v_kill( thread_t thread_id ){
 
+    // remove from scheduler queues
+    alarm_v_remove( thread_id );
+
+    for( uint8_t i = 0; i < THREAD_QUEUE_COUNT; i++ ){
+
+        queue_v_remove( i, thread_id );
+    }
+
     // remove from list
     list_v_remove( &thread_list, thread_id );
 
@@ -386,6 +857,15 @@ void thread_v_signal( uint8_t signum ){
 
     signals |= ( (uint16_t)1 << signum );
 
+    #ifdef ENABLE_THREAD_STATS
+    if( signals_raised == 0 ){
+
+        signal_time = tmr_u32_get_system_time_us();
+    }
+    #endif
+
+    signals_raised |= ( (uint16_t)1 << signum );
+
     END_ATOMIC;
 
     EVENT( EVENT_ID_SIGNAL, signum );
@@ -422,6 +902,8 @@ void thread_v_set_signal_flag( void ){
     thread_state_t *state = list_vp_get_data( thread_t_get_current_thread() );
 
 	state->flags |= THREAD_FLAGS_SIGNAL;
+
+    queue_v_insert( THREAD_QUEUE_SIGNAL, thread_t_get_current_thread() );
 }
 
 void thread_v_clear_signal_flag( void ){
@@ -429,6 +911,8 @@ void thread_v_clear_signal_flag( void ){
     thread_state_t *state = list_vp_get_data( thread_t_get_current_thread() );
 
 	state->flags &= ~THREAD_FLAGS_SIGNAL;
+
+    queue_v_remove( THREAD_QUEUE_SIGNAL, thread_t_get_current_thread() );
 }
 
 uint16_t thread_u16_get_signals( void ){
@@ -453,14 +937,32 @@ void thread_v_set_alarm( uint32_t alarm ){
 
     thread_state_t *state = list_vp_get_data( thread_t_get_current_thread() );
 
+    // if the alarm is in the overflow set, it stays there
+    if( ( state->alarm_index == ALARM_INDEX_NONE ) &&
+        ( ( state->flags & THREAD_FLAGS_ALARM ) != 0 ) ){
+
+        state->alarm = alarm;
+
+        return;
+    }
+
     state->alarm = alarm;
     state->flags |= THREAD_FLAGS_ALARM;
+
+    alarm_v_insert( thread_t_get_current_thread() );
 }
 
 void thread_v_clear_alarm( void ){
 
     thread_state_t *state = list_vp_get_data( thread_t_get_current_thread() );
 
+    if( ( state->flags & THREAD_FLAGS_ALARM ) == 0 ){
+
+        return;
+    }
+
+    alarm_v_remove( thread_t_get_current_thread() );
+
     state->alarm = 0;
     state->flags &= ~THREAD_FLAGS_ALARM;
 }
@@ -481,23 +983,33 @@ int32_t thread_i32_get_next_alarm( void ){
 
     int32_t next_alarm = INT32_MAX;
 
-    // iterate through thread list
-    list_node_t ln = thread_list.head;
+    if( alarm_count > 0 ){
 
-    while( ln >= 0 ){
+        next_alarm = get_state( alarm_heap[0] )->alarm;
+    }
 
-        list_node_state_t *ln_state = mem2_vp_get_ptr_fast( ln );
-        thread_state_t *state = (thread_state_t *)&ln_state->data;
+    if( alarm_overflow > 0 ){
 
-        if( ( state->flags & THREAD_FLAGS_ALARM ) != 0 ){
+        // iterate through thread list for alarms that aren't in the heap
+        list_node_t ln = thread_list.head;
 
-            if( (int32_t)state->alarm < next_alarm ){
+        while( ln >= 0 ){
 
-                next_alarm = state->alarm;
+            list_node_state_t *ln_state = mem2_vp_get_ptr_fast( ln );
+            thread_state_t *state = (thread_state_t *)&ln_state->data;
+
+            if( ( ( state->flags & THREAD_FLAGS_ALARM ) != 0 ) &&
+                ( state->alarm_index == ALARM_INDEX_NONE ) ){
+
+                if( ( next_alarm == INT32_MAX ) ||
+                    ( tmr_i8_compare_times( state->alarm, next_alarm ) < 0 ) ){
+
+                    next_alarm = state->alarm;
+                }
             }
-        }
 
-        ln = ln_state->next;
+            ln = ln_state->next;
+        }
     }
 
     if( next_alarm == INT32_MAX ){
@@ -512,6 +1024,26 @@ void run_thread( thread_t thread, thread_state_t *state ){
 
     uint32_t thread_ticks = tmr_u32_get_ticks();
 
+    state->pass = sched_pass;
+
+    #ifdef ENABLE_THREAD_STATS
+    uint32_t start_time = tmr_u32_get_system_time_us();
+    uint32_t latency = 0;
+    uint8_t cause = run_cause;
+
+    // wake to run latency
+    if( cause == THREAD_FLAGS_ALARM ){
+
+        // alarms are in milliseconds.
+        // this wraps correctly in 32 bits.
+        latency = start_time - ( state->alarm * 1000 );
+    }
+    else if( cause == THREAD_FLAGS_SIGNAL ){
+
+        latency = start_time - signal_wake_time;
+    }
+    #endif
+
 	// set current thread
 	current_thread = thread;
 
@@ -550,6 +1082,16 @@ void run_thread( thread_t thread, thread_state_t *state ){
 
     #endif
 
+    #ifdef ENABLE_THREAD_STATS
+    // record runs that did work, and all wake ups
+    if( ( thread_flags & FLAGS_ACTIVE ) || ( cause != 0 ) ){
+
+        uint32_t elapsed_us = tmr_u32_ticks_to_us( tmr_u32_elapsed_ticks( thread_ticks ) );
+
+        update_stats( state, start_time, elapsed_us, latency, cause, status );
+    }
+    #endif
+
     // compute run time
     if( thread_flags & FLAGS_ACTIVE ){
 
@@ -587,6 +1129,8 @@ void run_thread( thread_t thread, thread_state_t *state ){
 
             state->flags |= THREAD_FLAGS_WAITING;
 
+            queue_v_insert( THREAD_QUEUE_READY, thread );
+
             break;
 
         // thread yielded, it has more processing to do
@@ -594,6 +1138,8 @@ void run_thread( thread_t thread, thread_state_t *state ){
 
             state->flags |= THREAD_FLAGS_YIELDED;
 
+            queue_v_insert( THREAD_QUEUE_READY, thread );
+
             break;
 
         // thread has gone to sleep
@@ -601,6 +1147,8 @@ void run_thread( thread_t thread, thread_state_t *state ){
 
             state->flags |= THREAD_FLAGS_SLEEPING;
 
+            queue_v_remove( THREAD_QUEUE_READY, thread );
+
             break;
 
         // if the thread has completed,
@@ -626,12 +1174,93 @@ void run_thread( thread_t thread, thread_state_t *state ){
 
 void process_signalled_threads( void ){
 
-    if( thread_u16_get_signals() == 0 ){
+    uint16_t raised;
+
+    ATOMIC;
+
+    raised = signals_raised;
+    signals_raised = 0;
+
+    #ifdef ENABLE_THREAD_STATS
+    signal_wake_time = signal_time;
+    #endif
+
+    END_ATOMIC;
+
+    // waiters only need to run when a new signal comes in.  a waiter that
+    // isn't woken by it is still polled through the ready queue.
+    if( raised == 0 ){
 
         return;
     }
 
-    // iterate through thread list
+    thread_t thread = queues[THREAD_QUEUE_SIGNAL].head;
+
+    while( thread >= 0 ){
+
+        thread_state_t *state = get_state( thread );
+
+        // save next thread before running.  if the running thread removes
+        // it from the queue, the cursor is advanced for us.
+        queues[THREAD_QUEUE_SIGNAL].cursor = state->links[THREAD_QUEUE_SIGNAL].next;
+
+        run_cause = THREAD_FLAGS_SIGNAL;
+
+        // clear wait flags
+        state->flags &= ~THREAD_FLAGS_WAITING;
+        state->flags &= ~THREAD_FLAGS_YIELDED;
+
+        run_thread( thread, state );
+
+        thread = queues[THREAD_QUEUE_SIGNAL].cursor;
+    }
+
+    queues[THREAD_QUEUE_SIGNAL].cursor = -1;
+}
+
+static void run_alarm_thread( thread_t thread, thread_state_t *state ){
+
+    run_cause = THREAD_FLAGS_ALARM;
+
+    // clear flags
+    state->flags &= ~THREAD_FLAGS_ALARM;
+    state->flags &= ~THREAD_FLAGS_SLEEPING;
+    state->flags &= ~THREAD_FLAGS_WAITING;
+    state->flags &= ~THREAD_FLAGS_YIELDED;
+
+    run_thread( thread, state );
+}
+
+// earliest expired alarm in the heap whose thread has not
+// run this pass, -1 if none.
+static thread_t alarm_t_next_expired( void ){
+
+    thread_t next = -1;
+    thread_state_t *next_state = 0;
+
+    for( uint8_t i = 0; i < alarm_count; i++ ){
+
+        thread_state_t *state = get_state( alarm_heap[i] );
+
+        if( ( state->pass == sched_pass ) ||
+            ( tmr_i8_compare_time( state->alarm ) >= 0 ) ){
+
+            continue;
+        }
+
+        if( ( next < 0 ) ||
+            ( tmr_i8_compare_times( state->alarm, next_state->alarm ) < 0 ) ){
+
+            next = alarm_heap[i];
+            next_state = state;
+        }
+    }
+
+    return next;
+}
+
+static void reset_pass_stamps( void ){
+
     list_node_t ln = thread_list.head;
 
     while( ln >= 0 ){
@@ -639,15 +1268,67 @@ void process_signalled_threads( void ){
         list_node_state_t *ln_state = mem2_vp_get_ptr_fast( ln );
         thread_state_t *state = (thread_state_t *)&ln_state->data;
 
-        if( ( state->flags & THREAD_FLAGS_SIGNAL ) != 0 ){
+        state->pass = SCHED_PASS_NONE;
+
+        ln = ln_state->next;
+    }
+}
+
+static void process_alarm_threads( void ){
+
+    while( alarm_count > 0 ){
+
+        thread_t thread = alarm_heap[0];
+        thread_state_t *state = get_state( thread );
+
+        if( tmr_i8_compare_time( state->alarm ) >= 0 ){
+
+            break;
+        }
+
+        // a thread runs at most once per pass, even if it
+        // sets another alarm that has already expired.
+        // skip it, but not the other expired alarms behind it.
+        if( state->pass == sched_pass ){
+
+            thread = alarm_t_next_expired();
+
+            if( thread < 0 ){
+
+                break;
+            }
+
+            state = get_state( thread );
+        }
+
+        alarm_v_remove( thread );
+
+        run_alarm_thread( thread, state );
+
+        process_signalled_threads();
+    }
 
-            run_cause = THREAD_FLAGS_SIGNAL;
+    if( alarm_overflow == 0 ){
+
+        return;
+    }
 
-            // clear wait flags
-            state->flags &= ~THREAD_FLAGS_WAITING;
-            state->flags &= ~THREAD_FLAGS_YIELDED;
+    // alarms that didn't fit in the heap
+    list_node_t ln = thread_list.head;
+
+    while( ln >= 0 ){
+
+        list_node_state_t *ln_state = mem2_vp_get_ptr_fast( ln );
+        thread_state_t *state = (thread_state_t *)&ln_state->data;
 
-            run_thread( ln, state );
+        if( ( ( state->flags & THREAD_FLAGS_ALARM ) != 0 ) &&
+            ( state->alarm_index == ALARM_INDEX_NONE ) &&
+            ( state->pass != sched_pass ) &&
+            ( tmr_i8_compare_time( state->alarm ) < 0 ) ){
+
+            alarm_v_remove( ln );
+
+            run_alarm_thread( ln, state );
         }
 
         ln = ln_state->next;
@@ -700,6 +1381,10 @@ void thread_start( void ){
     // create vfile
     fs_f_create_virtual( PSTR("threadinfo"), vfile );
 
+    #ifdef ENABLE_THREAD_STATS
+    fs_f_create_virtual( PSTR("threadstats"), stats_vfile );
+    #endif
+
 
 	// infinite loop running the thread scheduler
 	while(1){
@@ -707,34 +1392,38 @@ void thread_start( void ){
 		// set sleep flag
 		thread_flags |= FLAGS_SLEEP;
 
+        sched_pass++;
+
+        if( sched_pass == SCHED_PASS_NONE ){
+
+            sched_pass = 0;
+            reset_pass_stamps();
+        }
+
 		// ********************************************************************
-		// Process Waiting threads
+		// Process alarms
 		//
-		// Loop through all waiting threads
+		// Run threads whose alarm has expired, earliest first
 		// ********************************************************************
-        list_node_t ln = thread_list.head;
-
-        while( ln >= 0 ){
+        process_alarm_threads();
 
-            list_node_state_t *ln_state = mem2_vp_get_ptr_fast( ln );
-
-            thread_state_t *state = (thread_state_t *)&ln_state->data;
+		// ********************************************************************
+		// Process Waiting threads
+		//
+		// Loop through the ready queue
+		// ********************************************************************
+        thread_t thread = queues[THREAD_QUEUE_READY].head;
 
-            if( ( ( state->flags & THREAD_FLAGS_ALARM ) != 0 ) &&
-                  ( tmr_i8_compare_time( state->alarm ) < 0 ) ){
+        while( thread >= 0 ){
 
-                run_cause = THREAD_FLAGS_ALARM;
+            thread_state_t *state = get_state( thread );
 
-                // clear flags
-                state->flags &= ~THREAD_FLAGS_ALARM;
-                state->flags &= ~THREAD_FLAGS_SLEEPING;
-                state->flags &= ~THREAD_FLAGS_WAITING;
-                state->flags &= ~THREAD_FLAGS_YIELDED;
+            // save next thread before running.  if the running thread
+            // removes it from the queue, the cursor is advanced for us.
+            queues[THREAD_QUEUE_READY].cursor = state->links[THREAD_QUEUE_READY].next;
 
-                run_thread( ln, state );
-            }
-			else if( ( ( ( state->flags & THREAD_FLAGS_WAITING ) != 0 ) ||
-                       ( ( state->flags & THREAD_FLAGS_YIELDED ) != 0 ) ) ){
+            // skip threads that already ran on an alarm this pass
+            if( state->pass != sched_pass ){
 
 				// clear wait flags
 				state->flags &= ~THREAD_FLAGS_WAITING;
@@ -742,18 +1431,20 @@ void thread_start( void ){
                 state->flags &= ~THREAD_FLAGS_SLEEPING;
 
 				// run the thread
-				run_thread( ln, state );
-			}
+				run_thread( thread, state );
 
-            ln = ln_state->next;
+                process_signalled_threads();
+            }
 
-            process_signalled_threads();
+            thread = queues[THREAD_QUEUE_READY].cursor;
 
             #ifdef ENABLE_USB
             usb_v_poll();
             #endif
 		}
 
+        queues[THREAD_QUEUE_READY].cursor = -1;
+
         // EVENT( EVENT_ID_DEBUG_6, 0 );
         mem2_v_collect_garbage();
         // EVENT( EVENT_ID_DEBUG_6, 1 );
@@ -782,10 +1473,7 @@ void thread_start( void ){
         break;
         #endif
 
-        if( loops < 0xffff ){
-
-            loops++;
-        }
+        loops++;
 	}
 }
 
@@ -826,7 +1514,24 @@ PT_BEGIN( pt );
         cpu_info.run_time = tmr_u32_elapsed_time_ms( timestamp );
         cpu_info.task_time = task_us / 1000;
         cpu_info.sleep_time = sleep_us / 1000;
-        cpu_info.scheduler_loops = loops;
+        cpu_info.scheduler_loops = loops > 0xffff ? 0xffff : loops;
+
+        if( cpu_info.run_time > 0 ){
+
+            // keep this in 32 bits, 64 bit division is slow on the AVR
+            uint32_t loop_rate;
+
+            if( loops < ( UINT32_MAX / 1000 ) ){
+
+                loop_rate = ( loops * 1000 ) / cpu_info.run_time;
+            }
+            else{
+
+                loop_rate = ( loops / cpu_info.run_time ) * 1000;
+            }
+
+            cpu_info.loop_rate = loop_rate > 0xffff ? 0xffff : loop_rate;
+        }
 
         EVENT( EVENT_ID_DEBUG_0, 0 );
     }
@@ -38,6 +38,10 @@
 
 #define THREAD_MAX_SIGNALS  16
 
+// size of the alarm heap.  threads beyond this that set an alarm are
+// still handled, but their alarms are found with a linear scan.
+#define THREAD_MAX_ALARMS   32
+
 #define SIGNAL_SYS_0        0
 #define SIGNAL_SYS_1        1
 #define SIGNAL_SYS_2        2
@@ -67,8 +71,32 @@
 
 // #define ENABLE_STACK_LOGGING
 
+// per thread run time and wake latency histograms, plus a trace of
+// recent thread runs.  exposed in the threadstats vfile, which the
+// threadstats CLI command reads.  without this option the vfile does not
+// exist and the CLI reports that stats are disabled.
+// debug only: this adds 40 bytes to every thread's state on the heap,
+// plus the static trace buffer.  uncomment here to turn it on.
+// #define ENABLE_THREAD_STATS
+
+// histogram buckets are powers of 4, starting at 32 us:
+// <32us, <128us, <512us, <2ms, <8ms, <32ms, <128ms, >=128ms
+#define THREAD_HIST_BUCKETS 8
+
+#define THREAD_TRACE_LEN    16
+
 typedef struct pt pt_t;
 
+// scheduler queues
+#define THREAD_QUEUE_READY          0
+#define THREAD_QUEUE_SIGNAL         1
+#define THREAD_QUEUE_COUNT          2
+
+typedef struct{
+    thread_t prev;
+    thread_t next;
+} thread_link_t;
+
 typedef struct{
 	pt_t pt;    // protothread context
 	PT_THREAD( ( *thread )( pt_t *pt, void *state ) );
@@ -77,6 +105,19 @@ typedef struct{
     uint32_t alarm;
     uint32_t run_time;
     uint32_t runs;
+
+    // scheduler bookkeeping
+    uint8_t queues;     // bitmask of THREAD_QUEUE_* this thread is on
+    uint8_t pass;       // scheduler pass this thread last ran in
+    uint8_t alarm_index;
+    thread_link_t links[THREAD_QUEUE_COUNT];
+
+    #ifdef ENABLE_THREAD_STATS
+    uint32_t max_run_time;
+    uint32_t max_latency;
+    uint16_t run_hist[THREAD_HIST_BUCKETS];
+    uint16_t latency_hist[THREAD_HIST_BUCKETS];
+    #endif
 } thread_state_t;
 
 typedef struct{
@@ -91,6 +132,37 @@ typedef struct{
     uint8_t reserved[24];
 } thread_info_t;
 
+#define THREAD_STATS_VERSION    1
+
+// threadstats vfile:
+// thread_stats_header_t, followed by thread_count thread_stats_t,
+// followed by trace_count thread_trace_t (oldest first).
+typedef struct __attribute__((packed)){
+    uint8_t version;
+    uint8_t thread_count;
+    uint8_t trace_count;
+    uint8_t hist_buckets;
+    uint16_t trace_min;
+    uint8_t reserved[10];
+} thread_stats_header_t;
+
+typedef struct __attribute__((packed)){
+    uint32_t thread_addr;
+    uint32_t max_run_time;  // microseconds
+    uint32_t max_latency;   // wake to run, microseconds
+    uint16_t run_hist[THREAD_HIST_BUCKETS];
+    uint16_t latency_hist[THREAD_HIST_BUCKETS];
+} thread_stats_t;
+
+typedef struct __attribute__((packed)){
+    uint32_t timestamp;     // system time in microseconds at start of run
+    uint32_t thread_addr;
+    uint16_t run_time;      // microseconds
+    uint16_t latency;       // wake to run, microseconds
+    uint8_t cause;          // THREAD_FLAGS_ALARM, THREAD_FLAGS_SIGNAL or 0
+    uint8_t status;         // PT_* returned by the thread
+} thread_trace_t;
+
 #define THREAD_FLAGS_WAITING		0b00000001
 #define THREAD_FLAGS_YIELDED		0b00000010
 #define THREAD_FLAGS_SLEEPING		0b00000100
@@ -106,6 +178,7 @@ typedef struct{
     uint16_t task_time;
     uint16_t sleep_time;
     uint16_t scheduler_loops;
+    uint16_t loop_rate; // scheduler loops per second
 } cpu_info_t;
 
 